@@ -0,0 +1,339 @@
+#define _GNU_SOURCE
+#include "../codec/frame_encode.h"
+#include <app/animation.h>
+#include <app/frame_codec.h>
+#include <app/layer.h>
+#include <core/util.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ANIM_HAVE_TSC
+#endif
+
+// Packer of the animation store and benchmark of its playback. Frames in the layout of
+// the layer canvas (8 bit, planar RGB) are read from a file or generated, encoded with
+// the smallest encoding per frame and written as a store image, which the host uploads
+// row by row (see animation.h). The image is then played back with the firmware's
+// decoder the way animation.c does, in sequence from the start of the store.
+
+#define ANIM_STORE_SIZE             0x0e00 // See NVM_PAGE_DATA_SIZE in nvm.h
+#define ANIM_ROW_SIZE               512 // Flash row size, the unit of an upload
+#define ANIM_ERASED_BYTE            0xff
+#define ANIM_HEADER_SIZE            sizeof(struct animation_header)
+#define ANIM_FRAME_HEADER_SIZE      sizeof(struct frame_header)
+
+struct anim_config
+{
+    char const * input;         // Raw frames to pack, or NULL for the generated content
+    char const * output;        // Store image to write, or NULL
+    unsigned int frames;        // Frames of the generated content
+    unsigned int period;        // In milliseconds
+    unsigned int repeat;        // Times the animation is played back for the benchmark
+};
+
+struct anim_content
+{
+    char const * name;
+    void (*generate)(unsigned char * frame, unsigned int index);
+};
+
+static struct anim_config anim_config =
+{
+    .input = NULL,
+    .output = NULL,
+    .frames = 16,
+    .period = 40,
+    .repeat = 100,
+};
+
+static unsigned char anim_store[ANIM_STORE_SIZE];
+
+static unsigned long long anim_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+}
+
+static unsigned long long anim_cycles(void)
+{
+#ifdef ANIM_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void anim_set_pixel(unsigned char * frame, unsigned int x, unsigned int y, unsigned char r, unsigned char g, unsigned char b)
+{
+    unsigned int pos = (x % LAYER_NUM_OF_COLS) + (y % LAYER_NUM_OF_ROWS) * LAYER_NUM_OF_COLS;
+    frame[pos + LAYER_RED_OFFSET] = r;
+    frame[pos + LAYER_GREEN_OFFSET] = g;
+    frame[pos + LAYER_BLUE_OFFSET] = b;
+}
+
+// Content
+
+static void anim_content_dots(unsigned char * frame, unsigned int index)
+{
+    // A few dots moving over a black background
+    memset(frame, 0, LAYER_FRAME_BUFFER_SIZE);
+    for (unsigned int i = 0; i < 4; ++i)
+        anim_set_pixel(frame, index + i * 5, index / 2 + i * 3, 0xff, 0x80 * (i & 1), 0x20 * i);
+}
+
+static void anim_content_sweep(unsigned char * frame, unsigned int index)
+{
+    // A bar sweeping over the rows of a static background
+    for (unsigned int y = 0; y < LAYER_NUM_OF_ROWS; ++y)
+        for (unsigned int x = 0; x < LAYER_NUM_OF_COLS; ++x)
+            anim_set_pixel(frame, x, y, 0x04, 0x08 + x, y == index % LAYER_NUM_OF_ROWS ? 0xff : 0x10);
+}
+
+static void anim_content_pulse(unsigned char * frame, unsigned int index)
+{
+    // Rings growing from the center, most pixels change on every frame
+    for (unsigned int y = 0; y < LAYER_NUM_OF_ROWS; ++y) {
+        for (unsigned int x = 0; x < LAYER_NUM_OF_COLS; ++x) {
+            double distance = hypot(x - 7.5, y - 7.5);
+            unsigned char v = (sin(distance - index * 0.4) > 0.6) ? 0xff : 0;
+            anim_set_pixel(frame, x, y, v, v / 4, 0x20);
+        }
+    }
+}
+
+static struct anim_content const anim_contents[] =
+{
+    { "dots", anim_content_dots },
+    { "sweep", anim_content_sweep },
+    { "pulse", anim_content_pulse },
+};
+
+// Packing
+
+static bool anim_pack(unsigned char const * frames, unsigned int count, size_t * size)
+{
+    unsigned char data[FRAME_ENCODE_MAX_SIZE(LAYER_FRAME_BUFFER_SIZE)];
+    size_t used = ANIM_HEADER_SIZE;
+
+    memset(anim_store, ANIM_ERASED_BYTE, sizeof(anim_store));
+    for (unsigned int i = 0; i < count; ++i) {
+        // The first frame must not depend on the previous one, so the animation can loop
+        unsigned char const * frame = frames + i * LAYER_FRAME_BUFFER_SIZE;
+        unsigned char const * previous = i ? frame - LAYER_FRAME_BUFFER_SIZE : NULL;
+        enum frame_encoding encoding;
+        size_t encoded = frame_encode_best(&encoding, data, frame, previous, i ? LAYER_NUM_OF_ROWS : 0, NULL, LAYER_FRAME_BUFFER_SIZE);
+
+        if (used + ANIM_FRAME_HEADER_SIZE + encoded > ANIM_STORE_SIZE)
+            return false;
+
+        struct frame_header header = { .encoding = encoding, .size = encoded };
+        memcpy(anim_store + used, &header, ANIM_FRAME_HEADER_SIZE);
+        memcpy(anim_store + used + ANIM_FRAME_HEADER_SIZE, data, encoded);
+        used += ANIM_FRAME_HEADER_SIZE + encoded;
+    }
+
+    struct animation_header header =
+    {
+        .magic = ANIMATION_MAGIC,
+        .frames = count,
+        .frame_period = anim_config.period,
+        .size = used - ANIM_HEADER_SIZE,
+    };
+    crc16_t crc;
+    crc16_reset(&crc);
+    crc16_update(&crc, anim_store + ANIM_HEADER_SIZE, header.size);
+    header.crc = crc;
+    memcpy(anim_store, &header, ANIM_HEADER_SIZE);
+
+    *size = used;
+    return true;
+}
+
+// Playback
+
+static bool anim_decode(unsigned char const ** cursor, unsigned char const * end, unsigned char * frame)
+{
+    struct frame_header header;
+
+    if ((size_t)(end - *cursor) < ANIM_FRAME_HEADER_SIZE)
+        return false;
+    memcpy(&header, *cursor, ANIM_FRAME_HEADER_SIZE);
+
+    unsigned char const * data = *cursor + ANIM_FRAME_HEADER_SIZE;
+    if ((size_t)(end - data) < header.size)
+        return false;
+    *cursor = data + header.size;
+    if (header.encoding == FRAME_ENCODING_ROWS) {
+        struct frame_rows rows;
+        return frame_decode_rows(frame, LAYER_FRAME_BUFFER_SIZE, LAYER_NUM_OF_ROWS, data, header.size, &rows);
+    }
+    return frame_decode(header.encoding, frame, LAYER_FRAME_BUFFER_SIZE, NULL, data, header.size);
+}
+
+static bool anim_play(char const * name, unsigned char const * frames, unsigned int count, size_t size)
+{
+    static unsigned char canvas[LAYER_FRAME_BUFFER_SIZE];
+    struct animation_header header;
+    unsigned long long worst = 0;
+
+    memcpy(&header, anim_store, ANIM_HEADER_SIZE);
+    unsigned char const * end = anim_store + ANIM_HEADER_SIZE + header.size;
+    unsigned long long start = anim_time_ns();
+    unsigned long long start_cycles = anim_cycles();
+    for (unsigned int r = 0; r < anim_config.repeat; ++r) {
+        unsigned char const * cursor = anim_store + ANIM_HEADER_SIZE;
+        for (unsigned int i = 0; i < count; ++i) {
+            unsigned long long frame_start = anim_time_ns();
+            if (!anim_decode(&cursor, end, canvas)) {
+                fprintf(stderr, "%s: failed to decode frame %u\n", name, i);
+                return false;
+            }
+
+            unsigned long long frame_time = anim_time_ns() - frame_start;
+            if (frame_time > worst)
+                worst = frame_time;
+            if (memcmp(canvas, frames + i * LAYER_FRAME_BUFFER_SIZE, LAYER_FRAME_BUFFER_SIZE)) {
+                fprintf(stderr, "%s: frame %u differs after decoding\n", name, i);
+                return false;
+            }
+        }
+    }
+
+    unsigned long long decoded = (unsigned long long)count * anim_config.repeat;
+    unsigned long long total = anim_time_ns() - start;
+    printf("%-10s %8u %8zu %8.2f %10.1f %10.0f %10.1f\n", name, count, size,
+        (double)(count * LAYER_FRAME_BUFFER_SIZE) / (size - ANIM_HEADER_SIZE),
+        decoded ? (double)total / decoded : 0.0,
+        decoded ? (double)(anim_cycles() - start_cycles) / decoded : 0.0,
+        worst / 1000.0);
+    return true;
+}
+
+static bool anim_write(char const * path, size_t size)
+{
+    // Padded to whole rows of erased flash, since the store is written row by row
+    size_t rows = (size + ANIM_ROW_SIZE - 1) / ANIM_ROW_SIZE;
+    FILE * file = fopen(path, "wb");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+
+    bool ok = fwrite(anim_store, ANIM_ROW_SIZE, rows, file) == rows;
+    ok &= fclose(file) == 0;
+    if (!ok)
+        fprintf(stderr, "%s: failed to write the store image\n", path);
+    else
+        printf("wrote %zu rows of %u bytes to %s\n", rows, ANIM_ROW_SIZE, path);
+    return ok;
+}
+
+static bool anim_run(char const * name, unsigned char const * frames, unsigned int count, char const * output)
+{
+    size_t size;
+    if (!anim_pack(frames, count, &size)) {
+        fprintf(stderr, "%s: %u frames don't fit in the store of %u bytes\n", name, count, ANIM_STORE_SIZE);
+        return false;
+    }
+    if (!anim_play(name, frames, count, size))
+        return false;
+    return output == NULL || anim_write(output, size);
+}
+
+static unsigned char * anim_read(char const * path, unsigned int * count)
+{
+    FILE * file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    unsigned char * frames = NULL;
+    size_t read = 0;
+    for (;;) {
+        unsigned char * grown = realloc(frames, (read + 1) * LAYER_FRAME_BUFFER_SIZE);
+        if (grown == NULL)
+            break;
+        frames = grown;
+        if (fread(frames + read * LAYER_FRAME_BUFFER_SIZE, LAYER_FRAME_BUFFER_SIZE, 1, file) != 1)
+            break;
+        read++;
+    }
+    fclose(file);
+
+    if (!read || read > UINT16_MAX) {
+        fprintf(stderr, "%s: expected 1 to %u frames of %u bytes\n", path, UINT16_MAX, LAYER_FRAME_BUFFER_SIZE);
+        free(frames);
+        return NULL;
+    }
+    *count = read;
+    return frames;
+}
+
+static void anim_usage(char const * name)
+{
+    printf("usage: %s [options]\n"
+        "  -i <file>        raw frames to pack, %u bytes each in the layout of the layer canvas\n"
+        "                   (default: the generated content)\n"
+        "  -o <file>        store image to write, requires -i\n"
+        "  -f <frames>      frames of the generated content (default %u)\n"
+        "  -p <period>      frame period in milliseconds (default %u)\n"
+        "  -r <repeat>      times the animation is played back, 0 to only pack (default %u)\n",
+        name, LAYER_FRAME_BUFFER_SIZE, anim_config.frames, anim_config.period, anim_config.repeat);
+}
+
+int main(int argc, char ** argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:o:f:p:r:h")) != -1) {
+        switch (opt) {
+            case 'i': anim_config.input = optarg;                           break;
+            case 'o': anim_config.output = optarg;                          break;
+            case 'f': anim_config.frames = strtoul(optarg, NULL, 0);        break;
+            case 'p': anim_config.period = strtoul(optarg, NULL, 0);        break;
+            case 'r': anim_config.repeat = strtoul(optarg, NULL, 0);        break;
+            case 'h':
+                anim_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                anim_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (!anim_config.period || anim_config.period > UINT16_MAX || !anim_config.frames || anim_config.frames > UINT16_MAX
+        || (anim_config.output != NULL && anim_config.input == NULL)) {
+        anim_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bool ok = true;
+    printf("%-10s %8s %8s %8s %10s %10s %10s\n", "content", "frames", "bytes", "ratio", "ns/frame", "cyc/frame", "worst[us]");
+    if (anim_config.input != NULL) {
+        unsigned int count;
+        unsigned char * frames = anim_read(anim_config.input, &count);
+        ok = frames != NULL && anim_run(anim_config.input, frames, count, anim_config.output);
+        free(frames);
+    } else {
+        unsigned char * frames = malloc(anim_config.frames * LAYER_FRAME_BUFFER_SIZE);
+        for (unsigned int i = 0; frames != NULL && i < sizeof(anim_contents) / sizeof(anim_contents[0]); ++i) {
+            for (unsigned int f = 0; f < anim_config.frames; ++f)
+                anim_contents[i].generate(frames + f * LAYER_FRAME_BUFFER_SIZE, f);
+            ok &= anim_run(anim_contents[i].name, frames, anim_config.frames, NULL);
+        }
+        ok &= frames != NULL;
+        free(frames);
+    }
+    printf("the store holds %u bytes, one frame is due every %u ms\n", ANIM_STORE_SIZE, anim_config.period);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
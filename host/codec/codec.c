@@ -0,0 +1,451 @@
+#define _GNU_SOURCE
+#include "frame_encode.h"
+#include <app/frame_codec.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CODEC_HAVE_TSC
+#endif
+
+// Round trip test and decode benchmark of the compressed frame ingest. Frame
+// sequences of typical content are encoded with every encoding, decoded with
+// the firmware's decoder and compared. The decoder is also fed random data to
+// check that it never writes outside of the frame.
+
+#define CODEC_NUM_OF_ROWS       16
+#define CODEC_NUM_OF_COLS       16
+#define CODEC_NUM_OF_LEDS       (CODEC_NUM_OF_ROWS * CODEC_NUM_OF_COLS)
+#define CODEC_NUM_OF_CHANNELS   (CODEC_NUM_OF_LEDS * 3) // Planar RGB, see layer.c
+#define CODEC_FRAME_MAX_SIZE    (CODEC_NUM_OF_CHANNELS * 3 / 2) // 12 bit color depth
+#define CODEC_MAX_VALUE         0xfff
+#define CODEC_GUARD_SIZE        64
+#define CODEC_GUARD_BYTE        0xa5
+#define CODEC_FUZZ_SIZE         1024
+
+struct codec_config
+{
+    unsigned int frames;        // Frames per content sequence
+    unsigned int repeat;        // Times every sequence is decoded for the benchmark
+    unsigned int fuzz;          // Number of random payloads for the decoder
+    unsigned int depth;         // Color depth of the frames, 8 or 12 bit
+    unsigned long long seed;
+};
+
+struct codec_content
+{
+    char const * name;
+    void (*generate)(unsigned short * frame, unsigned int index); // Generates 12 bit values
+};
+
+enum codec_method
+{
+    CODEC_METHOD_RAW = 0,
+    CODEC_METHOD_RLE,
+    CODEC_METHOD_DELTA,
+    CODEC_METHOD_PALETTE,       // Palette or palette load, whatever is needed
+    CODEC_METHOD_ROWS,          // Changed rows, or the raw frame if that is smaller
+    CODEC_METHOD_BEST,          // Smallest of all encodings per frame
+
+    CODEC_METHOD_COUNT,
+};
+
+static struct codec_config codec_config =
+{
+    .frames = 256,
+    .repeat = 20,
+    .fuzz = 100000,
+    .depth = 8,
+    .seed = 1,
+};
+
+static unsigned long long codec_random_state;
+static unsigned int codec_frame_size;
+
+static unsigned long long codec_random(void)
+{
+    // xorshift64*, reproducible across hosts
+    codec_random_state ^= codec_random_state >> 12;
+    codec_random_state ^= codec_random_state << 25;
+    codec_random_state ^= codec_random_state >> 27;
+    return codec_random_state * 0x2545f4914f6cdd1dLLU;
+}
+
+static unsigned long long codec_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+}
+
+static unsigned long long codec_cycles(void)
+{
+#ifdef CODEC_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void codec_set_pixel(unsigned short * frame, unsigned int x, unsigned int y, unsigned short r, unsigned short g, unsigned short b)
+{
+    unsigned int pos = (x % CODEC_NUM_OF_COLS) + (y % CODEC_NUM_OF_ROWS) * CODEC_NUM_OF_COLS;
+    frame[pos + CODEC_NUM_OF_LEDS * 0] = r;
+    frame[pos + CODEC_NUM_OF_LEDS * 1] = g;
+    frame[pos + CODEC_NUM_OF_LEDS * 2] = b;
+}
+
+// Content
+
+static void codec_content_blank(unsigned short * frame, unsigned int index)
+{
+    (void)index;
+    memset(frame, 0, CODEC_NUM_OF_CHANNELS * sizeof(*frame));
+}
+
+static void codec_content_fade(unsigned short * frame, unsigned int index)
+{
+    // Whole layer in a single color that slowly changes
+    for (unsigned int i = 0; i < CODEC_NUM_OF_LEDS; ++i)
+        codec_set_pixel(frame, i, i / CODEC_NUM_OF_COLS, (index * 16) & CODEC_MAX_VALUE, (index * 48) & CODEC_MAX_VALUE, 0x400);
+}
+
+static void codec_content_dots(unsigned short * frame, unsigned int index)
+{
+    // A few dots moving over a black background
+    codec_content_blank(frame, index);
+    for (unsigned int i = 0; i < 4; ++i)
+        codec_set_pixel(frame, index + i * 5, index / 2 + i * 3, 0xfff, 0x800 * (i & 1), 0x200 * i);
+}
+
+static void codec_content_sprite(unsigned short * frame, unsigned int index)
+{
+    // A 4x4 block moving over a static background
+    for (unsigned int y = 0; y < CODEC_NUM_OF_ROWS; ++y)
+        for (unsigned int x = 0; x < CODEC_NUM_OF_COLS; ++x)
+            codec_set_pixel(frame, x, y, y < 8 ? 0x100 : 0, 0, y < 8 ? 0 : 0x300);
+    for (unsigned int y = 0; y < 4; ++y)
+        for (unsigned int x = 0; x < 4; ++x)
+            codec_set_pixel(frame, index / 4 + x, 6 + y, 0xfff, 0xc00, 0x000);
+}
+
+static void codec_content_ticker(unsigned short * frame, unsigned int index)
+{
+    // Scrolling line of text over a static background, only the rows of the line change
+    for (unsigned int y = 0; y < CODEC_NUM_OF_ROWS; ++y)
+        for (unsigned int x = 0; x < CODEC_NUM_OF_COLS; ++x)
+            codec_set_pixel(frame, x, y, 0, 0x100, 0x200);
+    for (unsigned int y = 0; y < 5; ++y) {
+        for (unsigned int x = 0; x < CODEC_NUM_OF_COLS; ++x) {
+            unsigned int column = (x + index) * 2654435761U >> 27; // Pseudo random glyph columns
+            if (column & (1U << y))
+                codec_set_pixel(frame, x, 5 + y, 0xfff, 0x100, 0x200);
+        }
+    }
+}
+
+static void codec_content_plasma(unsigned short * frame, unsigned int index)
+{
+    // Smooth animation that changes every pixel on every frame
+    for (unsigned int y = 0; y < CODEC_NUM_OF_ROWS; ++y) {
+        for (unsigned int x = 0; x < CODEC_NUM_OF_COLS; ++x) {
+            double v = sin(x * 0.4 + index * 0.1) + sin(y * 0.3 - index * 0.07) + sin((x + y) * 0.25 + index * 0.05);
+            codec_set_pixel(frame, x, y,
+                (unsigned short)(2047.5 + 682.5 * v),
+                (unsigned short)(2047.5 + 2047.5 * sin(v + 2.0)),
+                (unsigned short)(2047.5 - 682.5 * v));
+        }
+    }
+}
+
+static void codec_content_mosaic(unsigned short * frame, unsigned int index)
+{
+    // Every pixel changes on every frame, but only a few colors are used
+    static unsigned short const colors[8][3] =
+    {
+        { 0x000, 0x000, 0x000 }, { 0xfff, 0x000, 0x000 }, { 0x000, 0xfff, 0x000 }, { 0x000, 0x000, 0xfff },
+        { 0xfff, 0xfff, 0x000 }, { 0x000, 0xfff, 0xfff }, { 0xfff, 0x000, 0xfff }, { 0xfff, 0xfff, 0xfff },
+    };
+
+    (void)index;
+    for (unsigned int y = 0; y < CODEC_NUM_OF_ROWS; ++y) {
+        for (unsigned int x = 0; x < CODEC_NUM_OF_COLS; ++x) {
+            unsigned short const * color = colors[codec_random() % 8];
+            codec_set_pixel(frame, x, y, color[0], color[1], color[2]);
+        }
+    }
+}
+
+static void codec_content_noise(unsigned short * frame, unsigned int index)
+{
+    (void)index;
+    for (unsigned int i = 0; i < CODEC_NUM_OF_CHANNELS; ++i)
+        frame[i] = (unsigned short)(codec_random() & CODEC_MAX_VALUE);
+}
+
+static void codec_convert(unsigned char * frame, unsigned short const * values)
+{
+    // Into the color depth of the layer, see enum layer_color_depth
+    if (codec_config.depth == 8) {
+        for (unsigned int i = 0; i < CODEC_NUM_OF_CHANNELS; ++i)
+            frame[i] = (unsigned char)(values[i] >> 4);
+        return;
+    }
+
+    for (unsigned int i = 0; i < CODEC_NUM_OF_CHANNELS; i += 2, frame += 3) {
+        frame[0] = (unsigned char)(values[i] >> 4);
+        frame[1] = (unsigned char)((values[i] & 0x0f) << 4 | values[i + 1] >> 8);
+        frame[2] = (unsigned char)(values[i + 1] & 0xff);
+    }
+}
+
+static struct codec_content const codec_contents[] =
+{
+    { "blank",  codec_content_blank },
+    { "fade",   codec_content_fade },
+    { "dots",   codec_content_dots },
+    { "sprite", codec_content_sprite },
+    { "ticker", codec_content_ticker },
+    { "plasma", codec_content_plasma },
+    { "mosaic", codec_content_mosaic },
+    { "noise",  codec_content_noise },
+};
+
+// Test
+
+static void codec_fail(char const * content, char const * encoding, unsigned int index, char const * reason)
+{
+    fprintf(stderr, "%s: %s frame %u: %s\n", content, encoding, index, reason);
+    exit(EXIT_FAILURE);
+}
+
+static char const * codec_method_name(enum codec_method method)
+{
+    static char const * const names[] = { "raw", "rle", "delta", "palette", "rows", "best" };
+    return names[method];
+}
+
+static bool codec_decode(
+    enum frame_encoding encoding,
+    unsigned char * frame,
+    struct frame_palette * palette,
+    unsigned char const * data,
+    size_t size)
+{
+    // Same as the framed ingest of layer.c
+    struct frame_rows rows;
+    return (encoding == FRAME_ENCODING_ROWS)
+        ? frame_decode_rows(frame, codec_frame_size, CODEC_NUM_OF_ROWS, data, size, &rows)
+        : frame_decode(encoding, frame, codec_frame_size, palette, data, size);
+}
+
+static void codec_decode_check(
+    char const * content,
+    enum codec_method method,
+    unsigned int index,
+    unsigned char * frame,
+    struct frame_palette * palette,
+    unsigned char const * expected,
+    enum frame_encoding encoding,
+    unsigned char const * data,
+    size_t size)
+{
+    if (!codec_decode(encoding, frame, palette, data, size))
+        codec_fail(content, codec_method_name(method), index, "decode failed");
+    if (memcmp(frame, expected, codec_frame_size))
+        codec_fail(content, codec_method_name(method), index, "decoded frame differs");
+}
+
+static void codec_fuzz(void)
+{
+    unsigned char frame[CODEC_GUARD_SIZE + CODEC_FRAME_MAX_SIZE + CODEC_GUARD_SIZE];
+    unsigned char data[CODEC_FUZZ_SIZE];
+    struct frame_palette palette;
+
+    memset(frame, CODEC_GUARD_BYTE, sizeof(frame));
+    for (unsigned int i = 0; i < codec_config.fuzz; ++i) {
+        size_t size = codec_random() % sizeof(data);
+        for (size_t j = 0; j < size; ++j)
+            data[j] = (unsigned char)codec_random();
+
+        codec_decode(codec_random() % (FRAME_ENCODING_COUNT + 1), frame + CODEC_GUARD_SIZE, &palette, data, size);
+        for (unsigned int j = 0; j < CODEC_GUARD_SIZE; ++j) {
+            if (frame[j] != CODEC_GUARD_BYTE || frame[CODEC_GUARD_SIZE + codec_frame_size + j] != CODEC_GUARD_BYTE)
+                codec_fail("fuzz", "random", i, "decoder wrote outside of the frame");
+        }
+    }
+}
+
+static void codec_report_header(void)
+{
+    printf("%-8s %8s %8s %8s %8s %8s %8s %7s %10s %10s %10s %10s %10s %12s\n",
+        "content", "raw[B]", "rle[B]", "delta[B]", "pal[B]", "rows[B]", "best[B]", "ratio",
+        "rle[ns]", "delta[ns]", "pal[ns]", "rows[ns]", "best[ns]", "best[cycles]");
+}
+
+static void codec_run(struct codec_content const * content)
+{
+    unsigned int const frames = codec_config.frames;
+    size_t const stride = FRAME_ENCODE_MAX_SIZE(codec_frame_size);
+    size_t const count = (size_t)frames * CODEC_METHOD_COUNT;
+    unsigned char * source = malloc((size_t)frames * codec_frame_size);
+    unsigned char * data = malloc(count * stride);
+    size_t * size = calloc(count, sizeof(size_t));
+    enum frame_encoding * encoding = calloc(count, sizeof(enum frame_encoding));
+    unsigned short values[CODEC_NUM_OF_CHANNELS];
+    unsigned char frame[CODEC_FRAME_MAX_SIZE];
+    unsigned char zero[CODEC_FRAME_MAX_SIZE] = { 0 };
+    struct frame_encode_palette encode_palette[CODEC_METHOD_COUNT] = { 0 };
+    struct frame_palette palette;
+    unsigned long long total[CODEC_METHOD_COUNT] = { 0 };
+    double ns[CODEC_METHOD_COUNT] = { 0 };
+    double cycles = 0;
+    bool const palette_available = codec_config.depth == 8;
+
+    if (source == NULL || data == NULL || size == NULL || encoding == NULL)
+        codec_fail(content->name, "-", 0, "out of memory");
+
+    // Encode every frame with every method. The first frame has no previous frame to
+    // delta against, its delta is encoded against an all zero frame like the reference
+    // frame of the firmware after power up or a layer clear.
+    for (unsigned int i = 0; i < frames; ++i) {
+        unsigned char * f = source + (size_t)i * codec_frame_size;
+        unsigned char const * previous = i ? f - codec_frame_size : zero;
+        content->generate(values, i);
+        codec_convert(f, values);
+
+        for (enum codec_method m = 0; m < CODEC_METHOD_COUNT; ++m) {
+            size_t index = (size_t)i * CODEC_METHOD_COUNT + m;
+            unsigned char * d = data + index * stride;
+            switch (m) {
+                case CODEC_METHOD_RAW:      encoding[index] = FRAME_ENCODING_RAW;   break;
+                case CODEC_METHOD_RLE:      encoding[index] = FRAME_ENCODING_RLE;   break;
+                case CODEC_METHOD_DELTA:    encoding[index] = FRAME_ENCODING_DELTA; break;
+                default:                                                            break;
+            }
+
+            // The palette holds 8 bit colors, so it is not available for the 12 bit color depth
+            if (m == CODEC_METHOD_PALETTE)
+                size[index] = palette_available
+                    ? frame_encode_palette(&encoding[index], d, f, &encode_palette[m], codec_frame_size)
+                    : 0;
+            else if (m == CODEC_METHOD_ROWS) {
+                encoding[index] = FRAME_ENCODING_ROWS;
+                size[index] = frame_encode_rows(d, f, previous, CODEC_NUM_OF_ROWS, codec_frame_size);
+                if (!size[index]) {
+                    encoding[index] = FRAME_ENCODING_RAW;
+                    size[index] = frame_encode(FRAME_ENCODING_RAW, d, f, NULL, codec_frame_size);
+                }
+            } else if (m == CODEC_METHOD_BEST)
+                size[index] = frame_encode_best(&encoding[index], d, f, previous, CODEC_NUM_OF_ROWS,
+                    palette_available ? &encode_palette[m] : NULL, codec_frame_size);
+            else
+                size[index] = frame_encode(encoding[index], d, f, previous, codec_frame_size);
+            total[m] += size[index];
+        }
+    }
+
+    // Round trip, every method decodes into the same frames
+    for (enum codec_method m = 0; m < CODEC_METHOD_COUNT; ++m) {
+        if (m == CODEC_METHOD_PALETTE && !palette_available)
+            continue;
+
+        memset(frame, 0, sizeof(frame));
+        for (unsigned int i = 0; i < frames; ++i) {
+            size_t index = (size_t)i * CODEC_METHOD_COUNT + m;
+            codec_decode_check(content->name, m, i, frame, &palette, source + (size_t)i * codec_frame_size,
+                encoding[index], data + index * stride, size[index]);
+        }
+    }
+
+    // Benchmark the decoding of the whole sequence
+    for (enum codec_method m = CODEC_METHOD_RLE; m < CODEC_METHOD_COUNT; ++m) {
+        if (m == CODEC_METHOD_PALETTE && !palette_available)
+            continue;
+
+        unsigned long long start = codec_time_ns();
+        unsigned long long start_cycles = codec_cycles();
+        for (unsigned int r = 0; r < codec_config.repeat; ++r) {
+            for (unsigned int i = 0; i < frames; ++i) {
+                size_t index = (size_t)i * CODEC_METHOD_COUNT + m;
+                codec_decode(encoding[index], frame, &palette, data + index * stride, size[index]);
+            }
+        }
+        double decodes = (double)frames * codec_config.repeat;
+        ns[m] = (codec_time_ns() - start) / decodes;
+        if (m == CODEC_METHOD_BEST)
+            cycles = (codec_cycles() - start_cycles) / decodes;
+    }
+
+    printf("%-8s %8u %8.1f %8.1f %8.1f %8.1f %8.1f %6.1fx %10.1f %10.1f %10.1f %10.1f %10.1f %12.0f\n",
+        content->name, codec_frame_size,
+        (double)total[CODEC_METHOD_RLE] / frames,
+        (double)total[CODEC_METHOD_DELTA] / frames,
+        (double)total[CODEC_METHOD_PALETTE] / frames,
+        (double)total[CODEC_METHOD_ROWS] / frames,
+        (double)total[CODEC_METHOD_BEST] / frames,
+        (double)codec_frame_size * frames / total[CODEC_METHOD_BEST],
+        ns[CODEC_METHOD_RLE], ns[CODEC_METHOD_DELTA], ns[CODEC_METHOD_PALETTE], ns[CODEC_METHOD_ROWS],
+        ns[CODEC_METHOD_BEST], cycles);
+
+    free(encoding);
+    free(size);
+    free(data);
+    free(source);
+}
+
+static void codec_usage(char const * name)
+{
+    printf("usage: %s [options]\n"
+        "  -f <frames>      frames per content sequence (default %u)\n"
+        "  -r <repeat>      times every sequence is decoded for the benchmark (default %u)\n"
+        "  -z <count>       number of random payloads for the decoder (default %u)\n"
+        "  -c <depth>       color depth of the frames, 8 or 12 (default %u)\n"
+        "  -s <seed>        random seed (default %llu)\n",
+        name, codec_config.frames, codec_config.repeat, codec_config.fuzz, codec_config.depth, codec_config.seed);
+}
+
+int main(int argc, char ** argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:r:z:c:s:h")) != -1) {
+        switch (opt) {
+            case 'f': codec_config.frames = strtoul(optarg, NULL, 0);       break;
+            case 'r': codec_config.repeat = strtoul(optarg, NULL, 0);       break;
+            case 'z': codec_config.fuzz = strtoul(optarg, NULL, 0);         break;
+            case 'c': codec_config.depth = strtoul(optarg, NULL, 0);        break;
+            case 's': codec_config.seed = strtoull(optarg, NULL, 0);        break;
+            case 'h':
+                codec_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                codec_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (!codec_config.frames || !codec_config.repeat || !codec_config.seed
+        || (codec_config.depth != 8 && codec_config.depth != 12)) {
+        codec_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    codec_random_state = codec_config.seed;
+    codec_frame_size = (codec_config.depth == 8) ? CODEC_NUM_OF_CHANNELS : CODEC_FRAME_MAX_SIZE;
+    codec_report_header();
+    for (unsigned int i = 0; i < sizeof(codec_contents) / sizeof(codec_contents[0]); ++i) {
+        codec_run(&codec_contents[i]);
+        fflush(stdout);
+    }
+
+    codec_fuzz();
+    printf("round trip and %u random payloads OK\n", codec_config.fuzz);
+    return EXIT_SUCCESS;
+}
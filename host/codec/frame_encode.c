@@ -0,0 +1,264 @@
+#include "frame_encode.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Encoder of the run length encoding decoded by frame_decode(), see frame_codec.c
+// for the format. A repeat run is only started for at least three equal bytes,
+// a run of two would cost as much as a literal while breaking up the literal run.
+
+#define FRAME_ENCODE_REPEAT_THRESHOLD   3
+#define FRAME_ENCODE_ENTRY_SIZE         3 // RGB
+
+static size_t frame_encode_rle(unsigned char * data, unsigned char const * in, size_t size)
+{
+    unsigned char * out = data;
+    size_t literal = 0; // Start of the pending literal run
+    size_t i = 0;
+
+    while (i < size) {
+        size_t run = 1;
+        while (i + run < size && run < FRAME_RLE_REPEAT_MAX && in[i + run] == in[i])
+            run++;
+
+        if (run < FRAME_ENCODE_REPEAT_THRESHOLD && i + run < size) {
+            i += run;
+            continue;
+        }
+        if (run < FRAME_ENCODE_REPEAT_THRESHOLD)
+            i += run; // End of the frame, flush it as a literal
+
+        // Flush the pending literal run
+        while (literal < i) {
+            size_t count = i - literal;
+            if (count > FRAME_RLE_LITERAL_MAX)
+                count = FRAME_RLE_LITERAL_MAX;
+            *out++ = (unsigned char)(count - 1);
+            memcpy(out, in + literal, count);
+            out += count;
+            literal += count;
+        }
+
+        if (run >= FRAME_ENCODE_REPEAT_THRESHOLD) {
+            *out++ = (unsigned char)(0x80 + run - FRAME_RLE_REPEAT_MIN);
+            *out++ = in[i];
+            i += run;
+            literal = i;
+        }
+    }
+
+    return (size_t)(out - data);
+}
+
+size_t frame_encode(
+    enum frame_encoding encoding,
+    unsigned char * data,
+    unsigned char const * frame,
+    unsigned char const * previous,
+    size_t size)
+{
+    switch (encoding) {
+        case FRAME_ENCODING_RAW:
+            memcpy(data, frame, size);
+            return size;
+        case FRAME_ENCODING_RLE:
+            return frame_encode_rle(data, frame, size);
+        case FRAME_ENCODING_DELTA: {
+            unsigned char * delta = malloc(size);
+            if (delta == NULL)
+                abort();
+            for (size_t i = 0; i < size; ++i)
+                delta[i] = frame[i] ^ previous[i];
+            size_t result = frame_encode_rle(data, delta, size);
+            free(delta);
+            return result;
+        }
+        default:
+            abort();
+    }
+}
+
+size_t frame_encode_rows(
+    unsigned char * data,
+    unsigned char const * frame,
+    unsigned char const * previous,
+    unsigned int rows,
+    size_t size)
+{
+    size_t plane_size = size / FRAME_NUM_OF_PLANES;
+    size_t row_size = plane_size / rows;
+    unsigned int first = rows;
+    unsigned int last = 0;
+    unsigned int planes = 0;
+
+    // Smallest range of rows that holds all changes, over the planes that changed
+    for (unsigned int plane = 0; plane < FRAME_NUM_OF_PLANES; ++plane) {
+        for (unsigned int row = 0; row < rows; ++row) {
+            size_t offset = plane * plane_size + row * row_size;
+            if (!memcmp(frame + offset, previous + offset, row_size))
+                continue;
+            planes |= FRAME_PLANE(plane);
+            if (row < first)
+                first = row;
+            if (row > last)
+                last = row;
+        }
+    }
+
+    // Nothing changed, a single row of one plane is the smallest update
+    if (planes == 0) {
+        planes = FRAME_PLANE(0);
+        first = last = 0;
+    }
+
+    struct frame_rows header =
+    {
+        .first = (uint8_t)first,
+        .count = (uint8_t)(last - first),
+        .planes = (uint8_t)planes,
+    };
+    size_t rows_size = (last - first + 1) * row_size;
+    unsigned char * out = data;
+
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (unsigned int plane = 0; plane < FRAME_NUM_OF_PLANES; ++plane) {
+        if (planes & FRAME_PLANE(plane)) {
+            memcpy(out, frame + plane * plane_size + first * row_size, rows_size);
+            out += rows_size;
+        }
+    }
+
+    size_t result = (size_t)(out - data);
+    return (result < size) ? result : 0;
+}
+
+static bool frame_encode_indices(
+    unsigned char * indices,
+    unsigned char const * frame,
+    struct frame_encode_palette * palette,
+    size_t pixels)
+{
+    for (size_t i = 0; i < pixels; ++i) {
+        unsigned char r = frame[i];
+        unsigned char g = frame[i + pixels];
+        unsigned char b = frame[i + pixels * 2];
+        unsigned int entry = 0;
+
+        while (entry < palette->entries && (palette->palette.red[entry] != r
+            || palette->palette.green[entry] != g || palette->palette.blue[entry] != b))
+            entry++;
+
+        if (entry == palette->entries) {
+            if (entry == FRAME_PALETTE_SIZE)
+                return false;
+            palette->palette.red[entry] = r;
+            palette->palette.green[entry] = g;
+            palette->palette.blue[entry] = b;
+            palette->entries++;
+        }
+        indices[i] = (unsigned char)entry;
+    }
+
+    return true;
+}
+
+size_t frame_encode_palette(
+    enum frame_encoding * encoding,
+    unsigned char * data,
+    unsigned char const * frame,
+    struct frame_encode_palette * palette,
+    size_t size)
+{
+    size_t pixels = size / FRAME_ENCODE_ENTRY_SIZE;
+    unsigned char * indices = malloc(pixels);
+    if (indices == NULL)
+        abort();
+
+    // A layer has no more pixels than palette entries, so starting from
+    // an empty palette always succeeds
+    unsigned int first = palette->entries;
+    if (!frame_encode_indices(indices, frame, palette, pixels)) {
+        palette->entries = first = 0;
+        frame_encode_indices(indices, frame, palette, pixels);
+    }
+
+    unsigned char * out = data;
+    if (palette->entries == first)
+        *encoding = FRAME_ENCODING_PALETTE;
+    else {
+        struct frame_palette_load load =
+        {
+            .first = (uint8_t)first,
+            .count = (uint8_t)(palette->entries - first - 1),
+        };
+
+        *encoding = FRAME_ENCODING_PALETTE_LOAD;
+        memcpy(out, &load, sizeof(load));
+        out += sizeof(load);
+        for (unsigned int i = first; i < palette->entries; ++i) {
+            *out++ = palette->palette.red[i];
+            *out++ = palette->palette.green[i];
+            *out++ = palette->palette.blue[i];
+        }
+    }
+
+    memcpy(out, indices, pixels);
+    out += pixels;
+    free(indices);
+    return (size_t)(out - data);
+}
+
+size_t frame_encode_best(
+    enum frame_encoding * encoding,
+    unsigned char * data,
+    unsigned char const * frame,
+    unsigned char const * previous,
+    unsigned int rows,
+    struct frame_encode_palette * palette,
+    size_t size)
+{
+    unsigned char * candidate = malloc(FRAME_ENCODE_MAX_SIZE(size));
+    if (candidate == NULL)
+        abort();
+
+    size_t best = frame_encode(FRAME_ENCODING_RAW, data, frame, NULL, size);
+    *encoding = FRAME_ENCODING_RAW;
+    for (enum frame_encoding e = FRAME_ENCODING_RLE; e < FRAME_ENCODING_COUNT; ++e) {
+        if (e == FRAME_ENCODING_DELTA && previous == NULL)
+            continue;
+        if (e == FRAME_ENCODING_PALETTE || e == FRAME_ENCODING_PALETTE_LOAD || e == FRAME_ENCODING_ROWS)
+            continue;
+
+        size_t result = frame_encode(e, candidate, frame, previous, size);
+        if (result < best) {
+            memcpy(data, candidate, result);
+            best = result;
+            *encoding = e;
+        }
+    }
+
+    if (previous != NULL && rows) {
+        size_t result = frame_encode_rows(candidate, frame, previous, rows, size);
+        if (result && result < best) {
+            memcpy(data, candidate, result);
+            best = result;
+            *encoding = FRAME_ENCODING_ROWS;
+        }
+    }
+
+    // Only keep the palette changes if the palette is used
+    if (palette != NULL) {
+        struct frame_encode_palette next = *palette;
+        enum frame_encoding e;
+        size_t result = frame_encode_palette(&e, candidate, frame, &next, size);
+        if (result < best) {
+            memcpy(data, candidate, result);
+            best = result;
+            *encoding = e;
+            *palette = next;
+        }
+    }
+
+    free(candidate);
+    return best;
+}
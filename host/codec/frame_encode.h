@@ -0,0 +1,60 @@
+#ifndef FRAME_ENCODE_H
+#define FRAME_ENCODE_H
+
+#include <app/frame_codec.h>
+#include <stddef.h>
+
+// Worst case size of the encoded data of any encoding. Literal runs add one byte per
+// FRAME_RLE_LITERAL_MAX bytes, a palette load adds an entry per pixel and its header.
+#define FRAME_ENCODE_MAX_SIZE(size) ((size) + (size) / 3 + ((size) + FRAME_RLE_LITERAL_MAX - 1) / FRAME_RLE_LITERAL_MAX + 2)
+
+// Encodes the frame with the raw, RLE or delta encoding into data, which must hold
+// FRAME_ENCODE_MAX_SIZE(size) bytes. The previous frame is only used for the delta
+// encoding. Returns the encoded size.
+size_t frame_encode(
+    enum frame_encoding encoding,
+    unsigned char * data,
+    unsigned char const * frame,
+    unsigned char const * previous,
+    size_t size);
+
+// Encodes the rows that differ from the previous frame with the rows encoding. The
+// frame has the given number of rows per plane. Returns the encoded size, or 0 if
+// the rows encoding is not smaller than the raw frame.
+size_t frame_encode_rows(
+    unsigned char * data,
+    unsigned char const * frame,
+    unsigned char const * previous,
+    unsigned int rows,
+    size_t size);
+
+struct frame_encode_palette
+{
+    struct frame_palette palette; // Mirror of the palette of the decoder
+    unsigned int entries; // Number of entries in use
+};
+
+// Encodes the frame with one of the palette encodings, colors that are not in the
+// palette yet are loaded with the frame. The palette is rebuilt from scratch when
+// it is full, and updated to mirror the decoder after decoding the data.
+size_t frame_encode_palette(
+    enum frame_encoding * encoding,
+    unsigned char * data,
+    unsigned char const * frame,
+    struct frame_encode_palette * palette,
+    size_t size);
+
+// Encodes the frame with the encoding that yields the smallest data, which is never
+// larger than the raw frame. Previous may be NULL if there is no previous frame and
+// palette may be NULL to not use the palette encodings. Rows is the number of rows
+// per plane for the rows encoding, or 0 to not use it.
+size_t frame_encode_best(
+    enum frame_encoding * encoding,
+    unsigned char * data,
+    unsigned char const * frame,
+    unsigned char const * previous,
+    unsigned int rows,
+    struct frame_encode_palette * palette,
+    size_t size);
+
+#endif /* FRAME_ENCODE_H */
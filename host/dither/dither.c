@@ -0,0 +1,236 @@
+#define _GNU_SOURCE
+#include <app/dither.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DITHER_HAVE_TSC
+#endif
+
+// Model of the temporal dithering, see layer.c. Every 8 bit input is mapped
+// through a lookup table with 4 fractional bits, the integer part is packed
+// into a row and the fraction dithered over the scan cycles with the firmware's
+// dither_row. The time averaged output of every channel must equal its target
+// exactly, for any scan cycle the averaging starts at.
+
+#define DITHER_NUM_OF_COLS          16
+#define DITHER_ROW_CHANNELS         (DITHER_NUM_OF_COLS * 3) // Three TLC5940s per row
+#define DITHER_ROW_SIZE             (DITHER_ROW_CHANNELS * 3 / 2)
+#define DITHER_LUT_SIZE             256
+#define DITHER_MAX_VALUE            0xfff
+#define DITHER_SCALE(value)         ((value) << DITHER_FRACTION_BITS)
+
+struct dither_config
+{
+    unsigned int cycles;        // Scan cycles to average over, multiple of DITHER_PHASES
+    unsigned int repeat;        // Times a row is dithered for the benchmark
+    double gamma;
+};
+
+struct dither_lut
+{
+    char const * name;
+    unsigned short values[DITHER_LUT_SIZE]; // 12.4 fixed point, like layer_lut
+};
+
+static struct dither_config dither_config =
+{
+    .cycles = 4 * DITHER_PHASES,
+    .repeat = 1000000,
+    .gamma = 2.2,
+};
+
+static unsigned long long dither_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+}
+
+static unsigned long long dither_cycles(void)
+{
+#ifdef DITHER_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void dither_pack(unsigned char * row, unsigned int channel, unsigned int value)
+{
+    // Same layout as tlc5940_pack
+    unsigned char * p = row + (channel >> 1) * 3;
+    if (channel & 1) {
+        p[1] = (p[1] & 0xf0) | (value >> 8);
+        p[2] = value & 0xff;
+    } else {
+        p[0] = value >> 4;
+        p[1] = (p[1] & 0x0f) | ((value & 0x0f) << 4);
+    }
+}
+
+static unsigned int dither_unpack(unsigned char const * row, unsigned int channel)
+{
+    unsigned char const * p = row + (channel >> 1) * 3;
+    return (channel & 1)
+        ? (p[1] & 0x0f) << 8 | p[2]
+        : p[0] << 4 | p[1] >> 4;
+}
+
+static void dither_lut_linear(struct dither_lut * lut)
+{
+    // Same scaling as layer_lut_reset, so there is no fraction to dither
+    lut->name = "linear";
+    for (unsigned int i = 0; i < DITHER_LUT_SIZE; ++i)
+        lut->values[i] = DITHER_SCALE((i * DITHER_MAX_VALUE + 127) / 255);
+}
+
+static void dither_lut_gamma(struct dither_lut * lut)
+{
+    lut->name = "gamma";
+    for (unsigned int i = 0; i < DITHER_LUT_SIZE; ++i)
+        lut->values[i] = (unsigned short)lround(pow(i / 255.0, dither_config.gamma) * DITHER_SCALE(DITHER_MAX_VALUE));
+}
+
+static unsigned int dither_distinct(unsigned int const * levels, unsigned int count)
+{
+    unsigned int distinct = 1;
+    for (unsigned int i = 1; i < count; ++i)
+        distinct += levels[i] != levels[i - 1];
+    return distinct;
+}
+
+static bool dither_run(struct dither_lut const * lut)
+{
+    unsigned char source[DITHER_ROW_SIZE];
+    unsigned char fractions[DITHER_FRACTION_SIZE(DITHER_ROW_CHANNELS)];
+    unsigned char row[DITHER_ROW_SIZE];
+    unsigned int rounded[DITHER_LUT_SIZE];
+    unsigned int dithered[DITHER_LUT_SIZE];
+    double round_error = 0;
+    double dither_error = 0;
+    bool ok = true;
+
+    // Every input is placed on a different channel of a row in turn, so all channel offsets are covered
+    for (unsigned int base = 0; base < DITHER_LUT_SIZE; base += DITHER_ROW_CHANNELS) {
+        for (unsigned int channel = 0; channel < DITHER_ROW_CHANNELS; ++channel) {
+            unsigned short value = lut->values[(base + channel) % DITHER_LUT_SIZE];
+            dither_pack(source, channel, value >> DITHER_FRACTION_BITS);
+            dither_set_fraction(fractions, channel, value);
+        }
+
+        // Averaging starts at every phase, the result must not depend on it
+        for (unsigned int start = 0; start < DITHER_PHASES; ++start) {
+            unsigned int sum[DITHER_ROW_CHANNELS] = {0};
+            for (unsigned int cycle = 0; cycle < dither_config.cycles; ++cycle) {
+                dither_row(row, source, fractions, DITHER_ROW_CHANNELS, start + cycle);
+                for (unsigned int channel = 0; channel < DITHER_ROW_CHANNELS; ++channel)
+                    sum[channel] += dither_unpack(row, channel);
+            }
+
+            for (unsigned int channel = 0; channel < DITHER_ROW_CHANNELS && base + channel < DITHER_LUT_SIZE; ++channel) {
+                unsigned int index = base + channel;
+                unsigned int target = lut->values[index];
+                unsigned int average = sum[channel] * DITHER_PHASES / dither_config.cycles; // 12.4 fixed point
+
+                if (average != target) {
+                    fprintf(stderr, "%s: input %u averages to %.4f instead of %.4f, starting at phase %u\n",
+                        lut->name, index, average / (double)DITHER_PHASES, target / (double)DITHER_PHASES, start);
+                    ok = false;
+                }
+                if (start)
+                    continue;
+
+                rounded[index] = (target + DITHER_PHASES / 2) >> DITHER_FRACTION_BITS;
+                dithered[index] = average;
+                round_error = fmax(round_error, fabs(rounded[index] - target / (double)DITHER_PHASES));
+                dither_error = fmax(dither_error, fabs((average - (double)target) / DITHER_PHASES));
+            }
+        }
+    }
+
+    printf("%-8s %10u %10u %12.4f %12.4f\n", lut->name,
+        dither_distinct(rounded, DITHER_LUT_SIZE), dither_distinct(dithered, DITHER_LUT_SIZE),
+        round_error, dither_error);
+    return ok;
+}
+
+static void dither_bench(void)
+{
+    unsigned char source[DITHER_ROW_SIZE];
+    unsigned char fractions[DITHER_FRACTION_SIZE(DITHER_ROW_CHANNELS)];
+    unsigned char row[DITHER_ROW_SIZE];
+
+    for (unsigned int i = 0; i < DITHER_ROW_SIZE; ++i)
+        source[i] = (unsigned char)(i * 37);
+    for (unsigned int i = 0; i < sizeof(fractions); ++i)
+        fractions[i] = (unsigned char)(i * 91);
+
+    unsigned long long start = dither_time_ns();
+    unsigned long long start_cycles = dither_cycles();
+    for (unsigned int r = 0; r < dither_config.repeat; ++r) {
+        dither_row(row, source, fractions, DITHER_ROW_CHANNELS, r);
+        __asm__ volatile("" : : "r"(row) : "memory"); // Keep the row from being optimized away
+    }
+
+    printf("dither_row: %.1f ns, %.0f cycles per row of %u channels\n",
+        (double)(dither_time_ns() - start) / dither_config.repeat,
+        (double)(dither_cycles() - start_cycles) / dither_config.repeat,
+        DITHER_ROW_CHANNELS);
+}
+
+static void dither_usage(char const * name)
+{
+    printf("usage: %s [options]\n"
+        "  -n <cycles>      scan cycles to average over, multiple of %u (default %u)\n"
+        "  -r <repeat>      times a row is dithered for the benchmark, 0 to skip (default %u)\n"
+        "  -g <gamma>       gamma of the corrected lookup table (default %.1f)\n",
+        name, DITHER_PHASES, dither_config.cycles, dither_config.repeat, dither_config.gamma);
+}
+
+int main(int argc, char ** argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:r:g:h")) != -1) {
+        switch (opt) {
+            case 'n': dither_config.cycles = strtoul(optarg, NULL, 0);      break;
+            case 'r': dither_config.repeat = strtoul(optarg, NULL, 0);      break;
+            case 'g': dither_config.gamma = strtod(optarg, NULL);           break;
+            case 'h':
+                dither_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                dither_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (!dither_config.cycles || dither_config.cycles % DITHER_PHASES || dither_config.gamma <= 0) {
+        dither_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    struct dither_lut luts[2];
+    bool ok = true;
+
+    dither_lut_linear(&luts[0]);
+    dither_lut_gamma(&luts[1]);
+    printf("%-8s %10s %10s %12s %12s\n", "lut", "rounded", "dithered", "round err", "dither err");
+    for (unsigned int i = 0; i < sizeof(luts) / sizeof(luts[0]); ++i)
+        ok &= dither_run(&luts[i]);
+
+    if (dither_config.repeat)
+        dither_bench();
+
+    if (!ok)
+        return EXIT_FAILURE;
+    printf("time averaged output matches the lookup tables over %u scan cycles\n", dither_config.cycles);
+    return EXIT_SUCCESS;
+}
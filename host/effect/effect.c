@@ -0,0 +1,233 @@
+#define _GNU_SOURCE
+#include <app/effect.h>
+#include <app/swar.h>
+#include <app/tlc5940_config.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define EFFECT_HAVE_TSC
+#endif
+
+// Checks the word wise byte arithmetic of swar.h against plain byte arithmetic and
+// benchmarks the firmware's effects, which are rendered once every scan cycle. The
+// layer canvas and the other firmware dependencies of effect.c are stubbed.
+
+#define BENCH_SCAN_PERIOD           (LAYER_NUM_OF_ROWS * TLC5940_GSCLK_PERIOD) // In microseconds
+#define BENCH_LANE(word, lane)      (((word) >> ((lane) * 8)) & 0xff)
+
+struct bench_config
+{
+    unsigned int words;         // Random words the SWAR operations are checked with
+    unsigned int frames;        // Frames rendered per effect for the benchmark
+    unsigned char speed;
+    unsigned char address;      // Bus address of the simulated layer
+};
+
+struct bench_effect
+{
+    char const * name;
+    enum effect_type type;
+    unsigned char param;
+};
+
+static struct bench_config bench_config =
+{
+    .words = 1000000,
+    .frames = 10000,
+    .speed = 16,
+    .address = 3,
+};
+
+static struct bench_effect const bench_effects[] =
+{
+    { "plasma", EFFECT_PLASMA, 0 },
+    { "fire", EFFECT_FIRE, 0 },
+    { "gradient", EFFECT_GRADIENT, EFFECT_DIRECTION_DIAGONAL },
+    { "fade", EFFECT_FADE, 0 },
+    { "noise", EFFECT_NOISE, 0 },
+    { "noise/2", EFFECT_NOISE, 1 },
+};
+
+static unsigned char bench_canvas[LAYER_FRAME_BUFFER_SIZE] __attribute__((aligned(4)));
+static unsigned int bench_commits;
+
+unsigned int sim_core_timer(void)
+{
+    return 0;
+}
+
+unsigned char bus_address_get(void)
+{
+    return bench_config.address;
+}
+
+unsigned char * layer_canvas(void)
+{
+    return bench_canvas;
+}
+
+unsigned int layer_scan_period(void)
+{
+    return BENCH_SCAN_PERIOD;
+}
+
+bool layer_canvas_commit(bool present)
+{
+    (void)present;
+    bench_commits++;
+    return true;
+}
+
+static unsigned long long bench_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+}
+
+static unsigned long long bench_cycles(void)
+{
+#ifdef EFFECT_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint32_t bench_random(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static bool bench_check_word(char const * op, uint32_t a, uint32_t b, unsigned int arg, uint32_t result)
+{
+    for (unsigned int lane = 0; lane < SWAR_LANES; ++lane) {
+        unsigned int x = BENCH_LANE(a, lane);
+        unsigned int y = BENCH_LANE(b, lane);
+        unsigned int expected;
+
+        if (!strcmp(op, "avg"))
+            expected = (x + y) / 2;
+        else if (!strcmp(op, "add_sat"))
+            expected = (x + y > 255) ? 255 : x + y;
+        else if (!strcmp(op, "sub_sat"))
+            expected = (x > y) ? x - y : 0;
+        else if (!strcmp(op, "scale"))
+            expected = (x * arg) >> 8;
+        else
+            expected = ((x * (256 - arg)) >> 8) + ((y * arg) >> 8);
+
+        if (BENCH_LANE(result, lane) != expected) {
+            fprintf(stderr, "swar_%s(0x%08x, 0x%08x, %u): lane %u is %u instead of %u\n",
+                op, a, b, arg, lane, BENCH_LANE(result, lane), expected);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool bench_check_swar(void)
+{
+    static uint32_t const edges[] = { 0x00000000, 0xffffffff, 0x7f7f7f7f, 0x80808080, 0x01ff00fe, 0xff01fe00 };
+    unsigned int count = sizeof(edges) / sizeof(edges[0]);
+    bool ok = true;
+
+    for (unsigned int i = 0; i < count * count + bench_config.words && ok; ++i) {
+        bool edge = i < count * count;
+        uint32_t a = edge ? edges[i / count] : bench_random();
+        uint32_t b = edge ? edges[i % count] : bench_random();
+        unsigned int arg = (edge ? i : (unsigned int)rand()) % 257;
+
+        ok &= bench_check_word("avg", a, b, 0, swar_avg(a, b));
+        ok &= bench_check_word("add_sat", a, b, 0, swar_add_sat(a, b));
+        ok &= bench_check_word("sub_sat", a, b, 0, swar_sub_sat(a, b));
+        ok &= bench_check_word("scale", a, b, arg, swar_scale(a, arg));
+        ok &= bench_check_word("lerp", a, b, arg, swar_lerp(a, b, arg));
+    }
+
+    if (ok)
+        printf("swar operations match the byte arithmetic for %u random words\n", bench_config.words);
+    return ok;
+}
+
+static bool bench_run(struct bench_effect const * effect)
+{
+    if (!effect_start(effect->type, bench_config.speed, effect->param)) {
+        fprintf(stderr, "%s: failed to start\n", effect->name);
+        return false;
+    }
+
+    unsigned long long worst = 0;
+    unsigned long long start = bench_time_ns();
+    unsigned long long start_cycles = bench_cycles();
+    unsigned int sum = 0;
+    for (unsigned int i = 0; i < bench_config.frames; ++i) {
+        unsigned long long frame_start = bench_time_ns();
+        effect_render(layer_canvas());
+        layer_canvas_commit(true);
+
+        unsigned long long frame_time = bench_time_ns() - frame_start;
+        if (frame_time > worst)
+            worst = frame_time;
+        sum += bench_canvas[i % sizeof(bench_canvas)];
+    }
+
+    unsigned long long total = bench_time_ns() - start;
+    printf("%-10s %10.1f %10.0f %10.1f %10u\n", effect->name,
+        (double)total / bench_config.frames,
+        (double)(bench_cycles() - start_cycles) / bench_config.frames,
+        worst / 1000.0,
+        sum % 1000);
+    effect_stop();
+    return true;
+}
+
+static void bench_usage(char const * name)
+{
+    printf("usage: %s [options]\n"
+        "  -w <words>       random words the SWAR operations are checked with (default %u)\n"
+        "  -r <frames>      frames rendered per effect, 0 to skip the benchmark (default %u)\n"
+        "  -s <speed>       speed of the effects (default %u)\n"
+        "  -a <address>     bus address of the layer (default %u)\n",
+        name, bench_config.words, bench_config.frames, bench_config.speed, bench_config.address);
+}
+
+int main(int argc, char ** argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:r:s:a:h")) != -1) {
+        switch (opt) {
+            case 'w': bench_config.words = strtoul(optarg, NULL, 0);        break;
+            case 'r': bench_config.frames = strtoul(optarg, NULL, 0);       break;
+            case 's': bench_config.speed = strtoul(optarg, NULL, 0);        break;
+            case 'a': bench_config.address = strtoul(optarg, NULL, 0);      break;
+            case 'h':
+                bench_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                bench_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    srand(5940);
+    if (!bench_check_swar())
+        return EXIT_FAILURE;
+    if (!bench_config.frames)
+        return EXIT_SUCCESS;
+
+    bool ok = true;
+    printf("%-10s %10s %10s %10s %10s\n", "effect", "ns/frame", "cyc/frame", "worst[us]", "checksum");
+    for (unsigned int i = 0; i < sizeof(bench_effects) / sizeof(bench_effects[0]); ++i)
+        ok &= bench_run(&bench_effects[i]);
+    printf("one frame is rendered every scan cycle of %u us\n", BENCH_SCAN_PERIOD);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Estimated flash of the app: the code and data of the app objects, scaled to the code size of
+# XC32, have to fit the program memory of the linker script, less the pages of the non-volatile
+# store (see NVM_PAGE in nvm.h) which are taken from it as well. The objects are built for the
+# host, so the scale is calibrated on a release: v2.1.1 (hexfiles/app_release) takes 30660 bytes
+# of program memory, its objects take 20434 bytes built for the host as done here. It's an
+# estimate, only the linker of XC32 tells whether the app fits.
+#
+# usage: budget.sh <linker script> <scale in percent> <objects...>
+
+script=$1
+scale=$2
+shift 2
+
+length=$(sed -n 's/^ *kseg0_program_mem .*LENGTH *= *\(0x[0-9A-Fa-f]*\).*/\1/p' "$script")
+if [ -z "$length" ]; then
+    echo "no program memory in $script" >&2
+    exit 1
+fi
+
+for object in "$@"; do
+    # The pages of the store are data of the objects that define them, but aren't programmed
+    store=$(size -A "$object" | awk '$1 == ".nvm_store" { print $2 }')
+    size "$object" | awk -v store=${store:-0} 'NR > 1 { print substr($6, match($6, /[^\/]*$/)), $1 + $2 - store, store }'
+done | awk -v memory=$(( length )) -v scale=$scale '
+    {
+        flash = int($2 * scale / 100)
+        total += flash
+        store += $3
+        if (flash >= 1024)
+            printf "%-24s %6u\n", $1, flash
+    }
+    END {
+        budget = memory - store
+        printf "%-24s %6u of %u bytes (%u of program memory, less %u of store pages)\n",
+            "total", total, budget, memory, store
+        if (total > budget) {
+            printf "the app takes an estimated %u bytes more flash than the budget\n", total - budget
+            exit 1
+        }
+    }'
@@ -0,0 +1,8 @@
+#ifndef ATTRIBS_H
+#define ATTRIBS_H
+
+// Interrupt handlers are plain functions on the host, the simulator
+// calls them whenever the modelled peripheral raises its interrupt.
+#define __ISR(vector, ipl)
+
+#endif /* ATTRIBS_H */
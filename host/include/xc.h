@@ -0,0 +1,73 @@
+#ifndef XC_H
+#define XC_H
+
+// Host stand-in for the XC32 device header. It only provides the special
+// function registers used by the core modules, so these can be built as is
+// for the simulator. Registers with side effects on access are routed to
+// functions of the simulated node (see sim/node.c).
+
+#include <stdlib.h>
+
+#define Nop()               do { } while (0)
+#define _CP0_GET_COUNT()    sim_core_timer()
+
+// Registers with CLR, SET and INV registers, see ATOMIC_REG in core/util.h
+#define SIM_ATOMIC_SFR(name)    extern volatile unsigned int sim_##name[4];
+
+SIM_ATOMIC_SFR(IEC1)
+SIM_ATOMIC_SFR(IFS1)
+SIM_ATOMIC_SFR(ANSELB)
+SIM_ATOMIC_SFR(TRISB)
+SIM_ATOMIC_SFR(LATB)
+SIM_ATOMIC_SFR(PORTB)
+SIM_ATOMIC_SFR(TRISF)
+SIM_ATOMIC_SFR(LATF)
+SIM_ATOMIC_SFR(PORTF)
+SIM_ATOMIC_SFR(ANSELG)
+SIM_ATOMIC_SFR(TRISG)
+SIM_ATOMIC_SFR(LATG)
+SIM_ATOMIC_SFR(PORTG)
+
+// Writes to the CLR, SET and INV registers take effect immediately
+#define ATOMIC_REG_PTR_CLR(reg, mask)   sim_atomic_clr((volatile void *)(reg), mask)
+#define ATOMIC_REG_PTR_SET(reg, mask)   sim_atomic_set((volatile void *)(reg), mask)
+#define ATOMIC_REG_PTR_INV(reg, mask)   sim_atomic_inv((volatile void *)(reg), mask)
+
+#define IEC1                sim_IEC1[0]
+#define IFS1                sim_IFS1[0]
+#define ANSELB              sim_ANSELB[0]
+#define TRISB               sim_TRISB[0]
+#define LATB                sim_LATB[0]
+#define PORTB               sim_PORTB[0]
+#define TRISF               sim_TRISF[0]
+#define LATF                sim_LATF[0]
+#define PORTF               sim_PORTF[0]
+#define ANSELG              sim_ANSELG[0]
+#define TRISG               sim_TRISG[0]
+#define LATG                sim_LATG[0]
+#define PORTG               sim_PORTG[0]
+
+// Plain registers
+extern volatile unsigned int T5CON;
+extern volatile unsigned int IPC7;
+extern volatile unsigned int U1MODE;
+extern volatile unsigned int U1BRG;
+extern volatile unsigned int U1RXR;
+extern volatile unsigned int RPB3R;
+
+// Registers with side effects
+#define TMR5                sim_tmr5()
+#define U1STA               (*sim_uart_sta())
+#define U1TXREG             (*sim_uart_txreg())
+#define U1RXREG             sim_uart_rxreg()
+
+void sim_atomic_clr(volatile void * reg, unsigned int mask);
+void sim_atomic_set(volatile void * reg, unsigned int mask);
+void sim_atomic_inv(volatile void * reg, unsigned int mask);
+unsigned int sim_core_timer(void);
+unsigned short sim_tmr5(void);
+volatile unsigned int * sim_uart_sta(void);
+volatile unsigned int * sim_uart_txreg(void);
+unsigned int sim_uart_rxreg(void);
+
+#endif /* XC_H */
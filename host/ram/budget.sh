@@ -0,0 +1,34 @@
+#!/bin/sh
+# Static RAM budget of the app: the data and bss of the app objects have to fit the data memory of
+# the linker script, less the stack it reserves and a reserve for the runtime library. The objects
+# are built for the host, whose pointers take 8 bytes instead of 4, so the sum is an upper bound.
+#
+# usage: budget.sh <linker script> <reserve> <objects...>
+
+script=$1
+reserve=$2
+shift 2
+
+length=$(sed -n 's/^ *kseg1_data_mem .*LENGTH *= *\(0x[0-9A-Fa-f]*\).*/\1/p' "$script")
+stack=$(sed -n 's/^PROVIDE(_min_stack_size *= *\(0x[0-9A-Fa-f]*\)).*/\1/p' "$script")
+if [ -z "$length" ] || [ -z "$stack" ]; then
+    echo "no data memory or stack size in $script" >&2
+    exit 1
+fi
+budget=$(( length - stack - reserve ))
+
+size "$@" | awk -v budget=$budget -v memory=$(( length )) -v stack=$(( stack )) -v reserve=$reserve '
+    NR > 1 {
+        ram = $2 + $3
+        total += ram
+        if (ram >= 256)
+            printf "%-24s %6u\n", substr($6, match($6, /[^\/]*$/)), ram
+    }
+    END {
+        printf "%-24s %6u of %u bytes (%u of data memory, less %u of stack and %u of reserve)\n",
+            "total", total, budget, memory, stack, reserve
+        if (total > budget) {
+            printf "the app takes %u bytes more RAM than the budget\n", total - budget
+            exit 1
+        }
+    }'
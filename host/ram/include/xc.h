@@ -0,0 +1,51 @@
+#ifndef XC_H
+#define XC_H
+
+// Host stand-in for the XC32 device header, for the static RAM budget check (see
+// ram/budget.sh). The app is only compiled, not linked or run, so the special
+// function registers just have to exist. Add the registers of new modules here.
+
+#include <stdlib.h>
+
+#define Nop()                   do { } while (0)
+
+#define RAM_SFR(name)           extern volatile unsigned int name;
+#define RAM_SFR_PORT(port)      RAM_SFR(TRIS##port) RAM_SFR(LAT##port) RAM_SFR(PORT##port) RAM_SFR(ANSEL##port)
+
+RAM_SFR(OSCCON) RAM_SFR(INTCON) RAM_SFR(CFGCON) RAM_SFR(DEVCFG3) RAM_SFR(SYSKEY) RAM_SFR(WDTCON)
+RAM_SFR(IEC0) RAM_SFR(IEC1) RAM_SFR(IEC2) RAM_SFR(IFS0) RAM_SFR(IFS1) RAM_SFR(IFS2)
+RAM_SFR(IPC3) RAM_SFR(IPC4) RAM_SFR(IPC5) RAM_SFR(IPC6) RAM_SFR(IPC7) RAM_SFR(IPC8) RAM_SFR(IPC10) RAM_SFR(IPC11)
+RAM_SFR(T1CON) RAM_SFR(PR1) RAM_SFR(TMR1) RAM_SFR(T2CON) RAM_SFR(PR2) RAM_SFR(TMR2) RAM_SFR(T3CON) RAM_SFR(PR3) RAM_SFR(TMR3)
+RAM_SFR(T4CON) RAM_SFR(PR4) RAM_SFR(TMR4) RAM_SFR(T5CON) RAM_SFR(TMR5) RAM_SFR(OC4CON) RAM_SFR(OC4RS)
+RAM_SFR(U1MODE) RAM_SFR(U1STA) RAM_SFR(U1BRG) RAM_SFR(U1TXREG) RAM_SFR(U1RXREG)
+RAM_SFR(U1RXR) RAM_SFR(RPB3R) RAM_SFR(SDI1R) RAM_SFR(SS1R) RAM_SFR(RPG7R) RAM_SFR(RPE5R)
+RAM_SFR(SPI1CON) RAM_SFR(SPI1STAT) RAM_SFR(SPI1BUF) RAM_SFR(SPI2CON)
+RAM_SFR(DMACON) RAM_SFR(DCH0CON) RAM_SFR(DCH1CON) RAM_SFR(DCH2CON) RAM_SFR(DCH3CON)
+RAM_SFR(NVMCON) RAM_SFR(NVMKEY) RAM_SFR(NVMADDR) RAM_SFR(NVMDATA) RAM_SFR(NVMSRCADDR)
+RAM_SFR(CNCONB) RAM_SFR(CNENB) RAM_SFR(CNSTATB) RAM_SFR(CNPUB) RAM_SFR(CNCONG) RAM_SFR(CNENG)
+RAM_SFR_PORT(B) RAM_SFR_PORT(D) RAM_SFR_PORT(E) RAM_SFR_PORT(F) RAM_SFR_PORT(G)
+
+extern struct { unsigned ON:1; unsigned WDTCLR:1; } WDTCONbits;
+extern unsigned int _CP0_GET_COUNT(void);
+
+// Interrupt vectors and sources, any distinct numbers do
+#define _UART_1_VECTOR          1
+#define _TIMER_1_VECTOR         2
+#define _TIMER_3_VECTOR         3
+#define _TIMER_4_VECTOR         4
+#define _TIMER_5_VECTOR         5
+#define _CHANGE_NOTICE_VECTOR   6
+#define _DMA_0_VECTOR           7
+#define _DMA_1_VECTOR           8
+#define _DMA_2_VECTOR           9
+#define _DMA_3_VECTOR           10
+
+#define _SPI1_ERR_IRQ           1
+#define _SPI1_RX_IRQ            2
+#define _SPI1_TX_IRQ            3
+#define _SPI2_ERR_IRQ           4
+#define _SPI2_RX_IRQ            5
+#define _SPI2_TX_IRQ            6
+#define _CHANGE_NOTICE_B_IRQ    7
+
+#endif /* XC_H */
@@ -0,0 +1,208 @@
+#define _GNU_SOURCE
+#include <app/dither.h>
+#include <app/fade.h>
+#include <app/tlc5940_config.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Model of the row scan of the layer for every geometry (see layer_set_geometry), checks that
+// the scan of every number of rows and scan order drives every row once per scan cycle on the
+// pin the row map selects, and benchmarks the work of a row slot (the dithered or faded row
+// that is sent in tlc5940_update_handler) against the row period. A row slot takes a GSCLK
+// period whatever the number of rows, fewer rows only shorten the scan cycle.
+
+#define SCAN_NUM_OF_ROWS            16 // Rows of the board, LAYER_NUM_OF_ROWS
+#define SCAN_ROW_CHANNELS           (16 * TLC5940_NUM_OF_DEVICES)
+#define SCAN_ROW_SIZE               (SCAN_ROW_CHANNELS * 3 / 2)
+
+enum scan_order
+{
+    SCAN_INCREMENTAL = 0,
+    SCAN_INTERLACED = 1,
+};
+
+struct bench_config
+{
+    unsigned int repeats;       // Rows sent per geometry for the benchmark
+    unsigned int scale;         // Core clock of the host relative to the firmware's, to scale the timings
+};
+
+static struct bench_config bench_config =
+{
+    .repeats = 200000,
+    .scale = 30,
+};
+
+static unsigned char bench_row_map[SCAN_NUM_OF_ROWS];
+static unsigned char bench_scan[SCAN_NUM_OF_ROWS];
+static unsigned char bench_scan_pins[SCAN_NUM_OF_ROWS];
+
+static unsigned long long bench_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+}
+
+// Mirror of layer_scan_build
+static unsigned int bench_scan_build(unsigned int rows, enum scan_order order)
+{
+    unsigned int slot = 0;
+
+    if (order == SCAN_INTERLACED) {
+        for (unsigned int row = 1; row < rows; row += 2)
+            bench_scan[slot++] = row;
+        for (unsigned int row = 0; row < rows; row += 2)
+            bench_scan[slot++] = row;
+    } else {
+        for (unsigned int row = 0; row < rows; ++row)
+            bench_scan[slot++] = row;
+    }
+
+    for (slot = 0; slot < rows; ++slot)
+        bench_scan_pins[slot] = bench_row_map[bench_scan[slot]];
+    return rows;
+}
+
+static bool bench_check_geometry(unsigned int rows, enum scan_order order)
+{
+    unsigned int length = bench_scan_build(rows, order);
+    unsigned int driven[SCAN_NUM_OF_ROWS] = { 0 };
+
+    if (length != rows) {
+        fprintf(stderr, "%u rows: scan has %u slots\n", rows, length);
+        return false;
+    }
+
+    // Every slot drives the pin of its row, and the rows of the frame below the geometry aren't scanned
+    for (unsigned int slot = 0; slot < length; ++slot) {
+        unsigned int row = bench_scan[slot];
+        if (row >= rows || bench_scan_pins[slot] != bench_row_map[row]) {
+            fprintf(stderr, "%u rows: slot %u drives row %u on pin %u\n", rows, slot, row, bench_scan_pins[slot]);
+            return false;
+        }
+        driven[row]++;
+    }
+    for (unsigned int row = 0; row < rows; ++row) {
+        if (driven[row] != 1) {
+            fprintf(stderr, "%u rows: row %u is driven %u times per scan cycle\n", rows, row, driven[row]);
+            return false;
+        }
+    }
+
+    // Interlaced scans the odd rows before the even rows
+    if (order == SCAN_INTERLACED && rows > 1 && (bench_scan[0] != 1 || bench_scan[rows / 2] != 0)) {
+        fprintf(stderr, "%u rows: not interlaced\n", rows);
+        return false;
+    }
+
+    return true;
+}
+
+static bool bench_check(void)
+{
+    // The identity map of the board and a random one, like a panel that's wired otherwise
+    for (unsigned int map = 0; map < 2; ++map) {
+        for (unsigned int row = 0; row < SCAN_NUM_OF_ROWS; ++row)
+            bench_row_map[row] = map ? rand() % SCAN_NUM_OF_ROWS : row;
+
+        for (unsigned int rows = 1; rows <= SCAN_NUM_OF_ROWS; ++rows) {
+            if (!bench_check_geometry(rows, SCAN_INCREMENTAL) || !bench_check_geometry(rows, SCAN_INTERLACED))
+                return false;
+        }
+    }
+
+    printf("scan drives every row once per scan cycle for 1 to %u rows in both orders\n", SCAN_NUM_OF_ROWS);
+    return true;
+}
+
+static bool bench_run(void)
+{
+    static unsigned char source[SCAN_NUM_OF_ROWS][SCAN_ROW_SIZE];
+    static unsigned char fractions[SCAN_NUM_OF_ROWS][DITHER_FRACTION_SIZE(SCAN_ROW_CHANNELS)];
+    static unsigned char send[SCAN_ROW_SIZE];
+    static unsigned int const geometries[] = { 4, 8, 12, 16 };
+    bool ok = true;
+
+    for (unsigned int row = 0; row < SCAN_NUM_OF_ROWS; ++row) {
+        for (unsigned int i = 0; i < SCAN_ROW_SIZE; ++i)
+            source[row][i] = rand();
+        for (unsigned int i = 0; i < sizeof(fractions[row]); ++i)
+            fractions[row][i] = rand();
+    }
+
+    printf("%-6s %12s %12s %12s %12s %12s\n", "rows", "scan[us]", "refresh[Hz]", "dither[us]", "fade[us]", "budget[us]");
+    for (unsigned int g = 0; g < sizeof(geometries) / sizeof(geometries[0]); ++g) {
+        unsigned int rows = geometries[g];
+        unsigned int length = bench_scan_build(rows, SCAN_INTERLACED);
+        unsigned int sum = 0;
+
+        // The rows are sent in the order of the scan, as tlc5940_update_handler does
+        unsigned long long start = bench_time_ns();
+        for (unsigned int i = 0; i < bench_config.repeats; ++i) {
+            unsigned int row = bench_scan[i % length];
+            dither_row(send, source[row], fractions[row], SCAN_ROW_CHANNELS, i / length + row);
+            sum += send[i % SCAN_ROW_SIZE];
+        }
+        double dither = (double)(bench_time_ns() - start) * bench_config.scale / bench_config.repeats / 1000.0;
+
+        start = bench_time_ns();
+        for (unsigned int i = 0; i < bench_config.repeats; ++i) {
+            unsigned int row = bench_scan[i % length];
+            fade_row(send, source[row], source[(row + 1) % SCAN_NUM_OF_ROWS], SCAN_ROW_CHANNELS, i % FADE_WEIGHT_MAX);
+            sum += send[i % SCAN_ROW_SIZE];
+        }
+        double fade = (double)(bench_time_ns() - start) * bench_config.scale / bench_config.repeats / 1000.0;
+
+        // Either is done per row slot, the rest of the row period is left for the tasks
+        unsigned int scan = rows * TLC5940_GSCLK_PERIOD;
+        double worst = (dither > fade) ? dither : fade;
+        printf("%-6u %12u %12.1f %12.2f %12.2f %12.1f%s\n", rows, scan, 1e6 / scan, dither, fade,
+            TLC5940_GSCLK_PERIOD - worst, (worst < TLC5940_GSCLK_PERIOD) ? "" : "  missed");
+        ok &= worst < TLC5940_GSCLK_PERIOD;
+        if (sum == 0x5940)
+            printf("\n"); // Keeps the rows from being optimized away
+    }
+
+    printf("timings are scaled by %u to the firmware's core clock, a row slot takes %u us\n",
+        bench_config.scale, TLC5940_GSCLK_PERIOD);
+    return ok;
+}
+
+static void bench_usage(char const * name)
+{
+    printf("usage: %s [options]\n"
+        "  -r <rows>        rows sent per geometry for the benchmark, 0 to skip it (default %u)\n"
+        "  -s <scale>       core clock of the host relative to the firmware's (default %u)\n",
+        name, bench_config.repeats, bench_config.scale);
+}
+
+int main(int argc, char ** argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:s:h")) != -1) {
+        switch (opt) {
+            case 'r': bench_config.repeats = strtoul(optarg, NULL, 0);      break;
+            case 's': bench_config.scale = strtoul(optarg, NULL, 0);        break;
+            case 'h':
+                bench_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                bench_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    srand(5940);
+    if (!bench_check())
+        return EXIT_FAILURE;
+    if (!bench_config.repeats)
+        return EXIT_SUCCESS;
+
+    return bench_run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
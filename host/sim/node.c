@@ -0,0 +1,313 @@
+#include "node.h"
+#include <app/clock.h>
+#include <core/kernel.h>
+#include <core/kernel_task.h>
+#include <core/kernel_config.h>
+#include <core/bus_address.h>
+#include <core/sys.h>
+#include <core/util.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+// The simulated node runs the unmodified core modules, this file provides the
+// hardware they expect: the registers from xc.h, the UART with its FIFOs and
+// the transceiver direction pin. Everything is local to the node instance.
+
+#define SIM_TMR_CLOCK               (SYS_PB_CLOCK / KERN_TMR_PRESCALER)
+
+#define SIM_UART_ON_MASK            BIT(15)
+#define SIM_UART_URXDA_MASK         BIT(0)
+#define SIM_UART_OERR_MASK          BIT(1)
+#define SIM_UART_FERR_MASK          BIT(2)
+#define SIM_UART_TRMT_MASK          BIT(8)
+#define SIM_UART_UTXBF_MASK         BIT(9)
+#define SIM_UART_UTXEN_MASK         BIT(10)
+#define SIM_UART_URXEN_MASK         BIT(12)
+#define SIM_UART_WRITABLE_MASK      MASK(0xfce0, 0)
+#define SIM_UART_TX_INT_MASK        BIT(8)
+#define SIM_UART_RX_INT_MASK        BIT(7)
+
+#define SIM_DIR_PIN_MASK            BIT(7) // Transceiver direction, RB7
+
+#define SIM_ATOMIC_SFR_DEFINE(name) volatile unsigned int sim_##name[4];
+
+struct sim_uart_fifo
+{
+    unsigned int data[SIM_UART_FIFO_SIZE];
+    bool framing_error[SIM_UART_FIFO_SIZE];
+    unsigned int head;
+    unsigned int count;
+};
+
+static void sim_load_rtask_execute(void);
+KERN_SIMPLE_RTASK(sim_load0, NULL, sim_load_rtask_execute)
+KERN_SIMPLE_RTASK(sim_load1, NULL, sim_load_rtask_execute)
+KERN_SIMPLE_RTASK(sim_load2, NULL, sim_load_rtask_execute)
+
+extern void rs485_interrupt(void);
+
+SIM_ATOMIC_SFR_DEFINE(IEC1)
+SIM_ATOMIC_SFR_DEFINE(IFS1)
+SIM_ATOMIC_SFR_DEFINE(ANSELB)
+SIM_ATOMIC_SFR_DEFINE(TRISB)
+SIM_ATOMIC_SFR_DEFINE(LATB)
+SIM_ATOMIC_SFR_DEFINE(PORTB)
+SIM_ATOMIC_SFR_DEFINE(TRISF)
+SIM_ATOMIC_SFR_DEFINE(LATF)
+SIM_ATOMIC_SFR_DEFINE(PORTF)
+SIM_ATOMIC_SFR_DEFINE(ANSELG)
+SIM_ATOMIC_SFR_DEFINE(TRISG)
+SIM_ATOMIC_SFR_DEFINE(LATG)
+SIM_ATOMIC_SFR_DEFINE(PORTG)
+
+volatile unsigned int T5CON;
+volatile unsigned int IPC7;
+volatile unsigned int U1MODE;
+volatile unsigned int U1BRG;
+volatile unsigned int U1RXR;
+volatile unsigned int RPB3R;
+
+static struct sim_node_config sim_config;
+static unsigned long long sim_now;
+static unsigned int sim_cpu_time;
+
+static struct sim_uart_fifo sim_uart_rx;
+static struct sim_uart_fifo sim_uart_tx;
+static volatile unsigned int sim_uart_sta_reg;
+static volatile unsigned int sim_uart_txreg_discard;
+static bool sim_uart_overrun;
+static bool sim_uart_shifting;
+
+static void sim_load_rtask_execute(void)
+{
+    sim_cpu_time += sim_config.load_time;
+}
+
+static unsigned long long sim_local_time(void)
+{
+    return (unsigned long long)(sim_now * (1.0 + sim_config.clock_ppm * 1e-6)) + sim_config.clock_offset;
+}
+
+static void sim_port_update(void)
+{
+    // Output pins read back their latch
+    PORTB = (PORTB & TRISB) | (LATB & ~TRISB);
+    PORTF = (PORTF & TRISF) | (LATF & ~TRISF);
+    PORTG = (PORTG & TRISG) | (LATG & ~TRISG);
+}
+
+static void sim_uart_fifo_clear(struct sim_uart_fifo * fifo)
+{
+    fifo->head = 0;
+    fifo->count = 0;
+}
+
+static void sim_uart_interrupt(void)
+{
+    // TX interrupt is configured to fire when all characters are transmitted
+    if (!(IEC1 & SIM_UART_TX_INT_MASK) || sim_uart_shifting || sim_uart_tx.count)
+        return;
+
+    IFS1 |= SIM_UART_TX_INT_MASK;
+    rs485_interrupt();
+}
+
+void sim_atomic_clr(volatile void * reg, unsigned int mask)
+{
+    *(volatile unsigned int *)reg &= ~mask;
+    sim_port_update();
+}
+
+void sim_atomic_set(volatile void * reg, unsigned int mask)
+{
+    *(volatile unsigned int *)reg |= mask;
+    sim_port_update();
+}
+
+void sim_atomic_inv(volatile void * reg, unsigned int mask)
+{
+    *(volatile unsigned int *)reg ^= mask;
+    sim_port_update();
+}
+
+unsigned int sim_core_timer(void)
+{
+    return (unsigned int)((sim_local_time() * SYS_CORE_TIMER_CLOCK) / 1000000000LLU);
+}
+
+unsigned short sim_tmr5(void)
+{
+    return (unsigned short)((sim_local_time() * SIM_TMR_CLOCK) / 1000000000LLU);
+}
+
+volatile unsigned int * sim_uart_sta(void)
+{
+    // Turning the module off resets the FIFOs and clears the errors
+    if (!(U1MODE & SIM_UART_ON_MASK)) {
+        sim_uart_fifo_clear(&sim_uart_rx);
+        sim_uart_fifo_clear(&sim_uart_tx);
+        sim_uart_overrun = false;
+    }
+
+    unsigned int sta = sim_uart_sta_reg & SIM_UART_WRITABLE_MASK;
+    if (sim_uart_rx.count) {
+        sta |= SIM_UART_URXDA_MASK;
+        if (sim_uart_rx.framing_error[sim_uart_rx.head])
+            sta |= SIM_UART_FERR_MASK;
+    }
+    if (sim_uart_overrun)
+        sta |= SIM_UART_OERR_MASK;
+    if (sim_uart_tx.count == SIM_UART_FIFO_SIZE)
+        sta |= SIM_UART_UTXBF_MASK;
+    if (!sim_uart_tx.count && !sim_uart_shifting)
+        sta |= SIM_UART_TRMT_MASK;
+
+    sim_uart_sta_reg = sta;
+    return &sim_uart_sta_reg;
+}
+
+volatile unsigned int * sim_uart_txreg(void)
+{
+    if (!(U1MODE & SIM_UART_ON_MASK) || !(sim_uart_sta_reg & SIM_UART_UTXEN_MASK) || sim_uart_tx.count == SIM_UART_FIFO_SIZE)
+        return &sim_uart_txreg_discard;
+
+    unsigned int index = (sim_uart_tx.head + sim_uart_tx.count++) % SIM_UART_FIFO_SIZE;
+    return &sim_uart_tx.data[index];
+}
+
+unsigned int sim_uart_rxreg(void)
+{
+    if (!sim_uart_rx.count)
+        return 0;
+
+    unsigned int data = sim_uart_rx.data[sim_uart_rx.head];
+    sim_uart_rx.head = (sim_uart_rx.head + 1) % SIM_UART_FIFO_SIZE;
+    sim_uart_rx.count--;
+    return data;
+}
+
+void sys_lock(void) {}
+void sys_unlock(void) {}
+void sys_enable_global_interrupt(void) {}
+void sys_disable_global_interrupt(void) {}
+void sys_cpu_early_init(void) {}
+void sys_cpu_config_check(void) {}
+
+void sys_cpu_reset(void)
+{
+    fprintf(stderr, "node %u: cpu reset is not supported\n", sim_config.address);
+    abort();
+}
+
+void assert_printer(char const * format, va_list arg)
+{
+    fprintf(stderr, "node %u: ", sim_config.address);
+    vfprintf(stderr, format, arg);
+    fputc('\n', stderr);
+    abort();
+}
+
+static void sim_node_init(struct sim_node_config const * config)
+{
+    sim_config = *config;
+    sim_now = 0;
+
+    // Address pins, see bus_address.c
+    PORTB = MASK_SHIFT(!!(config->address & BIT(0)), 2)
+        | MASK_SHIFT(!!(config->address & BIT(2)), 12)
+        | MASK_SHIFT(!!(config->address & BIT(3)), 13);
+    PORTF = MASK_SHIFT(!!(config->address & BIT(1)), 5)
+        | MASK_SHIFT(!!(config->address & BIT(4)), 4);
+    TRISB = TRISF = TRISG = ~0U; // All inputs after reset
+    sim_port_update();
+
+    kernel_init();
+    bus_address_init();
+}
+
+static unsigned int sim_node_execute(unsigned long long now)
+{
+    sim_now = now;
+    sim_cpu_time = sim_config.loop_time;
+    kernel_execute();
+    sim_uart_interrupt();
+    return sim_cpu_time;
+}
+
+static bool sim_node_uart_tx_take(unsigned long long now, unsigned char * byte)
+{
+    sim_now = now;
+    if (sim_uart_shifting || !sim_uart_tx.count)
+        return false;
+
+    *byte = (unsigned char)sim_uart_tx.data[sim_uart_tx.head];
+    sim_uart_tx.head = (sim_uart_tx.head + 1) % SIM_UART_FIFO_SIZE;
+    sim_uart_tx.count--;
+    sim_uart_shifting = true;
+    return true;
+}
+
+static void sim_node_uart_tx_end(unsigned long long now)
+{
+    sim_now = now;
+    sim_uart_shifting = false;
+    sim_uart_interrupt();
+}
+
+static void sim_node_uart_rx_push(unsigned long long now, unsigned char byte, bool framing_error)
+{
+    sim_now = now;
+    if (!(U1MODE & SIM_UART_ON_MASK) || !(sim_uart_sta_reg & SIM_UART_URXEN_MASK) || sim_uart_overrun)
+        return;
+    if (sim_uart_rx.count == SIM_UART_FIFO_SIZE) {
+        sim_uart_overrun = true; // Reception stops until the module is reset
+        return;
+    }
+
+    unsigned int index = (sim_uart_rx.head + sim_uart_rx.count++) % SIM_UART_FIFO_SIZE;
+    sim_uart_rx.data[index] = byte;
+    sim_uart_rx.framing_error[index] = framing_error;
+
+    // RX interrupt is configured to fire when a character is received
+    if (IEC1 & SIM_UART_RX_INT_MASK) {
+        IFS1 |= SIM_UART_RX_INT_MASK;
+        rs485_interrupt();
+    }
+}
+
+static bool sim_node_driver_enabled(void)
+{
+    return (LATB & SIM_DIR_PIN_MASK) && !(TRISB & SIM_DIR_PIN_MASK);
+}
+
+static bool sim_node_receiver_enabled(void)
+{
+    return !sim_node_driver_enabled(); // Receiver enable is tied to the driver enable
+}
+
+static bool sim_node_clock_time(unsigned long long now, unsigned long long * time)
+{
+    sim_now = now;
+    *time = clock_get_time();
+    return clock_synced();
+}
+
+static int sim_node_clock_drift(void)
+{
+    unsigned int drift = 0;
+    clock_stat(CLOCK_STAT_DRIFT, &drift);
+    return (int)drift;
+}
+
+struct sim_node_api const sim_node_api =
+{
+    .init = sim_node_init,
+    .execute = sim_node_execute,
+    .uart_tx_take = sim_node_uart_tx_take,
+    .uart_tx_end = sim_node_uart_tx_end,
+    .uart_rx_push = sim_node_uart_rx_push,
+    .driver_enabled = sim_node_driver_enabled,
+    .receiver_enabled = sim_node_receiver_enabled,
+    .clock_time = sim_node_clock_time,
+    .clock_drift = sim_node_clock_drift,
+};
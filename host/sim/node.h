@@ -0,0 +1,41 @@
+#ifndef SIM_NODE_H
+#define SIM_NODE_H
+
+#include <stdbool.h>
+
+// Interface between the simulator and a simulated node. Every node is a
+// separate instance of node.so, so the core modules and the registers below
+// are private to the node. Times are in nanoseconds of simulated time.
+
+#define SIM_NODE_API_SYMBOL     "sim_node_api"
+#define SIM_UART_FIFO_SIZE      8 // Hardware FIFO depth of the PIC32MX UART
+
+struct sim_node_config
+{
+    unsigned char address;      // Presented on the address pins
+    double clock_ppm;           // Clock deviation of the node's oscillator
+    long long clock_offset;     // Local time at simulation time 0
+    unsigned int loop_time;     // CPU time of one kernel_execute() call
+    unsigned int load_time;     // Extra CPU time of each of the load rtasks, emulating the app
+};
+
+struct sim_node_api
+{
+    void (*init)(struct sim_node_config const * config);
+    unsigned int (*execute)(unsigned long long now); // Returns the CPU time consumed
+
+    // UART transmitter: take() the next byte for the shift register, end() when it has been shifted out
+    bool (*uart_tx_take)(unsigned long long now, unsigned char * byte);
+    void (*uart_tx_end)(unsigned long long now);
+    void (*uart_rx_push)(unsigned long long now, unsigned char byte, bool framing_error);
+
+    // Transceiver state, based on the direction pin
+    bool (*driver_enabled)(void);
+    bool (*receiver_enabled)(void);
+
+    // Cube time of the node, see app/clock.h
+    bool (*clock_time)(unsigned long long now, unsigned long long * time);
+    int (*clock_drift)(void);
+};
+
+#endif /* SIM_NODE_H */
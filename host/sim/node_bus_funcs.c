@@ -0,0 +1,93 @@
+#include <app/clock.h>
+#include <core/bus.h>
+#include <core/assert.h>
+#include <core/job.h>
+#include <core/timer.h>
+#include <stddef.h>
+
+// Bus functions of a simulated node, a small set that exercises the protocol
+// without depending on the app modules.
+
+#define BUS_FUNCS_SIZE      (sizeof(bus_funcs) / sizeof(bus_func_t))
+#define UNUSED1(x)          ((void)x)
+#define UNUSED2(x, y)       ((void)x);((void)y)
+#define UNUSED3(x, y, z)    ((void)x);((void)y);((void)z)
+
+static bool bus_job_sleep_done(void);
+
+static struct job_handler const bus_job_sleep =
+{
+    .done = bus_job_sleep_done,
+};
+
+static struct timer_module * bus_job_sleep_timer;
+
+static bool bus_job_sleep_done(void)
+{
+    return !timer_is_running(bus_job_sleep_timer);
+}
+
+static enum bus_response_code bus_func_ping(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    *response_data = *request_data;
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_bus_stat(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    unsigned int result;
+    if (!bus_stat(request_data->by_uint8, &result))
+        return BUS_ERR_INVALID_PAYLOAD;
+    response_data->by_uint32 = result;
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_job_sleep(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    if (bus_job_sleep_timer == NULL)
+        bus_job_sleep_timer = timer_construct(TIMER_TYPE_COUNTDOWN, NULL);
+    if (bus_job_sleep_timer == NULL || timer_is_running(bus_job_sleep_timer))
+        return BUS_ERR_AGAIN;
+
+    // Job that is done after the requested amount of milliseconds
+    timer_start(bus_job_sleep_timer, request_data->by_uint16, TIMER_TIME_UNIT_MS);
+    response_data->by_int8 = job_start(&bus_job_sleep);
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_clock_sync(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    clock_sync(request_data->by_uint32, bus_request_ticks());
+    return BUS_OK;
+}
+
+bus_func_t const bus_funcs[] =
+{
+    bus_func_ping,                      // 0
+    bus_func_bus_stat,                  // 1
+    job_bus_wait,                       // 2
+    bus_func_job_sleep,                 // 3
+    bus_func_clock_sync,                // 4
+};
+size_t const bus_funcs_size = BUS_FUNCS_SIZE;
+size_t const bus_funcs_start = 0;
@@ -0,0 +1,878 @@
+#define _GNU_SOURCE
+#include "node.h"
+#include <core/bus.h>
+#include <core/util.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Discrete event simulator of N led-controller nodes on a shared half-duplex
+// RS485 line. Each node runs the real core modules (see node.c), the line is
+// modelled per character: a character occupies the line for 10 bit times,
+// characters driven at the same time collide and every bit may flip with the
+// configured bit error rate. A master polls the nodes and collects statistics.
+
+#define SIM_MAX_NODES           32
+#define SIM_MASTER              SIM_MAX_NODES // Driver index of the master
+#define SIM_FRAME_SIZE          8
+#define SIM_BROADCAST_ADDRESS   32
+#define SIM_FRAME_GAP           1000000LLU // In nanoseconds, the master drops a partial response after this gap
+#define SIM_SLOT_OFFSET         750000LLU // In nanoseconds, see BUS_RESPONSE_SLOT_OFFSET
+#define SIM_SLOT_TIME           1194000LLU // In nanoseconds, see BUS_RESPONSE_SLOT_TIME
+#define SIM_NS_PER_US           1000LLU
+#define SIM_NS_PER_MS           1000000LLU
+#define SIM_CLOCK_SAMPLE_TIME   10000000LLU // In nanoseconds, interval at which the cube time of the nodes is sampled
+
+// Bus commands of the simulated node, see node_bus_funcs.c
+#define SIM_CMD_PING            0
+#define SIM_CMD_JOB_WAIT        2
+#define SIM_CMD_JOB_SLEEP       3
+#define SIM_CMD_CLOCK_SYNC      4
+
+enum sim_workload
+{
+    SIM_WORKLOAD_POLL = 0,      // Unicast request and response to every node in turn
+    SIM_WORKLOAD_JOBS_SLOTTED,  // Start a job on all nodes, collect completion with slotted broadcasts
+    SIM_WORKLOAD_JOBS_UNICAST,  // Start a job on all nodes, collect completion by polling each node
+    SIM_WORKLOAD_CLOCK,         // Broadcast clock syncs and sample the cube time of all nodes
+};
+
+struct sim_config
+{
+    unsigned int nodes;
+    unsigned int baudrate;
+    double bit_error_rate;
+    unsigned int turnaround;    // In microseconds, master delay between a response and the next request
+    unsigned int timeout;       // In microseconds, master response timeout
+    unsigned int warmup;        // In milliseconds, time for the nodes to sample their address
+    unsigned int duration;      // In milliseconds, measured time after the warmup
+    unsigned int loop_time;     // In nanoseconds, see struct sim_node_config
+    unsigned int load_time;     // ...
+    double drift;               // Maximum clock deviation of a node in ppm
+    unsigned int job_time;      // In milliseconds, duration of the job for the job workloads
+    unsigned int sync_period;   // In milliseconds, interval of the clock syncs for the clock workload
+    unsigned long long seed;
+    enum sim_workload workload;
+    char const * image;
+};
+
+struct sim_driver
+{
+    bool shifting;
+    bool on_line;               // Transceiver was driving when the character started
+    bool collided;
+    unsigned char byte;
+    unsigned long long end;
+};
+
+struct sim_node
+{
+    void * handle;
+    struct sim_node_api const * api;
+    unsigned long long next_step;
+    double clock_ppm;
+};
+
+enum sim_master_state
+{
+    SIM_MASTER_IDLE = 0,        // Waiting until the next request is due
+    SIM_MASTER_WAIT_RESPONSE,   // Waiting for a unicast response
+    SIM_MASTER_WAIT_SLOTS,      // Collecting slotted responses to a broadcast
+};
+
+struct sim_master
+{
+    enum sim_master_state state;
+    unsigned long long wake;    // Next request when idle, timeout when waiting
+    unsigned char tx[SIM_FRAME_SIZE];
+    unsigned int tx_offset;
+    unsigned int tx_size;
+    unsigned char rx[SIM_FRAME_SIZE];
+    unsigned int rx_size;
+    bool rx_framing_error;
+    unsigned long long rx_time;
+    unsigned long long request_start;
+    unsigned int target;        // Node index of the outstanding request
+    uint32_t payload;
+
+    // Job workloads
+    bool round_started;
+    unsigned long long round_start;
+    uint32_t round_done;        // Node mask of nodes that reported their job done
+    uint32_t round_released;    // Node mask of nodes that acknowledged the release of their job
+    unsigned char jobs_done[SIM_MAX_NODES]; // Job mask that every node reported done, released by a unicast request
+    uint32_t slot_reported;     // Node mask of the responses to the last job wait broadcast, released by the next one
+
+    // Clock workload
+    unsigned long long sync_next;
+};
+
+struct sim_stats
+{
+    unsigned long long requests;
+    unsigned long long responses;
+    unsigned long long failures;
+    unsigned long long * latency; // In nanoseconds
+    unsigned long long latency_size;
+    unsigned long long latency_capacity;
+    unsigned long long fail_since; // Start of the first failed request since the last success, 0 if none
+    unsigned long long recovery_count;
+    unsigned long long recovery_sum;
+    unsigned long long recovery_max;
+    unsigned long long rounds;
+    unsigned long long round_sum;
+    unsigned long long line_bytes;
+    unsigned long long collisions;
+    unsigned long long corrupted;
+    unsigned long long syncs;
+    unsigned long long clock_samples; // Samples at which all nodes were synced
+    double clock_error_square_sum; // In microseconds squared, error of a node's cube time with respect to the master
+    double clock_error_max;
+    double clock_spread_sum; // In microseconds, difference between the earliest and latest node
+    double clock_spread_max;
+};
+
+static struct sim_config sim_config =
+{
+    .nodes = 8,
+    .baudrate = 115200,
+    .bit_error_rate = 0.0,
+    .turnaround = 100,
+    .timeout = 5000,
+    .warmup = 600,
+    .duration = 2000,
+    .loop_time = 1000,
+    .load_time = 5000,
+    .drift = 50.0,
+    .job_time = 20,
+    .sync_period = 1000,
+    .seed = 1,
+    .workload = SIM_WORKLOAD_POLL,
+    .image = NULL,
+};
+
+static void sim_master_receive(unsigned char byte, bool framing_error);
+
+static struct sim_node sim_nodes[SIM_MAX_NODES];
+static struct sim_driver sim_drivers[SIM_MAX_NODES + 1];
+static struct sim_master sim_master;
+static struct sim_stats sim_stats;
+static unsigned long long sim_now;
+static unsigned long long sim_measure_start;
+static unsigned long long sim_char_time;
+static unsigned long long sim_random_state;
+
+static unsigned long long sim_random(void)
+{
+    // xorshift64*, reproducible across hosts
+    sim_random_state ^= sim_random_state >> 12;
+    sim_random_state ^= sim_random_state << 25;
+    sim_random_state ^= sim_random_state >> 27;
+    return sim_random_state * 0x2545f4914f6cdd1dLLU;
+}
+
+static double sim_random_unit(void)
+{
+    return (sim_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static bool sim_measuring(void)
+{
+    return sim_now >= sim_measure_start;
+}
+
+static void sim_fatal(char const * message)
+{
+    perror(message);
+    exit(EXIT_FAILURE);
+}
+
+// Nodes
+
+static void sim_node_load(unsigned int index, char const * dir)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/node%u.so", dir, index);
+
+    // Every node needs its own copy of the image, the dynamic loader would
+    // otherwise hand out the same instance (and thus the same globals).
+    int in = open(sim_config.image, O_RDONLY);
+    int out = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0700);
+    struct stat st;
+    if (in < 0 || out < 0 || fstat(in, &st) < 0)
+        sim_fatal(sim_config.image);
+    for (off_t offset = 0; offset < st.st_size;) {
+        if (sendfile(out, in, &offset, st.st_size - offset) <= 0)
+            sim_fatal(path);
+    }
+    close(in);
+    close(out);
+
+    struct sim_node * node = &sim_nodes[index];
+    node->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    unlink(path);
+    if (node->handle == NULL) {
+        fprintf(stderr, "%s\n", dlerror());
+        exit(EXIT_FAILURE);
+    }
+
+    node->api = dlsym(node->handle, SIM_NODE_API_SYMBOL);
+    if (node->api == NULL) {
+        fprintf(stderr, "%s\n", dlerror());
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void sim_nodes_init(void)
+{
+    char dir[] = "/tmp/bussim.XXXXXX";
+    if (mkdtemp(dir) == NULL)
+        sim_fatal("mkdtemp");
+
+    for (unsigned int i = 0; i < sim_config.nodes; ++i) {
+        sim_node_load(i, dir);
+
+        struct sim_node_config config =
+        {
+            .address = i,
+            .clock_ppm = (2.0 * sim_random_unit() - 1.0) * sim_config.drift,
+            .clock_offset = sim_random() % (10 * SIM_NS_PER_MS),
+            .loop_time = sim_config.loop_time,
+            .load_time = sim_config.load_time,
+        };
+
+        sim_nodes[i].api->init(&config);
+        sim_nodes[i].clock_ppm = config.clock_ppm;
+        sim_nodes[i].next_step = sim_random() % (sim_config.loop_time + 1);
+    }
+
+    rmdir(dir);
+}
+
+static void sim_nodes_close(void)
+{
+    for (unsigned int i = 0; i < sim_config.nodes; ++i)
+        dlclose(sim_nodes[i].handle);
+}
+
+// Line
+
+static bool sim_master_driving(void)
+{
+    // Receiver enable of the master's transceiver is tied to the driver enable as well
+    return sim_drivers[SIM_MASTER].shifting || sim_master.tx_offset < sim_master.tx_size;
+}
+
+static void sim_line_deliver(unsigned int from, unsigned char byte, bool framing_error)
+{
+    for (unsigned int i = 0; i < sim_config.nodes; ++i) {
+        if (i != from && sim_nodes[i].api->receiver_enabled())
+            sim_nodes[i].api->uart_rx_push(sim_now, byte, framing_error);
+    }
+
+    if (from != SIM_MASTER && !sim_master_driving())
+        sim_master_receive(byte, framing_error);
+}
+
+static void sim_line_start(unsigned int index, unsigned char byte, bool on_line)
+{
+    struct sim_driver * driver = &sim_drivers[index];
+    driver->shifting = true;
+    driver->on_line = on_line;
+    driver->collided = false;
+    driver->byte = byte;
+    driver->end = sim_now + sim_char_time;
+    if (!on_line)
+        return;
+
+    for (unsigned int i = 0; i <= SIM_MAX_NODES; ++i) {
+        struct sim_driver * other = &sim_drivers[i];
+        if (i != index && other->shifting && other->on_line && other->end > sim_now) {
+            other->collided = true;
+            driver->collided = true;
+        }
+    }
+}
+
+static void sim_line_end(unsigned int index)
+{
+    struct sim_driver * driver = &sim_drivers[index];
+    driver->shifting = false;
+    if (!driver->on_line)
+        return;
+
+    unsigned char byte = driver->byte;
+    bool framing_error = false;
+
+    if (driver->collided) {
+        byte = (unsigned char)sim_random();
+        framing_error = sim_random() & 1;
+        if (sim_measuring())
+            sim_stats.collisions++;
+    } else if (sim_config.bit_error_rate > 0.0) {
+        // One of the 10 bits of the character flips, the start and stop bit cause a framing error
+        double p = 1.0 - pow(1.0 - sim_config.bit_error_rate, 10);
+        if (sim_random_unit() < p) {
+            unsigned int bit = sim_random() % 10;
+            if (bit == 0 || bit == 9)
+                framing_error = true;
+            else
+                byte ^= BIT((bit - 1));
+            if (sim_measuring())
+                sim_stats.corrupted++;
+        }
+    }
+
+    if (sim_measuring())
+        sim_stats.line_bytes++;
+    sim_line_deliver(index, byte, framing_error);
+}
+
+static void sim_node_tx_next(unsigned int index)
+{
+    struct sim_node * node = &sim_nodes[index];
+    unsigned char byte;
+    if (!sim_drivers[index].shifting && node->api->uart_tx_take(sim_now, &byte))
+        sim_line_start(index, byte, node->api->driver_enabled());
+}
+
+static void sim_master_tx_next(void)
+{
+    struct sim_master * master = &sim_master;
+    if (!sim_drivers[SIM_MASTER].shifting && master->tx_offset < master->tx_size)
+        sim_line_start(SIM_MASTER, master->tx[master->tx_offset++], true);
+}
+
+// Master
+
+static unsigned long long sim_frame_time(void)
+{
+    return SIM_FRAME_SIZE * sim_char_time;
+}
+
+static void sim_master_request(unsigned int address, unsigned char command, uint32_t payload)
+{
+    struct sim_master * master = &sim_master;
+    crc16_t crc;
+
+    master->tx[0] = 0x1 | (address << 1); // Request bit and address, see struct bus_header
+    master->tx[1] = command;
+    for (unsigned int i = 0; i < sizeof(payload); ++i)
+        master->tx[2 + i] = (unsigned char)(payload >> (8 * i));
+    crc16_reset(&crc);
+    crc16_update(&crc, master->tx, SIM_FRAME_SIZE - sizeof(crc));
+    master->tx[6] = (unsigned char)crc;
+    master->tx[7] = (unsigned char)(crc >> 8);
+
+    master->tx_offset = 0;
+    master->tx_size = SIM_FRAME_SIZE;
+    master->rx_size = 0;
+    master->request_start = sim_now;
+    if (sim_measuring())
+        sim_stats.requests++;
+    sim_master_tx_next();
+}
+
+static bool sim_master_response(unsigned int * address, uint32_t * payload)
+{
+    struct sim_master const * master = &sim_master;
+    crc16_t crc;
+
+    crc16_reset(&crc);
+    crc16_update(&crc, master->rx, SIM_FRAME_SIZE);
+    if (crc || (master->rx[0] & 0x1) || master->rx[1] != BUS_OK)
+        return false;
+
+    *address = (master->rx[0] >> 1) & 0x3f;
+    *payload = 0;
+    for (unsigned int i = 0; i < sizeof(*payload); ++i)
+        *payload |= (uint32_t)master->rx[2 + i] << (8 * i);
+    return *address < sim_config.nodes;
+}
+
+static void sim_stats_latency(unsigned long long latency)
+{
+    struct sim_stats * stats = &sim_stats;
+    if (stats->latency_size == stats->latency_capacity) {
+        stats->latency_capacity = stats->latency_capacity ? 2 * stats->latency_capacity : 1024;
+        stats->latency = realloc(stats->latency, stats->latency_capacity * sizeof(*stats->latency));
+        if (stats->latency == NULL)
+            sim_fatal("realloc");
+    }
+    stats->latency[stats->latency_size++] = latency;
+}
+
+static void sim_master_complete(bool success)
+{
+    struct sim_master * master = &sim_master;
+    struct sim_stats * stats = &sim_stats;
+
+    // Recovery is the time from a failed request up to the next successful one
+    if (master->request_start >= sim_measure_start) {
+        if (success) {
+            stats->responses++;
+            sim_stats_latency(sim_now - master->request_start);
+            if (stats->fail_since) {
+                unsigned long long recovery = sim_now - stats->fail_since;
+                stats->recovery_count++;
+                stats->recovery_sum += recovery;
+                if (recovery > stats->recovery_max)
+                    stats->recovery_max = recovery;
+                stats->fail_since = 0;
+            }
+        } else {
+            stats->failures++;
+            if (!stats->fail_since)
+                stats->fail_since = master->request_start;
+        }
+    }
+
+    master->state = SIM_MASTER_IDLE;
+    master->wake = sim_now + sim_config.turnaround * SIM_NS_PER_US;
+}
+
+static void sim_master_job_done(unsigned int address, unsigned char jobs)
+{
+    struct sim_master * master = &sim_master;
+    uint32_t all = (uint32_t)((1LLU << sim_config.nodes) - 1);
+
+    if (master->round_done == all)
+        return;
+
+    master->jobs_done[address] = jobs;
+    master->round_done |= BIT(address);
+    if (master->round_done == all && master->round_start >= sim_measure_start) {
+        sim_stats.rounds++;
+        sim_stats.round_sum += sim_now - master->round_start;
+    }
+}
+
+static void sim_master_receive(unsigned char byte, bool framing_error)
+{
+    struct sim_master * master = &sim_master;
+    uint32_t all = (uint32_t)((1LLU << sim_config.nodes) - 1);
+
+    // Resynchronize on the gap between two frames
+    if (master->rx_size && sim_now - master->rx_time > SIM_FRAME_GAP)
+        master->rx_size = 0;
+    if (!master->rx_size)
+        master->rx_framing_error = false;
+
+    master->rx_time = sim_now;
+    master->rx[master->rx_size++] = byte;
+    master->rx_framing_error |= framing_error;
+    if (master->rx_size != SIM_FRAME_SIZE)
+        return;
+    master->rx_size = 0;
+
+    unsigned int address;
+    uint32_t payload;
+    bool valid = !master->rx_framing_error && sim_master_response(&address, &payload);
+
+    switch (master->state) {
+        default:
+        case SIM_MASTER_IDLE:
+            break; // Unsolicited
+        case SIM_MASTER_WAIT_RESPONSE:
+            valid = valid && address == master->target;
+            if (valid && sim_config.workload == SIM_WORKLOAD_POLL)
+                valid = payload == master->payload;
+            if (valid && master->round_started && master->round_done == all)
+                master->round_released |= BIT(address); // Response to the release
+            else if (valid && sim_config.workload == SIM_WORKLOAD_JOBS_UNICAST && (payload & 0xff))
+                sim_master_job_done(address, payload & 0xff);
+            sim_master_complete(valid);
+            break;
+        case SIM_MASTER_WAIT_SLOTS:
+            if (valid)
+                master->slot_reported |= BIT(address);
+            if (valid && (payload & 0xff))
+                sim_master_job_done(address, payload & 0xff);
+            break;
+    }
+}
+
+static void sim_master_step_poll(void)
+{
+    struct sim_master * master = &sim_master;
+
+    master->target = (master->target + 1) % sim_config.nodes;
+    master->payload = (uint32_t)sim_random();
+    sim_master_request(master->target, SIM_CMD_PING, master->payload);
+    master->state = SIM_MASTER_WAIT_RESPONSE;
+    master->wake = sim_now + sim_frame_time() + sim_config.timeout * SIM_NS_PER_US;
+}
+
+static void sim_master_step_jobs(void)
+{
+    struct sim_master * master = &sim_master;
+    uint32_t all = (uint32_t)((1LLU << sim_config.nodes) - 1);
+    unsigned long long gap = sim_frame_time() + sim_config.turnaround * SIM_NS_PER_US;
+
+    if (!master->round_started) {
+        sim_master_request(SIM_BROADCAST_ADDRESS, SIM_CMD_JOB_SLEEP, sim_config.job_time);
+        master->round_started = true;
+        master->round_start = sim_now;
+        master->round_done = 0;
+        master->round_released = 0;
+        master->wake = sim_now + gap;
+    } else if (master->round_released == all) {
+        master->round_started = false;
+        master->wake = sim_now;
+    } else if (master->round_done == all && sim_config.workload == SIM_WORKLOAD_JOBS_SLOTTED) {
+        // The jobs are released by the first job wait broadcast of the next round
+        master->round_started = false;
+        master->wake = sim_now;
+    } else if (master->round_done == all) {
+        // Job IDs are local to a node, so every node releases the jobs it reported by itself
+        do {
+            master->target = (master->target + 1) % sim_config.nodes;
+        } while (master->round_released & BIT(master->target));
+        sim_master_request(master->target, SIM_CMD_JOB_WAIT, master->jobs_done[master->target]);
+        master->state = SIM_MASTER_WAIT_RESPONSE;
+        master->wake = sim_now + sim_frame_time() + sim_config.timeout * SIM_NS_PER_US;
+    } else if (sim_config.workload == SIM_WORKLOAD_JOBS_SLOTTED) {
+        // Every node releases the jobs it reported, if its report was received
+        sim_master_request(SIM_BROADCAST_ADDRESS, SIM_CMD_JOB_WAIT, master->slot_reported);
+        master->slot_reported = 0;
+        master->state = SIM_MASTER_WAIT_SLOTS;
+        master->wake = sim_now + sim_frame_time() + SIM_SLOT_OFFSET + sim_config.nodes * SIM_SLOT_TIME;
+    } else {
+        do {
+            master->target = (master->target + 1) % sim_config.nodes;
+        } while (master->round_done & BIT(master->target));
+        sim_master_request(master->target, SIM_CMD_JOB_WAIT, 0);
+        master->state = SIM_MASTER_WAIT_RESPONSE;
+        master->wake = sim_now + sim_frame_time() + sim_config.timeout * SIM_NS_PER_US;
+    }
+}
+
+static void sim_clock_sample(void)
+{
+    struct sim_stats * stats = &sim_stats;
+    double error_min = INFINITY;
+    double error_max = -INFINITY;
+    double error_square_sum = 0.0;
+
+    // Steady state only, the second half of the measurement
+    if (sim_now < sim_measure_start + sim_config.duration * SIM_NS_PER_MS / 2)
+        return;
+
+    for (unsigned int i = 0; i < sim_config.nodes; ++i) {
+        unsigned long long time;
+        if (!sim_nodes[i].api->clock_time(sim_now, &time))
+            return;
+
+        double error = (double)(long long)(time - sim_now / SIM_NS_PER_US);
+        error_square_sum += error * error;
+        if (error < error_min)
+            error_min = error;
+        if (error > error_max)
+            error_max = error;
+    }
+
+    stats->clock_samples++;
+    stats->clock_error_square_sum += error_square_sum;
+    stats->clock_error_max = fmax(stats->clock_error_max, fmax(error_max, -error_min));
+    stats->clock_spread_sum += error_max - error_min;
+    stats->clock_spread_max = fmax(stats->clock_spread_max, error_max - error_min);
+}
+
+static void sim_master_step_clock(void)
+{
+    struct sim_master * master = &sim_master;
+
+    // Sync frames carry the time at which the master starts sending them
+    if (sim_now >= master->sync_next) {
+        sim_master_request(SIM_BROADCAST_ADDRESS, SIM_CMD_CLOCK_SYNC, (uint32_t)(sim_now / SIM_NS_PER_US));
+        master->sync_next = sim_now + sim_config.sync_period * SIM_NS_PER_MS;
+        if (sim_measuring())
+            sim_stats.syncs++;
+    }
+
+    sim_clock_sample();
+    master->wake = sim_now + SIM_CLOCK_SAMPLE_TIME;
+}
+
+static void sim_master_step(void)
+{
+    struct sim_master * master = &sim_master;
+
+    switch (master->state) {
+        default:
+        case SIM_MASTER_IDLE:
+            if (sim_config.workload == SIM_WORKLOAD_POLL)
+                sim_master_step_poll();
+            else if (sim_config.workload == SIM_WORKLOAD_CLOCK)
+                sim_master_step_clock();
+            else
+                sim_master_step_jobs();
+            break;
+        case SIM_MASTER_WAIT_RESPONSE:
+            sim_master_complete(false); // Timeout
+            break;
+        case SIM_MASTER_WAIT_SLOTS:
+            master->state = SIM_MASTER_IDLE;
+            master->wake = sim_now + sim_config.turnaround * SIM_NS_PER_US;
+            break;
+    }
+}
+
+// Simulation
+
+static void sim_run(void)
+{
+    unsigned long long end = sim_measure_start + sim_config.duration * SIM_NS_PER_MS;
+
+    for (;;) {
+        unsigned long long next = end;
+        for (unsigned int i = 0; i <= SIM_MAX_NODES; ++i) {
+            if (sim_drivers[i].shifting && sim_drivers[i].end < next)
+                next = sim_drivers[i].end;
+        }
+        for (unsigned int i = 0; i < sim_config.nodes; ++i) {
+            if (sim_nodes[i].next_step < next)
+                next = sim_nodes[i].next_step;
+        }
+        if (sim_master.wake < next)
+            next = sim_master.wake;
+        if (next >= end)
+            break;
+        sim_now = next;
+
+        // Characters that are shifted out
+        for (unsigned int i = 0; i < sim_config.nodes; ++i) {
+            if (sim_drivers[i].shifting && sim_drivers[i].end == sim_now) {
+                sim_line_end(i);
+                sim_nodes[i].api->uart_tx_end(sim_now);
+                sim_node_tx_next(i);
+            }
+        }
+        if (sim_drivers[SIM_MASTER].shifting && sim_drivers[SIM_MASTER].end == sim_now) {
+            sim_line_end(SIM_MASTER);
+            sim_master_tx_next();
+        }
+
+        if (sim_master.wake == sim_now)
+            sim_master_step();
+
+        for (unsigned int i = 0; i < sim_config.nodes; ++i) {
+            struct sim_node * node = &sim_nodes[i];
+            if (node->next_step == sim_now) {
+                node->next_step = sim_now + node->api->execute(sim_now);
+                sim_node_tx_next(i);
+            }
+        }
+    }
+}
+
+static int sim_compare(void const * a, void const * b)
+{
+    unsigned long long x = *(unsigned long long const *)a;
+    unsigned long long y = *(unsigned long long const *)b;
+    return (x > y) - (x < y);
+}
+
+static double sim_percentile(double percentile)
+{
+    if (!sim_stats.latency_size)
+        return NAN;
+
+    unsigned long long index = (unsigned long long)(percentile / 100.0 * (sim_stats.latency_size - 1) + 0.5);
+    return sim_stats.latency[index] / (double)SIM_NS_PER_US;
+}
+
+static void sim_report_header(void)
+{
+    printf("# baudrate %u, bit error rate %g, turnaround %u us, timeout %u us, drift %g ppm, loop %u ns, load %u ns\n",
+        sim_config.baudrate, sim_config.bit_error_rate, sim_config.turnaround, sim_config.timeout,
+        sim_config.drift, sim_config.loop_time, sim_config.load_time);
+
+    if (sim_config.workload == SIM_WORKLOAD_CLOCK)
+        printf("%5s %7s %9s %11s %11s %14s %14s %14s\n",
+            "nodes", "syncs", "samples", "err.rms[us]", "err.max[us]",
+            "spread.avg[us]", "spread.max[us]", "drift.rms[ppm]");
+    else if (sim_config.workload == SIM_WORKLOAD_POLL)
+        printf("%5s %9s %9s %9s %9s %9s %8s %9s %11s %11s\n",
+            "nodes", "frames/s", "p50[us]", "p90[us]", "p99[us]", "max[us]",
+            "failed", "recovered", "rec.avg[ms]", "rec.max[ms]");
+    else
+        printf("%5s %9s %12s %12s %12s %10s\n",
+            "nodes", "rounds", "round[ms]", "collect[ms]", "bytes/round", "collisions");
+}
+
+static void sim_report(void)
+{
+    double duration = sim_config.duration / 1000.0;
+
+    if (sim_config.workload == SIM_WORKLOAD_CLOCK) {
+        // Estimated drift compensates the node's clock deviation, so ideally their sum is 0
+        double drift_square_sum = 0.0;
+        for (unsigned int i = 0; i < sim_config.nodes; ++i) {
+            double drift = sim_nodes[i].api->clock_drift() / 1000.0 + sim_nodes[i].clock_ppm;
+            drift_square_sum += drift * drift;
+        }
+
+        double samples = (double)sim_stats.clock_samples;
+        printf("%5u %7llu %9llu %11.2f %11.2f %14.2f %14.2f %14.3f\n",
+            sim_config.nodes, sim_stats.syncs, sim_stats.clock_samples,
+            samples ? sqrt(sim_stats.clock_error_square_sum / (samples * sim_config.nodes)) : NAN,
+            samples ? sim_stats.clock_error_max : NAN,
+            samples ? sim_stats.clock_spread_sum / samples : NAN,
+            samples ? sim_stats.clock_spread_max : NAN,
+            sqrt(drift_square_sum / sim_config.nodes));
+        return;
+    }
+
+    if (sim_config.workload != SIM_WORKLOAD_POLL) {
+        double round = sim_stats.rounds ? sim_stats.round_sum / (double)sim_stats.rounds / SIM_NS_PER_MS : NAN;
+        printf("%5u %9llu %12.2f %12.2f %12.1f %10llu\n",
+            sim_config.nodes, sim_stats.rounds, round, round - sim_config.job_time,
+            sim_stats.rounds ? sim_stats.line_bytes / (double)sim_stats.rounds : NAN,
+            sim_stats.collisions);
+        return;
+    }
+
+    qsort(sim_stats.latency, sim_stats.latency_size, sizeof(*sim_stats.latency), sim_compare);
+    printf("%5u %9.1f %9.1f %9.1f %9.1f %9.1f %8llu %9llu %11.2f %11.2f\n",
+        sim_config.nodes,
+        sim_stats.responses / duration,
+        sim_percentile(50.0),
+        sim_percentile(90.0),
+        sim_percentile(99.0),
+        sim_percentile(100.0),
+        sim_stats.failures,
+        sim_stats.recovery_count,
+        sim_stats.recovery_count ? sim_stats.recovery_sum / (double)sim_stats.recovery_count / SIM_NS_PER_MS : NAN,
+        sim_stats.recovery_count ? sim_stats.recovery_max / (double)SIM_NS_PER_MS : NAN);
+}
+
+static void sim_simulate(void)
+{
+    free(sim_stats.latency);
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    memset(sim_drivers, 0, sizeof(sim_drivers));
+    memset(&sim_master, 0, sizeof(sim_master));
+
+    sim_random_state = sim_config.seed * 0x9e3779b97f4a7c15LLU + 1;
+    sim_char_time = 10 * 1000000000LLU / sim_config.baudrate;
+    sim_measure_start = sim_config.warmup * SIM_NS_PER_MS;
+    sim_master.target = sim_config.nodes - 1;
+    sim_master.wake = sim_measure_start;
+    sim_now = 0;
+
+    sim_nodes_init();
+    sim_run();
+    sim_report();
+    sim_nodes_close();
+}
+
+static void sim_usage(char const * name)
+{
+    printf("usage: %s [options]\n"
+        "  -n <nodes>       number of nodes, 1 to %u (default %u)\n"
+        "  -B               benchmark, sweep the number of nodes\n"
+        "  -m <workload>    poll, slotted, unicast or clock (default poll)\n"
+        "  -b <baudrate>    line baudrate (default %u)\n"
+        "  -e <rate>        bit error rate (default %g)\n"
+        "  -t <us>          master turnaround time (default %u)\n"
+        "  -T <us>          master response timeout (default %u)\n"
+        "  -w <ms>          warmup time (default %u)\n"
+        "  -d <ms>          measured time (default %u)\n"
+        "  -l <ns>          CPU time of a kernel_execute() call (default %u)\n"
+        "  -L <ns>          CPU time of each load rtask (default %u)\n"
+        "  -p <ppm>         maximum node clock deviation (default %g)\n"
+        "  -j <ms>          job time of the job workloads (default %u)\n"
+        "  -S <ms>          sync period of the clock workload (default %u)\n"
+        "  -s <seed>        random seed (default %llu)\n"
+        "  -i <image>       node image (default node.so next to this executable)\n",
+        name, SIM_MAX_NODES, sim_config.nodes, sim_config.baudrate, sim_config.bit_error_rate,
+        sim_config.turnaround, sim_config.timeout, sim_config.warmup, sim_config.duration,
+        sim_config.loop_time, sim_config.load_time, sim_config.drift, sim_config.job_time,
+        sim_config.sync_period, sim_config.seed);
+}
+
+int main(int argc, char ** argv)
+{
+    static unsigned int const sweep[] = { 1, 2, 4, 8, 16, 32 };
+    static char image[PATH_MAX];
+    bool benchmark = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:Bm:b:e:t:T:w:d:l:L:p:j:S:s:i:h")) != -1) {
+        switch (opt) {
+            case 'n': sim_config.nodes = strtoul(optarg, NULL, 0);          break;
+            case 'B': benchmark = true;                                     break;
+            case 'b': sim_config.baudrate = strtoul(optarg, NULL, 0);       break;
+            case 'e': sim_config.bit_error_rate = strtod(optarg, NULL);     break;
+            case 't': sim_config.turnaround = strtoul(optarg, NULL, 0);     break;
+            case 'T': sim_config.timeout = strtoul(optarg, NULL, 0);        break;
+            case 'w': sim_config.warmup = strtoul(optarg, NULL, 0);         break;
+            case 'd': sim_config.duration = strtoul(optarg, NULL, 0);       break;
+            case 'l': sim_config.loop_time = strtoul(optarg, NULL, 0);      break;
+            case 'L': sim_config.load_time = strtoul(optarg, NULL, 0);      break;
+            case 'p': sim_config.drift = strtod(optarg, NULL);              break;
+            case 'j': sim_config.job_time = strtoul(optarg, NULL, 0);       break;
+            case 'S': sim_config.sync_period = strtoul(optarg, NULL, 0);    break;
+            case 's': sim_config.seed = strtoull(optarg, NULL, 0);          break;
+            case 'i': sim_config.image = optarg;                            break;
+            case 'm':
+                if (!strcmp(optarg, "poll"))
+                    sim_config.workload = SIM_WORKLOAD_POLL;
+                else if (!strcmp(optarg, "slotted"))
+                    sim_config.workload = SIM_WORKLOAD_JOBS_SLOTTED;
+                else if (!strcmp(optarg, "unicast"))
+                    sim_config.workload = SIM_WORKLOAD_JOBS_UNICAST;
+                else if (!strcmp(optarg, "clock"))
+                    sim_config.workload = SIM_WORKLOAD_CLOCK;
+                else {
+                    sim_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'h':
+                sim_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                sim_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (sim_config.nodes < 1 || sim_config.nodes > SIM_MAX_NODES || !sim_config.baudrate) {
+        sim_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (sim_config.image == NULL) {
+        ssize_t size = readlink("/proc/self/exe", image, sizeof(image) - sizeof("/node.so"));
+        if (size < 0)
+            sim_fatal("readlink");
+        image[size] = '\0';
+        strcat(dirname(image), "/node.so");
+        sim_config.image = image;
+    }
+
+    sim_report_header();
+    if (!benchmark)
+        sim_simulate();
+    else {
+        for (unsigned int i = 0; i < sizeof(sweep) / sizeof(sweep[0]); ++i) {
+            sim_config.nodes = sweep[i];
+            sim_simulate();
+            fflush(stdout);
+        }
+    }
+
+    free(sim_stats.latency);
+    return EXIT_SUCCESS;
+}
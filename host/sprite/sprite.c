@@ -0,0 +1,307 @@
+#define _GNU_SOURCE
+#include <app/sprite.h>
+#include <app/tlc5940_config.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SPRITE_HAVE_TSC
+#endif
+
+// Checks the firmware's sprite compositor against a plain per pixel compositor on random
+// scenes, and benchmarks composing a frame with all sprites moving. The layer canvas and
+// the other firmware dependencies of sprite.c are stubbed.
+
+#define BENCH_SCAN_PERIOD           (LAYER_NUM_OF_ROWS * TLC5940_GSCLK_PERIOD) // In microseconds
+#define BENCH_POOL_WORDS            (SPRITE_NUM_OF_TILES * SPRITE_TILE_WORDS)
+
+struct bench_config
+{
+    unsigned int scenes;        // Random scenes the compositor is checked with
+    unsigned int frames;        // Frames composed for the benchmark
+    unsigned int size;          // Size of the sprites of the benchmark, in tiles
+};
+
+struct bench_sprite
+{
+    int x;
+    int y;
+    unsigned int tile;
+    unsigned int width;
+    unsigned int height;
+    unsigned char priority;
+};
+
+// Mirror of the scene, for the reference compositor
+struct bench_scene
+{
+    uint32_t tiles[BENCH_POOL_WORDS];
+    struct layer_color palette[SPRITE_NUM_OF_COLORS];
+    unsigned char map[SPRITE_MAP_COLS * SPRITE_MAP_ROWS];
+    struct bench_sprite sprites[SPRITE_NUM_OF_SPRITES];
+};
+
+static struct bench_config bench_config =
+{
+    .scenes = 10000,
+    .frames = 100000,
+    .size = 2,
+};
+
+static unsigned char bench_canvas[LAYER_FRAME_BUFFER_SIZE] __attribute__((aligned(4)));
+static unsigned char bench_reference[LAYER_FRAME_BUFFER_SIZE];
+static struct bench_scene bench_scene;
+static unsigned int bench_commits;
+
+unsigned int sim_core_timer(void)
+{
+    return 0;
+}
+
+unsigned char * layer_canvas(void)
+{
+    return bench_canvas;
+}
+
+bool layer_canvas_commit(bool present)
+{
+    (void)present;
+    bench_commits++;
+    return true;
+}
+
+static unsigned long long bench_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+}
+
+static unsigned long long bench_cycles(void)
+{
+#ifdef SPRITE_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint32_t bench_random(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static unsigned int bench_index(unsigned int tile, unsigned int x, unsigned int y)
+{
+    unsigned int pixel = y * SPRITE_TILE_SIZE + x;
+    return (bench_scene.tiles[tile * SPRITE_TILE_WORDS + pixel / 8] >> ((pixel % 8) * 4)) & 0xf;
+}
+
+static void bench_set_pixel(unsigned int x, unsigned int y, unsigned int index)
+{
+    unsigned int pos = y * LAYER_NUM_OF_COLS + x;
+    bench_reference[pos + LAYER_RED_OFFSET] = bench_scene.palette[index].r;
+    bench_reference[pos + LAYER_GREEN_OFFSET] = bench_scene.palette[index].g;
+    bench_reference[pos + LAYER_BLUE_OFFSET] = bench_scene.palette[index].b;
+}
+
+static void bench_compose_reference(void)
+{
+    for (unsigned int y = 0; y < LAYER_NUM_OF_ROWS; ++y) {
+        for (unsigned int x = 0; x < LAYER_NUM_OF_COLS; ++x) {
+            unsigned int tile = bench_scene.map[(y / SPRITE_TILE_SIZE) * SPRITE_MAP_COLS + x / SPRITE_TILE_SIZE];
+            bench_set_pixel(x, y, bench_index(tile, x % SPRITE_TILE_SIZE, y % SPRITE_TILE_SIZE));
+        }
+    }
+
+    // Lowest priority first, the lower index first on equal priorities
+    for (unsigned int priority = 0; priority < 256; ++priority) {
+        for (unsigned int i = 0; i < SPRITE_NUM_OF_SPRITES; ++i) {
+            struct bench_sprite const * sprite = &bench_scene.sprites[i];
+            if (sprite->priority != priority || !sprite->width || !sprite->height)
+                continue;
+
+            for (unsigned int y = 0; y < sprite->height * SPRITE_TILE_SIZE; ++y) {
+                for (unsigned int x = 0; x < sprite->width * SPRITE_TILE_SIZE; ++x) {
+                    int px = sprite->x + (int)x;
+                    int py = sprite->y + (int)y;
+                    unsigned int tile = sprite->tile + (y / SPRITE_TILE_SIZE) * sprite->width + x / SPRITE_TILE_SIZE;
+                    unsigned int index = bench_index(tile, x % SPRITE_TILE_SIZE, y % SPRITE_TILE_SIZE);
+                    if (px >= 0 && px < LAYER_NUM_OF_COLS && py >= 0 && py < LAYER_NUM_OF_ROWS && index)
+                        bench_set_pixel(px, py, index);
+                }
+            }
+        }
+    }
+}
+
+static bool bench_upload(void)
+{
+    bool ok = sprite_tile_address(0);
+    for (unsigned int i = 0; i < BENCH_POOL_WORDS; ++i)
+        ok &= sprite_tile_push_word(bench_scene.tiles[i]);
+    ok &= !sprite_tile_push_word(0); // Pool is full
+    for (unsigned int i = 0; i < SPRITE_NUM_OF_COLORS; ++i)
+        ok &= sprite_set_color(i, bench_scene.palette[i]);
+    for (unsigned int i = 0; i < sizeof(bench_scene.map); ++i)
+        ok &= sprite_map_set(i, bench_scene.map[i]);
+    return ok;
+}
+
+static bool bench_set_sprite(unsigned int i, struct bench_sprite const * sprite)
+{
+    bench_scene.sprites[i] = *sprite;
+    return sprite_set(i, sprite->tile, sprite->width, sprite->height, sprite->priority)
+        && sprite_move(i, sprite->x, sprite->y);
+}
+
+static bool bench_check(void)
+{
+    for (unsigned int scene = 0; scene < bench_config.scenes; ++scene) {
+        bool ok = true;
+
+        // A new tile pool and background every now and then, the sprites change every scene
+        if (scene % 100 == 0) {
+            for (unsigned int i = 0; i < BENCH_POOL_WORDS; ++i)
+                bench_scene.tiles[i] = bench_random();
+            for (unsigned int i = 0; i < SPRITE_NUM_OF_COLORS; ++i)
+                bench_scene.palette[i] = (struct layer_color){ rand(), rand(), rand() };
+            for (unsigned int i = 0; i < sizeof(bench_scene.map); ++i)
+                bench_scene.map[i] = rand() % SPRITE_NUM_OF_TILES;
+            ok &= bench_upload();
+        }
+        for (unsigned int i = 0; i < SPRITE_NUM_OF_SPRITES; ++i) {
+            struct bench_sprite sprite =
+            {
+                .x = rand() % 40 - 20,
+                .y = rand() % 40 - 20,
+                .width = rand() % (SPRITE_SIZE_MAX + 1),
+                .height = rand() % (SPRITE_SIZE_MAX + 1),
+                .priority = rand() % 4,
+            };
+            sprite.tile = rand() % (SPRITE_NUM_OF_TILES - sprite.width * sprite.height + 1);
+            ok &= bench_set_sprite(i, &sprite);
+        }
+        if (!ok) {
+            fprintf(stderr, "scene %u: failed to set up the scene\n", scene);
+            return false;
+        }
+
+        sprite_compose(false);
+        bench_compose_reference();
+        if (memcmp(bench_canvas, bench_reference, sizeof(bench_canvas))) {
+            fprintf(stderr, "scene %u: composed frame differs from the reference\n", scene);
+            return false;
+        }
+    }
+
+    printf("sprite compositor matches the reference for %u random scenes\n", bench_config.scenes);
+    return true;
+}
+
+static bool bench_run(void)
+{
+    // All sprites bounce around, partly outside the layer at the edges
+    int dx[SPRITE_NUM_OF_SPRITES];
+    int dy[SPRITE_NUM_OF_SPRITES];
+    int limit = LAYER_NUM_OF_COLS - (int)bench_config.size * SPRITE_TILE_SIZE / 2;
+
+    for (unsigned int i = 0; i < SPRITE_NUM_OF_SPRITES; ++i) {
+        struct bench_sprite sprite =
+        {
+            .x = i * 2,
+            .y = 15 - i * 2,
+            .tile = (i * bench_config.size * bench_config.size) % (SPRITE_NUM_OF_TILES - bench_config.size * bench_config.size + 1),
+            .width = bench_config.size,
+            .height = bench_config.size,
+            .priority = i,
+        };
+        if (!bench_set_sprite(i, &sprite)) {
+            fprintf(stderr, "failed to set sprite %u\n", i);
+            return false;
+        }
+        dx[i] = (i & 1) ? 1 : -1;
+        dy[i] = (i & 2) ? 1 : -1;
+    }
+
+    unsigned long long worst = 0;
+    unsigned long long start = bench_time_ns();
+    unsigned long long start_cycles = bench_cycles();
+    unsigned int sum = 0;
+    for (unsigned int frame = 0; frame < bench_config.frames; ++frame) {
+        for (unsigned int i = 0; i < SPRITE_NUM_OF_SPRITES; ++i) {
+            struct bench_sprite * sprite = &bench_scene.sprites[i];
+            if (sprite->x + dx[i] < -limit || sprite->x + dx[i] >= limit)
+                dx[i] = -dx[i];
+            if (sprite->y + dy[i] < -limit || sprite->y + dy[i] >= limit)
+                dy[i] = -dy[i];
+            sprite->x += dx[i];
+            sprite->y += dy[i];
+            sprite_move(i, sprite->x, sprite->y);
+        }
+
+        unsigned long long frame_start = bench_time_ns();
+        sprite_compose(false);
+
+        unsigned long long frame_time = bench_time_ns() - frame_start;
+        if (frame_time > worst)
+            worst = frame_time;
+        sum += bench_canvas[frame % sizeof(bench_canvas)];
+    }
+
+    unsigned long long total = bench_time_ns() - start;
+    printf("%-10s %10s %10s %10s %10s\n", "sprites", "ns/frame", "cyc/frame", "worst[us]", "checksum");
+    printf("%ux%-8u %10.1f %10.0f %10.1f %10u\n", SPRITE_NUM_OF_SPRITES, bench_config.size,
+        (double)total / bench_config.frames,
+        (double)(bench_cycles() - start_cycles) / bench_config.frames,
+        worst / 1000.0,
+        sum % 1000);
+    printf("one frame must be composed within a scan cycle of %u us\n", BENCH_SCAN_PERIOD);
+    return true;
+}
+
+static void bench_usage(char const * name)
+{
+    printf("usage: %s [options]\n"
+        "  -c <scenes>      random scenes the compositor is checked with (default %u)\n"
+        "  -r <frames>      frames composed for the benchmark, 0 to skip it (default %u)\n"
+        "  -s <size>        size of the sprites of the benchmark in tiles (default %u)\n",
+        name, bench_config.scenes, bench_config.frames, bench_config.size);
+}
+
+int main(int argc, char ** argv)
+{
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:r:s:h")) != -1) {
+        switch (opt) {
+            case 'c': bench_config.scenes = strtoul(optarg, NULL, 0);       break;
+            case 'r': bench_config.frames = strtoul(optarg, NULL, 0);       break;
+            case 's': bench_config.size = strtoul(optarg, NULL, 0);         break;
+            case 'h':
+                bench_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                bench_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (!bench_config.size || bench_config.size > SPRITE_SIZE_MAX) {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    srand(5940);
+    if (!bench_check())
+        return EXIT_FAILURE;
+    if (!bench_config.frames)
+        return EXIT_SUCCESS;
+
+    return bench_run() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
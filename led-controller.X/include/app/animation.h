@@ -0,0 +1,53 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ANIMATION_MAGIC             0x4d494e41 // "ANIM"
+
+// The animation store is a flash page of the app memory (see NVM_PAGE), written over the
+// bus one flash row at a time like the bootloader does. It's erased when the app is updated,
+// so the animation has to be uploaded again after an update. It starts with this
+// header, followed by the frames in the 8 bit color depth, each a struct frame_header
+// followed by its data. The palette encodings are not allowed, as they would need
+// another palette in RAM. The first frame must not depend on a previous frame, so
+// the animation can loop. Only built when ANIMATION_ENABLE is defined.
+struct __attribute__((packed)) animation_header
+{
+    uint32_t magic;
+    uint16_t frames; // Number of frames
+    uint16_t frame_period; // In milliseconds
+    uint32_t size; // Number of bytes of the frames following the header
+    uint16_t crc; // CRC16 of the frames, see crc16_update
+    uint16_t                    :16;
+};
+
+enum animation_stat
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    ANIMATION_STAT_STORE_SIZE   = 0, // In bytes, including the header
+    ANIMATION_STAT_PLAYED_FRAMES = 1, // Number of frames committed to the layer
+    ANIMATION_STAT_SKIPPED_FRAMES = 2, // Number of frames not shown because the canvas wasn't available, the queue was full or decoding fell behind
+    ANIMATION_STAT_DECODE_TIME_MAX = 3, // In microseconds, of the frames decoded at once to catch up
+};
+
+bool animation_busy(void);
+bool animation_ready(void);
+bool animation_error(void);
+bool animation_erase(void);
+// A row is uploaded in the flash row buffer, which is owned from the reset until the row is
+// burned or the store is erased, so the settings can't be saved in the meantime and vice versa
+bool animation_row_reset(void);
+bool animation_row_crc16(unsigned short * out);
+bool animation_row_push_word(unsigned int word);
+bool animation_row_burn(unsigned int offset); // Offset in the store, a multiple of the flash row size
+
+// Frames are shown in a loop from the start time on, in the lower 32 bits of the cube time
+// (see clock_get_time), so all nodes started with the same time play in sync.
+bool animation_play(unsigned int start_time);
+void animation_stop(void);
+bool animation_playing(void);
+bool animation_stat(enum animation_stat stat, unsigned int * out);
+
+#endif /* ANIMATION_H */
@@ -0,0 +1,20 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdbool.h>
+
+enum clock_stat
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    CLOCK_STAT_TIME             = 0, // In microseconds, lower 32 bits of the cube time
+    CLOCK_STAT_ERROR_LAST       = 1, // In microseconds (signed), error of the last sync before it was corrected
+    CLOCK_STAT_DRIFT            = 2, // In ppb (signed), estimated deviation of the local clock from the master's
+    CLOCK_STAT_SYNC_COUNT       = 3, // Number of syncs since the last (re)start of the estimation
+};
+
+bool clock_synced(void);
+unsigned long long clock_get_time(void);
+void clock_sync(unsigned int master_time, unsigned int ticks);
+bool clock_stat(enum clock_stat stat, unsigned int * out);
+
+#endif /* CLOCK_H */
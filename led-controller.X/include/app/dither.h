@@ -0,0 +1,22 @@
+#ifndef DITHER_H
+#define DITHER_H
+
+#define DITHER_FRACTION_BITS        4
+#define DITHER_PHASES               (1 << DITHER_FRACTION_BITS) // Scan cycles after which the pattern repeats
+#define DITHER_FRACTION_SIZE(n)     (((n) + 1) / 2) // Size in bytes of the fractions of n channels
+
+// Temporal dithering of a row of 12 bit channels, packed the way the TLC5940 expects
+// them (see tlc5940_pack). Every channel has a fraction of DITHER_FRACTION_BITS that is
+// spread over DITHER_PHASES successive scan cycles: a channel with fraction f is rounded
+// up in exactly f out of every DITHER_PHASES phases, so its time averaged output equals
+// the value including its fraction. The fractions are packed two channels per byte,
+// the first channel in the most significant nibble.
+void dither_set_fraction(unsigned char * fractions, unsigned int channel, unsigned char fraction);
+void dither_row(
+    unsigned char * row,
+    unsigned char const * source,
+    unsigned char const * fractions,
+    unsigned int channels,
+    unsigned int phase);
+
+#endif /* DITHER_H */
@@ -38,6 +38,10 @@ void dma_configure_abort_event(struct dma_channel * channel, struct dma_event ev
 void dma_enable_transfer(struct dma_channel * channel);
 void dma_enable_force_transfer(struct dma_channel * channel);
 void dma_disable_transfer(struct dma_channel * channel);
+unsigned short dma_get_dst_pointer(struct dma_channel * channel); // Number of bytes written to the destination so far
+bool dma_block_transfer_pending(struct dma_channel * channel); // Block transfer completed, but its handler didn't run yet
+void dma_mask_interrupt(struct dma_channel * channel); // Hold off the handlers, e.g. to share data with them
+void dma_unmask_interrupt(struct dma_channel * channel);
 bool dma_busy(struct dma_channel * channel);
 bool dma_ready(struct dma_channel * channel);
 
@@ -0,0 +1,52 @@
+#ifndef EFFECT_H
+#define EFFECT_H
+
+#include <app/layer.h>
+#include <stdbool.h>
+
+#define EFFECT_NUM_OF_COLORS        2
+
+// Effects are rendered on the device into the layer canvas, once every scan cycle, so
+// an idle cube keeps showing them without any frames from the host. Frames of an effect
+// are presented right away, also in the manual buffer swap mode. Only built when
+// EFFECT_ENABLE is defined, as the effects take some 5 KB of flash.
+enum effect_type
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    EFFECT_NONE                 = 0, // No effect is running, the last frame is kept
+    EFFECT_PLASMA               = 1, // Sum of sines, the parameter is the spatial frequency
+    EFFECT_FIRE                 = 2, // Heat rising from the last row, the parameter is the cooling
+    EFFECT_GRADIENT             = 3, // Scrolling gradient between the colors, the parameter is the direction (see enum effect_direction)
+    EFFECT_FADE                 = 4, // Whole layer fades between the colors
+    EFFECT_NOISE                = 5, // Value noise between the colors, the parameter is the size of a noise cell (log2 of the pixels)
+};
+
+enum effect_direction
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    EFFECT_DIRECTION_COLS       = 0, // Changes from column to column
+    EFFECT_DIRECTION_ROWS       = 1, // Changes from row to row
+    EFFECT_DIRECTION_DIAGONAL   = 2,
+};
+
+enum effect_stat
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    EFFECT_STAT_RENDERED_FRAMES = 0, // Number of frames rendered and committed
+    EFFECT_STAT_SKIPPED_FRAMES  = 1, // Number of frames skipped because the canvas wasn't available or the queue was full
+    EFFECT_STAT_RENDER_TIME_LAST = 2, // In microseconds
+    EFFECT_STAT_RENDER_TIME_MAX = 3, // In microseconds, must stay well below a scan cycle
+};
+
+// The speed is in 1/16 steps of the lookup tables per frame (so 16 runs through
+// the tables in 256 frames), a parameter of 0 selects the default of the effect.
+bool effect_start(enum effect_type effect, unsigned char speed, unsigned char param);
+void effect_stop(void);
+enum effect_type effect_get(void);
+bool effect_set_color(unsigned int index, struct layer_color color);
+bool effect_stat(enum effect_stat stat, unsigned int * out);
+
+// Renders the next frame of the running effect, in the layout of the layer canvas
+void effect_render(unsigned char * frame);
+
+#endif /* EFFECT_H */
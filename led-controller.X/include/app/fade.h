@@ -0,0 +1,18 @@
+#ifndef FADE_H
+#define FADE_H
+
+#define FADE_WEIGHT_BITS            8
+#define FADE_WEIGHT_MAX             (1 << FADE_WEIGHT_BITS) // Weight at which the row equals the destination row
+
+// Crossfade between two rows of 12 bit channels, packed the way the TLC5940 expects them
+// (see tlc5940_pack). The channels are blended as they are sent, after the lookup tables,
+// so the blending is linear in the light output: the lookup tables take care of the gamma
+// of the 8 bit color depth, and the 12 bit color depth is expected to be linear already.
+void fade_row(
+    unsigned char * row,
+    unsigned char const * from,
+    unsigned char const * to,
+    unsigned int channels,
+    unsigned int weight);
+
+#endif /* FADE_H */
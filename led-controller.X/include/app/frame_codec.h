@@ -0,0 +1,82 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FRAME_RLE_LITERAL_MAX       128 // Maximum number of bytes of a literal run
+#define FRAME_RLE_REPEAT_MIN        2   // Minimum number of bytes of a repeat run
+#define FRAME_RLE_REPEAT_MAX        129 // Maximum number of bytes of a repeat run
+#define FRAME_PALETTE_SIZE          256 // Number of palette entries
+#define FRAME_NUM_OF_PLANES         3   // Red, green and blue
+#define FRAME_PLANE(plane)          (1 << (plane)) // Plane mask of the rows encoding, plane 0 is red
+
+enum frame_encoding
+{
+    // Note: do not change the order, since this is used over the SPI protocol
+    FRAME_ENCODING_RAW          = 0, // Frame as is
+    FRAME_ENCODING_RLE          = 1, // Run length encoded frame
+    FRAME_ENCODING_DELTA        = 2, // Run length encoded XOR of the frame with the previous frame
+    FRAME_ENCODING_PALETTE      = 3, // One palette index per pixel
+    FRAME_ENCODING_PALETTE_LOAD = 4, // Palette entries to load, followed by one palette index per pixel
+    FRAME_ENCODING_ROWS         = 5, // Rows to update in place, the other rows are left as is
+
+    FRAME_ENCODING_COUNT,
+};
+
+struct __attribute__((packed)) frame_header
+{
+    uint8_t encoding;
+    uint8_t                     :8;
+    uint16_t size; // Number of data bytes following the header
+};
+
+struct frame_palette
+{
+    // Stored per color plane, just like the frames
+    unsigned char red[FRAME_PALETTE_SIZE];
+    unsigned char green[FRAME_PALETTE_SIZE];
+    unsigned char blue[FRAME_PALETTE_SIZE];
+};
+
+struct __attribute__((packed)) frame_palette_load
+{
+    uint8_t first; // First palette entry to load
+    uint8_t count; // Number of entries to load minus one
+    // Followed by the RGB triplets of the entries
+};
+
+struct __attribute__((packed)) frame_rows
+{
+    uint8_t first; // First row to update
+    uint8_t count; // Number of rows minus one
+    uint8_t planes; // Mask of the planes to update, see FRAME_PLANE
+    uint8_t                     :8;
+    // Followed by the rows of every plane in the mask, in plane order
+};
+
+// Decodes the data into the frame, which is planar: the red, green and blue planes
+// follow each other. The frame must hold the previous frame for the delta encoding
+// and the palette is only needed for the palette encodings, it is kept across frames.
+// Returns false if the data does not decode into exactly one frame, the frame is
+// garbage after a failed delta decode. The rows encoding is decoded by frame_decode_rows.
+bool frame_decode(
+    enum frame_encoding encoding,
+    unsigned char * frame,
+    unsigned int frame_size,
+    struct frame_palette * palette,
+    unsigned char const * data,
+    unsigned int size);
+
+// Decodes the rows encoding into the frame, which has the given number of rows per
+// plane. Only the rows in the data are written, and only if the data is valid. The
+// updated rows are returned through updated, so only those need to be processed.
+bool frame_decode_rows(
+    unsigned char * frame,
+    unsigned int frame_size,
+    unsigned int rows,
+    unsigned char const * data,
+    unsigned int size,
+    struct frame_rows * updated);
+
+#endif /* FRAME_CODEC_H */
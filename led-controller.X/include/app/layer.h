@@ -1,24 +1,193 @@
 #ifndef LAYER_H
 #define LAYER_H
 
+#include <app/frame_codec.h>
+#include <stdint.h>
 #include <stdbool.h>
 
+#define LAYER_NUM_OF_ROWS           16
+#define LAYER_NUM_OF_COLS           16
+#define LAYER_NUM_OF_LEDS           (LAYER_NUM_OF_ROWS * LAYER_NUM_OF_COLS)
+#define LAYER_RED_OFFSET            (LAYER_NUM_OF_LEDS * 0) // Frames in the 8 bit color depth are planar, one byte per channel
+#define LAYER_GREEN_OFFSET          (LAYER_NUM_OF_LEDS * 1)
+#define LAYER_BLUE_OFFSET           (LAYER_NUM_OF_LEDS * 2)
+#define LAYER_FRAME_DEPTH           3 // RGB
+#define LAYER_FRAME_BUFFER_SIZE     (LAYER_NUM_OF_LEDS * LAYER_FRAME_DEPTH)
+
 enum layer_buffer_swap_mode
 {
     LAYER_BUFFER_SWAP_MANUAL = 0,
     LAYER_BUFFER_SWAP_AUTO,
 };
 
+// Framed and timed frames: the host must release the slave select after every frame (including
+// its header), a frame that is truncated or too long is dropped at that point to resync with the
+// host. Raw frames aren't resynced, so the host may keep the slave select low.
+enum layer_ingest_mode
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    LAYER_INGEST_RAW            = 0, // Every frame is sent as is
+    LAYER_INGEST_FRAMED         = 1, // Every frame is preceded by a header, see struct frame_header
+    LAYER_INGEST_TIMED          = 2, // Framed, but with the timing of the frame in the header, see struct layer_timed_header
+};
+
+enum layer_timing
+{
+    // Note: do not change the order, since this is used over the SPI protocol
+    LAYER_TIMING_NONE           = 0, // Presented on a buffer swap, just like a frame without timing
+    LAYER_TIMING_PRESENT        = 1, // Presented once the cube time (lower 32 bits, see clock_get_time) reaches the time
+    LAYER_TIMING_HOLD           = 2, // Presented once the previous frame is held long enough, then held for the time itself
+};
+
+struct __attribute__((packed)) layer_timed_header
+{
+    struct frame_header frame;
+    uint8_t timing; // See enum layer_timing
+    uint8_t                     :8;
+    uint16_t                    :16;
+    uint32_t time; // In microseconds
+};
+
+enum layer_color_depth
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    LAYER_COLOR_DEPTH_8         = 0, // One byte per channel
+    LAYER_COLOR_DEPTH_12        = 1, // Two channels packed in three bytes, most significant bits first
+};
+
+enum layer_channel
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    LAYER_CHANNEL_RED           = 0,
+    LAYER_CHANNEL_GREEN         = 1,
+    LAYER_CHANNEL_BLUE          = 2,
+};
+
+enum layer_stat
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    LAYER_STAT_RECEIVED_FRAMES  = 0, // Number of frames received and eligible for a buffer swap
+    LAYER_STAT_DROPPED_FRAMES   = 1, // Number of framed frames that failed to decode
+    LAYER_STAT_PARTIAL_FRAMES   = 2, // Number of received frames that only updated some rows
+    LAYER_STAT_QUEUED_FRAMES    = 3, // Number of frames waiting to be presented
+    LAYER_STAT_QUEUE_OVERFLOWS  = 4, // Number of frames dropped because the frame queue was full, see layer_set_fade as well
+    LAYER_STAT_LATE_FRAMES      = 5, // Number of frames presented more than a scan cycle after their presentation time
+    LAYER_STAT_STREAMED_ROWS    = 6, // Number of rows drawn in low latency mode before their frame was completely received
+    LAYER_STAT_RESYNCS          = 7, // Number of truncated frames dropped at the rising edge of the slave select
+    LAYER_STAT_DMA_RECOVERIES   = 8, // Number of automatic DMA resets after a DMA error
+    LAYER_STAT_COMMITTED_FRAMES = 9, // Number of frames drawn on the device and committed from the canvas
+    LAYER_STAT_INGEST_TIME_MAX  = 10, // In microseconds, longest decode and pack of a frame with the DMA interrupt held off
+    LAYER_STAT_KEYFRAME_NEEDED  = 11, // 1 if a frame failed to decode since the last raw or run length encoded frame
+};
+
 bool layer_busy(void);
 bool layer_ready(void);
 bool layer_exec_lod(void);
 bool layer_dma_error(void);
 void layer_dma_reset(void);
 bool layer_dma_swap_buffers(void);
+bool layer_dma_arm_buffer_swap(void);
+bool layer_dma_commit_buffer_swap(void);
+unsigned int layer_get_missed_buffer_swap_commits(void);
 enum layer_buffer_swap_mode layer_get_buffer_swap_mode(void);
 void layer_set_buffer_swap_mode(enum layer_buffer_swap_mode mode);
+enum layer_ingest_mode layer_get_ingest_mode(void);
+bool layer_set_ingest_mode(enum layer_ingest_mode mode);
+enum layer_color_depth layer_get_color_depth(void);
+bool layer_set_color_depth(enum layer_color_depth depth);
+
+// In low latency mode every row is drawn as soon as it is received, instead of
+// waiting for the whole frame and the buffer swap. Rows of different frames can
+// be drawn at once (tearing), and it's only available in the raw ingest mode.
+bool layer_get_low_latency(void);
+bool layer_set_low_latency(bool enable);
+bool layer_stat(enum layer_stat stat, unsigned int * out);
 
-// Used for test suite
+// Lookup tables that map the 8 bit color depth to the 12 bit TLC5940 grayscale,
+// one per color so they can do both the gamma and white balance correction. The
+// values have 4 fractional bits, which are either rounded or temporally dithered.
+bool layer_lut_write(enum layer_channel channel, unsigned char index, unsigned short value);
+void layer_lut_reset(void);
+bool layer_get_dither(void);
+bool layer_set_dither(bool enable);
+
+// Crossfade from the previous frame to the presented frame over the given number of scan
+// cycles after every buffer swap, so a stream of few frames per second moves smoothly and
+// cuts between scenes aren't abrupt. The channels are blended as they're sent, in linear
+// light as they have passed the lookup tables. A frame that's presented while fading fades
+// from the frame that was drawn, which is cut short. The frame that's faded from takes one of
+// the queued images until the fade ends. Set it to about the scan cycles between frames to
+// interpolate a stream, 0 disables it.
+unsigned int layer_get_fade(void);
+bool layer_set_fade(unsigned int cycles);
+
+// Remap of the pixels for the orientation the layer is mounted in, so the host sends the
+// same frames to every cube. Every pixel takes the pixel of the received (or drawn) frame
+// at its entry of the remap table while the frame is packed, which is generated for the
+// rotations (clockwise) and mirrors. The custom remap uses the table as it's written, so
+// write the table before selecting it. Partial frames are packed as a whole while remapped,
+// and in low latency mode a row can show pixels of rows that aren't received yet. Only built
+// with LAYER_REMAP defined (see layer_config.h), otherwise the frames are packed as they are.
+enum layer_remap
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    LAYER_REMAP_NONE            = 0,
+    LAYER_REMAP_ROTATE_90       = 1,
+    LAYER_REMAP_ROTATE_180      = 2,
+    LAYER_REMAP_ROTATE_270      = 3,
+    LAYER_REMAP_MIRROR_X        = 4, // Left to right
+    LAYER_REMAP_MIRROR_Y        = 5, // Top to bottom
+    LAYER_REMAP_TRANSPOSE       = 6, // Mirrored along the diagonal from the top left
+    LAYER_REMAP_ANTI_TRANSPOSE  = 7, // Mirrored along the diagonal from the top right
+    LAYER_REMAP_CUSTOM          = 8,
+};
+
+enum layer_remap layer_get_remap(void);
+bool layer_set_remap(enum layer_remap remap);
+bool layer_remap_write(unsigned int index, unsigned char const * sources, unsigned int count); // Index of the first pixel in row-major order
+
+// Geometry of the panel the layer drives, for panels with fewer rows or other wiring than
+// the board. Only the given number of rows from the top of the frame is scanned, which
+// shortens the scan cycle, in the given order. The row map selects the row pin of the board
+// that drives every row. These take effect at the next reset, so save the settings after
+// changing them (see settings_save). The columns and the number of TLC5940s are fixed.
+enum layer_scan_order
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    LAYER_SCAN_INCREMENTAL      = 0,
+    LAYER_SCAN_INTERLACED       = 1, // The odd rows first, then the even rows
+};
+
+void layer_get_geometry(unsigned int * rows, enum layer_scan_order * order);
+bool layer_set_geometry(unsigned int rows, enum layer_scan_order order);
+bool layer_row_map_write(unsigned int row, unsigned char const * pins, unsigned int count); // Pins are indexed from the top row of the board
+unsigned int layer_scan_period(void); // In microseconds, one scan cycle of the rows being scanned
+
+// Layer settings that are kept in the flash, see settings_save
+struct __attribute__((packed)) layer_settings
+{
+    uint8_t remap; // See enum layer_remap
+    uint8_t scan_rows;
+    uint8_t scan_order; // See enum layer_scan_order
+    uint8_t                     :8;
+    uint8_t remap_table[LAYER_NUM_OF_LEDS]; // Pixel of the frame every pixel takes
+    uint8_t row_map[LAYER_NUM_OF_ROWS]; // Pin of every row
+};
+
+void layer_get_settings(struct layer_settings * out);
+bool layer_load_settings(struct layer_settings const * settings);
+
+// Frames drawn on the device (e.g. the effects) are drawn into the canvas, which is a frame
+// in the 8 bit color depth layout, and queued on a commit just like a received frame. The
+// canvas holds the last drawn or decoded frame: a frame that's decoded after the canvas was
+// drawn on replaces what's drawn once the canvas is taken again, so frames shouldn't be
+// received while drawing. It's not available (NULL) in low latency mode or in the 12 bit
+// color depth. A committed frame follows the buffer swap mode, unless it's presented right
+// away, and the commit fails if the queue is full. Only to be used outside of the interrupts.
+unsigned char * layer_canvas(void);
+bool layer_canvas_commit(bool present);
+
+// Used for test suite and the colors of the effects
 struct layer_color
 {
     unsigned char r;
@@ -26,6 +195,53 @@ struct layer_color
     unsigned char b;
 };
 
+// The overlay is a second frame in the 8 bit color depth layout, which is composited over every
+// frame while it's packed (e.g. a status indicator over the frames of the host). Its pixels are
+// blended with the opacity, except for the pixels of the key color which are transparent. The
+// frame underneath is kept in the canvas, so a commit of the overlay repacks it with the overlay
+// without the host sending it again. It's presented right away, unless a frame is queued, which
+// then shows the overlay once it's presented. A frame that is packed while the overlay is being
+// drawn shows it partially drawn, as there's no memory to double buffer the overlay.
+enum layer_draw_target
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    LAYER_DRAW_CANVAS           = 0,
+    LAYER_DRAW_OVERLAY          = 1,
+};
+
+bool layer_set_overlay(unsigned char opacity, struct layer_color key); // An opacity of 0 disables the overlay
+bool layer_set_draw_target(enum layer_draw_target target);
+bool layer_overlay_commit(void);
+
+// Drawing primitives on the draw target, so the host can update part of a frame without sending
+// all of it. Areas are clipped to the layer and filled a word of the planes at a time. They
+// fail if the canvas isn't available, and what's drawn is shown once the target is committed.
+// Only built with LAYER_DRAW defined, see layer_config.h.
+bool layer_fill_rect(
+    unsigned int x,
+    unsigned int y,
+    unsigned int width,
+    unsigned int height,
+    struct layer_color color);
+bool layer_draw_line(unsigned int x, unsigned int y, unsigned int length, bool vertical, struct layer_color color);
+bool layer_fill_run(unsigned int index, unsigned int count, struct layer_color color); // Index of the first pixel in row-major order
+bool layer_fill_plane(enum layer_channel channel, unsigned char value);
+bool layer_copy_rect(
+    unsigned int x,
+    unsigned int y,
+    unsigned int width,
+    unsigned int height,
+    unsigned int dst_x,
+    unsigned int dst_y);
+bool layer_scroll_rect( // Moves the contents of the area by dx and dy, the area that is uncovered is filled
+    unsigned int x,
+    unsigned int y,
+    unsigned int width,
+    unsigned int height,
+    int dx,
+    int dy,
+    struct layer_color fill);
+
 void layer_draw_pixel(unsigned char x, unsigned char y, struct layer_color color);
 void layer_draw_all_pixels(struct layer_color color);
 void layer_clear_all_pixels(void);
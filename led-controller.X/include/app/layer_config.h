@@ -1,6 +1,17 @@
 #ifndef LAYER_CONFIG_H
 #define LAYER_CONFIG_H
 
-#define LAYER_INTERLACED    // Comment to use incremental scanning of the rows
+#define LAYER_INTERLACED    // Comment to default to incremental scanning of the rows, see layer_set_geometry
+//#define LAYER_DEEP_COLOR  // Uncomment to enable the 12 bit color depth, which takes 1.5 KB more RAM for the receive buffers and decoded frames
+//#define LAYER_DITHER      // Uncomment to enable the temporal dithering, which takes 384 bytes more RAM per image for the fractions
+//#define LAYER_DRAW        // Uncomment to enable the drawing primitives, see layer_fill_rect
+//#define LAYER_REMAP       // Uncomment to enable the remap of the pixels, which takes 256 bytes more RAM for its table
+//#define LAYER_OVERLAY     // Uncomment to enable the overlay, which takes 768 bytes more RAM for its frame and needs LAYER_DRAW
+
+// Every queued frame takes an image of 1152 bytes of RAM, 1536 bytes with the dithering. The part has
+// 16 KB of RAM, of which 1 KB is the stack, and the defaults take about 13.5 KB of it with three queued
+// frames. Lower it to 2 when enabling the dithering, the 12 bit color depth or the effects, animations
+// and sprites together, make ram of the host tools checks the budget for the enabled options.
+#define LAYER_FRAME_QUEUE_DEPTH     3 // Number of frames that can be queued ahead of the frame being drawn
 
 #endif /* LAYER_CONFIG_H */
\ No newline at end of file
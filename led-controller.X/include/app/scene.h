@@ -0,0 +1,87 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <app/layer.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCENE_NUM_OF_PRIMITIVES     16
+#define SCENE_PRIMITIVE_WORDS       3 // Words per primitive on the bus
+
+// The scene is a volume of which every layer of the cube is a slice, the x and y coordinates
+// are the columns and rows of a layer and the z coordinate is the bus address of the layer.
+// Coordinates are in pixels, and later primitives are drawn over earlier ones.
+enum scene_type
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    SCENE_NONE                  = 0, // Skipped
+    SCENE_SPHERE                = 1, // Solid ball
+    SCENE_SHELL                 = 2, // Surface of a ball, a pixel thick
+    SCENE_BOX                   = 3, // Solid box between two corners, inclusive
+    SCENE_PLANE                 = 4, // Points p with n . p = d, thickened by the given number of pixels on both sides
+    SCENE_POINT                 = 5,
+};
+
+struct __attribute__((packed)) scene_primitive
+{
+    uint8_t type; // See enum scene_type
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    union __attribute__((packed))
+    {
+        struct
+        {
+            uint8_t x;
+            uint8_t y;
+            uint8_t z;
+            uint8_t radius;
+        } sphere; // Also the shell
+        struct
+        {
+            uint8_t x0;
+            uint8_t y0;
+            uint8_t z0;
+            uint8_t x1;
+            uint8_t y1;
+            uint8_t z1;
+        } box;
+        struct
+        {
+            int8_t nx;
+            int8_t ny;
+            int8_t nz;
+            uint8_t thickness;
+            int16_t d;
+        } plane;
+        struct
+        {
+            uint8_t x;
+            uint8_t y;
+            uint8_t z;
+        } point;
+        uint8_t params[8];
+    };
+};
+
+enum scene_stat
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    SCENE_STAT_PRIMITIVES       = 0, // Number of primitives in the scene
+    SCENE_STAT_RENDERED_FRAMES  = 1, // Number of slices rendered and committed
+    SCENE_STAT_RENDER_TIME_LAST = 2, // In microseconds
+    SCENE_STAT_RENDER_TIME_MAX  = 3, // In microseconds
+};
+
+// The scene is broadcast to all layers as a list of struct scene_primitive, a word at a time,
+// and then committed by a broadcast. Every layer renders its own slice of the scene. Only
+// built when SCENE_ENABLE is defined.
+void scene_clear(void);
+bool scene_push_word(unsigned int word);
+bool scene_commit(bool present);
+bool scene_stat(enum scene_stat stat, unsigned int * out);
+
+// Renders the slice of this layer, in the layout of the layer canvas
+void scene_render(unsigned char * frame);
+
+#endif /* SCENE_H */
@@ -0,0 +1,34 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <app/layer.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SETTINGS_MAGIC              0x53544553 // "SETS"
+
+// The settings that survive a reset are kept in a flash page of the app memory (see NVM_PAGE),
+// which starts with this header. They're loaded at boot, a page that doesn't hold valid
+// settings of this size (e.g. never saved, or erased by a firmware update) leaves the defaults.
+struct __attribute__((packed)) settings_header
+{
+    uint32_t magic;
+    uint16_t size; // Number of bytes of the settings following the header
+    uint16_t crc; // CRC16 of the settings, see crc16_update
+};
+
+struct __attribute__((packed)) settings
+{
+    struct layer_settings layer;
+};
+
+// The settings are saved as they are at the time of the call, which takes a flash page erase
+// and a row write. The row is written from the flash row buffer, so they can't be saved while
+// another user owns it, e.g. while an animation row is being uploaded (see nvm_buffer_acquire).
+bool settings_busy(void);
+bool settings_ready(void);
+bool settings_error(void);
+bool settings_save(void);
+bool settings_erase(void); // The defaults are used from the next reset on
+
+#endif /* SETTINGS_H */
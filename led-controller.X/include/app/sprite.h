@@ -0,0 +1,42 @@
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <app/layer.h>
+#include <stdbool.h>
+
+#define SPRITE_TILE_SIZE            4 // Width and height of a tile in pixels
+#define SPRITE_TILE_WORDS           2 // Words per tile, one 4 bit palette index per pixel, first pixel in the low nibble
+#define SPRITE_NUM_OF_TILES         64
+#define SPRITE_NUM_OF_SPRITES       8
+#define SPRITE_NUM_OF_COLORS        16 // Color 0 of a sprite is transparent
+#define SPRITE_MAP_COLS             (LAYER_NUM_OF_COLS / SPRITE_TILE_SIZE)
+#define SPRITE_MAP_ROWS             (LAYER_NUM_OF_ROWS / SPRITE_TILE_SIZE)
+#define SPRITE_SIZE_MAX             4 // In tiles
+
+enum sprite_stat
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    SPRITE_STAT_COMPOSED_FRAMES = 0, // Number of frames composed and committed
+    SPRITE_STAT_COMPOSE_TIME_LAST = 1, // In microseconds
+    SPRITE_STAT_COMPOSE_TIME_MAX = 2, // In microseconds, must stay well below a scan cycle
+};
+
+// Tiles, the palette and the tile map of the background are uploaded once, after which the
+// host only moves the sprites around and composes a frame. A sprite is a block of tiles that
+// follow each other in the tile pool, in row-major order. The frame is composed into the
+// layer canvas, the background first and then the sprites from low to high priority.
+// Only built when SPRITE_ENABLE is defined.
+void sprite_reset(void); // Hides all sprites and clears the tile map, the tiles and palette are kept
+bool sprite_set_color(unsigned int index, struct layer_color color);
+bool sprite_tile_address(unsigned int address); // In words, the following words are written from there on
+bool sprite_tile_push_word(unsigned int word);
+bool sprite_map_set(unsigned int cell, unsigned int tile); // Cell in row-major order
+bool sprite_set(unsigned int sprite, unsigned int tile, unsigned int width, unsigned int height, unsigned char priority); // Size in tiles, 0 hides the sprite
+bool sprite_move(unsigned int sprite, int x, int y); // Of the top left pixel, which may be outside the layer
+bool sprite_compose(bool present);
+bool sprite_stat(enum sprite_stat stat, unsigned int * out);
+
+// Composes the frame in the layout of the layer canvas
+void sprite_render(unsigned char * frame);
+
+#endif /* SPRITE_H */
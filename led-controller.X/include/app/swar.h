@@ -0,0 +1,64 @@
+#ifndef SWAR_H
+#define SWAR_H
+
+#include <stdint.h>
+
+// Byte arithmetic on four pixels at once (SIMD within a register), every byte
+// of a word is a separate lane and no carry or borrow crosses into another lane.
+
+#define SWAR_LANES                  4
+#define SWAR_LOW_BITS               0x7f7f7f7fU
+#define SWAR_HIGH_BITS              0x80808080U
+#define SWAR_EVEN_LANES             0x00ff00ffU
+
+typedef uint32_t __attribute__((may_alias)) swar_word_t; // To access a byte buffer by word, which must be word aligned
+
+inline static uint32_t __attribute__((always_inline)) swar_splat(unsigned char value)
+{
+    return value * 0x01010101U;
+}
+
+inline static uint32_t __attribute__((always_inline)) swar_avg(uint32_t a, uint32_t b)
+{
+    // Rounds down
+    return (a & b) + (((a ^ b) & ~0x01010101U) >> 1);
+}
+
+inline static uint32_t __attribute__((always_inline)) swar_add_sat(uint32_t a, uint32_t b)
+{
+    // Add the lower seven bits, then derive the carry out of every lane from the top bits
+    uint32_t sum = (a & SWAR_LOW_BITS) + (b & SWAR_LOW_BITS);
+    uint32_t carry = ((a & b) | ((a | b) & sum)) & SWAR_HIGH_BITS;
+    sum ^= (a ^ b) & SWAR_HIGH_BITS;
+    return sum | ((carry >> 7) * 0xff);
+}
+
+inline static uint32_t __attribute__((always_inline)) swar_sub_sat(uint32_t a, uint32_t b)
+{
+    // 255 - (255 - a + b) equals a - b, saturating the addition at 255 saturates the result at 0
+    return ~swar_add_sat(~a, b);
+}
+
+inline static uint32_t __attribute__((always_inline)) swar_mask_nonzero(uint32_t a)
+{
+    // The top bit of a lane is set by itself or by the carry of adding the lower seven bits to 0x7f
+    uint32_t high = (((a & SWAR_LOW_BITS) + SWAR_LOW_BITS) | a) & SWAR_HIGH_BITS;
+    return (high >> 7) * 0xff;
+}
+
+inline static uint32_t __attribute__((always_inline)) swar_scale(uint32_t a, unsigned int scale)
+{
+    // Multiplies every lane by scale / 256, the scale must not exceed 256. Even and odd
+    // lanes are multiplied separately, so every product has sixteen bits of room.
+    uint32_t even = (((a & SWAR_EVEN_LANES) * scale) >> 8) & SWAR_EVEN_LANES;
+    uint32_t odd = (((a >> 8) & SWAR_EVEN_LANES) * scale) & ~SWAR_EVEN_LANES;
+    return even | odd;
+}
+
+inline static uint32_t __attribute__((always_inline)) swar_lerp(uint32_t a, uint32_t b, unsigned int weight)
+{
+    // Weight of b out of 256, the rounded down parts add up to at most the larger lane
+    return swar_scale(a, 256 - weight) + swar_scale(b, weight);
+}
+
+#endif /* SWAR_H */
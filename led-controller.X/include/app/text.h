@@ -0,0 +1,32 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <app/layer.h>
+#include <stdbool.h>
+
+#define TEXT_LENGTH_MAX             64 // In characters
+#define TEXT_NUM_OF_COLORS          2 // Foreground and background
+
+enum text_stat
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    TEXT_STAT_RENDERED_COLUMNS  = 0, // Number of columns rendered, a column is rendered when it scrolls in
+    TEXT_STAT_SKIPPED_STEPS     = 1, // Number of scroll steps caught up at once because the canvas wasn't available in time
+    TEXT_STAT_RENDER_TIME_MAX   = 2, // In microseconds
+};
+
+// The text is a single line in a 5x7 font, which scrolls in from the right and out to the left
+// on the band of rows from the given row on. It's followed by a gap of a layer width, after
+// which it starts over. The scroll position follows the cube time (see clock_get_time), so the
+// scrolling isn't affected by the load of the host, and layers that are started together stay
+// in step. A speed of 0 shows the text from the left edge without scrolling. Only built when
+// TEXT_ENABLE is defined.
+void text_clear(void); // Also stops the text
+bool text_append(char const * text, unsigned int length);
+bool text_set_color(unsigned int index, struct layer_color color);
+bool text_start(unsigned int row, unsigned int speed); // Speed in columns per second
+void text_stop(void);
+bool text_running(void);
+bool text_stat(enum text_stat stat, unsigned int * out);
+
+#endif /* TEXT_H */
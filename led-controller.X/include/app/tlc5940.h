@@ -1,8 +1,11 @@
 #ifndef TLC5940_H
 #define TLC5940_H
 
+#include <app/tlc5940_config.h>
 #include <stdbool.h>
 
+#define TLC5940_IMAGE_SIZE      (24 * TLC5940_NUM_OF_DEVICES) // Size in bytes of the packed 12 bit channels of all devices
+
 enum tlc5940_mode
 {
     TLC5940_MODE_ENABLED = 0,
@@ -16,4 +19,12 @@ bool tlc5940_get_lod_error(void);
 void tlc5940_write(unsigned int device, unsigned int channel, unsigned short pwm_value);
 void tlc5940_write_channels_mode8(unsigned int device, unsigned char const * pwm_values);
 
+// Packed images are laid out exactly as they are shifted into the TLC5940's, an
+// image written with tlc5940_write_image() is sent as is without any copying. So
+// it must stay untouched until the next latch.
+void tlc5940_write_image(unsigned char const * image);
+void tlc5940_pack(unsigned char * image, unsigned int device, unsigned int channel, unsigned short pwm_value);
+void tlc5940_pack_channels_mode12(unsigned char * image, unsigned int device, unsigned char const * pwm_values);
+void tlc5940_pack_channels(unsigned char * image, unsigned int device, unsigned short const * pwm_values);
+
 #endif /* TLC5940_H */
\ No newline at end of file
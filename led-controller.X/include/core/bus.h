@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define BUS_FRAME_SIZE              8 // In bytes, of every request and response on the line
+
 enum bus_response_code
 {
     BUS_OK = 0,                         // Request OK and handled, must be 0
@@ -15,6 +17,16 @@ enum bus_response_code
     BUS_ERR_INVALID_COMMAND,            // Request command does not exist
 };
 
+enum bus_stat
+{
+    // Note: do not change the order, since this is used over the bus protocol
+    BUS_STAT_LATENCY_LAST       = 0, // In microseconds, from a complete request frame to its queued response
+    BUS_STAT_LATENCY_MIN        = 1,
+    BUS_STAT_LATENCY_MAX        = 2,
+    BUS_STAT_LATENCY_AVG        = 3,
+    BUS_STAT_RESPONSE_COUNT     = 4, // Number of responses the latency is measured over
+};
+
 union __attribute__((packed)) bus_data
 {
     // Generic types
@@ -43,6 +55,22 @@ union __attribute__((packed)) bus_data
         unsigned int                        :29;
     } by_bootloader_status;
 
+    struct
+    {
+        // Job masks, bit n corresponds to job ID n
+        unsigned char done;
+        unsigned char failed;
+        unsigned char running;
+        unsigned char               :8;
+    } by_job_status;
+
+    struct
+    {
+        unsigned char channel;
+        unsigned char index;
+        unsigned short value;
+    } by_lut_entry;
+
     struct
     {
         unsigned char major;
@@ -50,6 +78,156 @@ union __attribute__((packed)) bus_data
         unsigned char patch;
         unsigned char               :8;
     } by_version;
+
+    struct
+    {
+        unsigned char effect; // See enum effect_type
+        unsigned char speed;
+        unsigned char param;
+        unsigned char               :8;
+    } by_effect;
+
+    struct
+    {
+        unsigned char index;
+        unsigned char r;
+        unsigned char g;
+        unsigned char b;
+    } by_effect_color;
+
+    struct
+    {
+        unsigned char r;
+        unsigned char g;
+        unsigned char b;
+        unsigned char               :8;
+    } by_draw_color;
+
+    struct
+    {
+        unsigned char x;
+        unsigned char y;
+        unsigned char width;
+        unsigned char height;
+    } by_draw_rect;
+
+    struct
+    {
+        unsigned char x;
+        unsigned char y;
+        unsigned char length;
+        bool vertical;
+    } by_draw_line;
+
+    struct
+    {
+        unsigned short index; // Of the first pixel in row-major order
+        unsigned short count;
+    } by_draw_run;
+
+    struct
+    {
+        unsigned char channel; // See enum layer_channel
+        unsigned char value;
+        unsigned short              :16;
+    } by_draw_plane;
+
+    struct
+    {
+        // Area in nibbles, as bytes wouldn't fit
+        unsigned int x              :4;
+        unsigned int y              :4;
+        unsigned int width          :4; // Minus one
+        unsigned int height         :4; // Minus one
+        unsigned int dst_x          :4;
+        unsigned int dst_y          :4;
+        unsigned int                :8;
+    } by_draw_copy;
+
+    struct
+    {
+        unsigned int x              :4;
+        unsigned int y              :4;
+        unsigned int width          :4; // Minus one
+        unsigned int height         :4; // Minus one
+        signed int dx               :8;
+        signed int dy               :8;
+    } by_draw_scroll;
+
+    struct
+    {
+        unsigned char index;
+        unsigned char r;
+        unsigned char g;
+        unsigned char b;
+    } by_sprite_color;
+
+    struct
+    {
+        unsigned char cell;
+        unsigned char tile;
+        unsigned short              :16;
+    } by_sprite_map;
+
+    struct
+    {
+        unsigned char sprite;
+        unsigned char tile;
+        unsigned char width         :4; // In tiles
+        unsigned char height        :4;
+        unsigned char priority;
+    } by_sprite;
+
+    struct
+    {
+        unsigned char sprite;
+        signed char x;
+        signed char y;
+        unsigned char               :8;
+    } by_sprite_move;
+
+    char by_text[4]; // Characters to append, terminated early by a null character
+
+    struct
+    {
+        unsigned char index; // 0 for the foreground, 1 for the background
+        unsigned char r;
+        unsigned char g;
+        unsigned char b;
+    } by_text_color;
+
+    struct
+    {
+        unsigned char row;
+        unsigned char               :8;
+        unsigned short speed; // In columns per second
+    } by_text_start;
+
+    struct
+    {
+        unsigned char opacity;
+        unsigned char r; // Key color, which is transparent
+        unsigned char g;
+        unsigned char b;
+    } by_layer_overlay;
+
+    struct
+    {
+        unsigned char index; // Of the first pixel in row-major order
+        unsigned char sources[3]; // Pixels of the frame the pixels take
+    } by_layer_remap;
+
+    struct
+    {
+        unsigned char rows; // Scanned from the top of the frame
+        unsigned char order; // See enum layer_scan_order
+    } by_layer_geometry;
+
+    struct
+    {
+        unsigned char row; // Of the first pin
+        unsigned char pins[3]; // Row pins of the board the rows are driven by
+    } by_layer_row_map;
 };
 
 typedef enum bus_response_code (*bus_func_t)(
@@ -58,6 +236,12 @@ typedef enum bus_response_code (*bus_func_t)(
     union bus_data * response_data);
 
 bool bus_idle(void);
+bool bus_stat(enum bus_stat stat, unsigned int * out);
+unsigned int bus_request_ticks(void); // Core timer ticks at which the request being handled was received
+
+// Can be called from a bus_func_t that is handling a broadcast, the response
+// is then sent in the time slot of this node's address instead of being dropped
+void bus_respond_in_slot(void);
 
 #endif /* BUS_H */
 
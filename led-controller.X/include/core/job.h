@@ -0,0 +1,36 @@
+#ifndef JOB_H
+#define JOB_H
+
+#include <core/bus.h>
+#include <stdbool.h>
+
+#define JOB_POOL_SIZE   8 // Number of jobs that can be tracked at once, each job is one bit in a job mask
+#define JOB_ID_INVALID  -1
+#define JOB_MASK_ALL    0xff
+
+struct job_handler
+{
+    bool (*done)(void);     // Polled until it returns true
+    bool (*failed)(void);   // Evaluated once when done, may be NULL if the job can't fail
+};
+
+struct job_status
+{
+    // Job masks, bit n corresponds to job ID n
+    unsigned char done;
+    unsigned char failed;
+    unsigned char running;
+};
+
+int job_start(struct job_handler const * handler);
+void job_release(unsigned char mask); // Only finished jobs reported by job_get_status are released
+struct job_status job_get_status(void);
+
+// The job wait request of the app and the bootloader, see bus_func_t. A unicast request holds a
+// mask of the finished jobs the host is done with. Job IDs are local to a node, so a broadcast
+// holds a mask of the nodes instead, bit n for address n: a node of which the bit is set
+// releases the jobs it reported last, so the host only sets it if it received that report.
+// Responded with the job status, in a time slot to a broadcast if there's something to report.
+enum bus_response_code job_bus_wait(bool broadcast, union bus_data const * request_data, union bus_data * response_data);
+
+#endif /* JOB_H */
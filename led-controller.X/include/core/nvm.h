@@ -0,0 +1,49 @@
+#ifndef NVM_H
+#define	NVM_H
+
+#include <stdbool.h>
+#include <limits.h>
+
+// All in bytes
+#define NVM_WORD_SIZE       4
+#define NVM_DWORD_SIZE      (NVM_WORD_SIZE * 2)
+#define NVM_ROW_SIZE        512
+#define NVM_PAGE_SIZE       (NVM_ROW_SIZE * 8)
+#define NVM_ROW_BUFFER_SIZE (NVM_ROW_SIZE / NVM_WORD_SIZE)
+#define NVM_WORD_MAX        UINT_MAX
+
+typedef unsigned char nvm_byte_t;
+typedef unsigned int nvm_word_t;
+
+// Flash page of the app memory that the app writes at runtime (see the linker scripts), read
+// through its KSEG1 address (see KSEG1_ADDR) so it reads back what was just written to it. The
+// bootloader keeps a CRC of the whole app memory, which it checks before it runs the app, so
+// the last row of the page is kept for the words that seal it, see nvm_seal_page_virt.
+#define NVM_PAGE(name)      nvm_byte_t const name[NVM_PAGE_SIZE] __attribute__((section(".nvm_store"), aligned(NVM_PAGE_SIZE)))
+#define NVM_PAGE_DATA_SIZE  (NVM_PAGE_SIZE - NVM_ROW_SIZE)
+
+// Aligned buffer
+extern nvm_word_t nvm_row_buffer[NVM_ROW_BUFFER_SIZE];
+
+void nvm_init(void);
+void nvm_buffer_reset(void);
+
+// Users of the flash that fill the row buffer over time own it from filling it until the row is
+// written, so they don't fill it at the same time. The owner is any address of the user.
+bool nvm_buffer_acquire(void const * owner); // Also succeeds if it's owned by the owner already
+bool nvm_buffer_owned(void const * owner);
+void nvm_buffer_release(void const * owner); // Does nothing if it's not owned by the owner
+bool nvm_erase_page_phys(void const * address);
+bool nvm_erase_page_virt(void const * address);
+bool nvm_write_row_phys(void const * address);
+bool nvm_write_row_virt(void const * address);
+bool nvm_write_word_phys(void const * address, nvm_word_t word);
+bool nvm_write_word_virt(void const * address, nvm_word_t word);
+
+// Writes the next seal word of a page (see NVM_PAGE) after its rows were written, so the page
+// changes the CRC of the app memory as much as the erased page did, that is not at all. Also
+// fails if the seal words of the page are used up, the page has to be erased by then.
+bool nvm_seal_page_virt(void const * page);
+
+#endif	/* NVM_H */
+
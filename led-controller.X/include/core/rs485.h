@@ -3,6 +3,10 @@
 
 #include <stdbool.h>
 
+#define RS485_BAUDRATE              115200LU
+#define RS485_CHARACTER_BITS        10 // Start bit, 8 data bits and a stop bit, see RS485_UMODE_WORD
+#define RS485_TRANSFER_TIME(size)   ((size) * RS485_CHARACTER_BITS * 1000000LU / RS485_BAUDRATE) // In microseconds, of the given number of characters
+
 struct rs485_error
 {
     unsigned char perr  :1;
@@ -23,8 +27,12 @@ void rs485_register_error_notifier(struct rs485_error_notifier * const notifier)
 void rs485_reset(void);
 void rs485_transmit(unsigned char data);
 void rs485_transmit_buffer(unsigned char * buffer, unsigned int size);
+// Skips the backoff after receiving data, for a caller that keeps the line free by itself (e.g.
+// a node responding in its time slot, right after the node of the previous slot)
+void rs485_transmit_buffer_now(unsigned char * buffer, unsigned int size);
 bool rs485_bytes_available(void);
 unsigned char rs485_read(void);
 unsigned int rs485_read_buffer(unsigned char * buffer, unsigned int max_size);
+unsigned int rs485_read_ticks(void); // Core timer ticks at which the last character read was received
 
 #endif /* RS485 */
\ No newline at end of file
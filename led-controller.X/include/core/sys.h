@@ -10,6 +10,10 @@
     #error "System peripheral bus clock could not be calculated, please define the _SYS_CLK and _PB_DIV." 
 #endif
 
+#define SYS_CORE_TIMER_CLOCK        ((unsigned long long)(_SYS_CLK / 2)) // Core timer runs at half the system clock
+#define SYS_CORE_TICKS_TO_US(ticks) ((unsigned int)(((unsigned long long)(ticks) * 1000000LU) / SYS_CORE_TIMER_CLOCK))
+#define SYS_US_TO_CORE_TICKS(us)    ((unsigned int)(((unsigned long long)(us) * SYS_CORE_TIMER_CLOCK) / 1000000LU))
+
 #define SYS_FAIL_IF(expression)     if(expression) { exit(EXIT_FAILURE); }
 #define SYS_FAIL_IF_NOT(expression) SYS_FAIL_IF(!(expression))
 
@@ -17,6 +21,7 @@
 #define SYS_TUCK_IN_BONZO()         WDTCONbits.ON = 0
 #define SYS_WAKEUP_BONZO()          WDTCONbits.ON = 1
 #define SYS_FEED_BONZO()            WDTCONbits.WDTCLR = 1
+#define SYS_CORE_TICKS()            ((unsigned int)_CP0_GET_COUNT())
 
 void sys_lock(void);
 void sys_unlock(void);
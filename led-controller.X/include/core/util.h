@@ -19,6 +19,9 @@
 // Converting KUSEG virt to phy address: `virt + 0x40000000`
 #define PHY_ADDR(virt)                  ((int)virt < 0 ? ((int)virt & 0x1fffffffl) : (unsigned int)((unsigned char*)virt + 0x40000000L))
 
+// Converting KSEG0 virt to KSEG1 virt (uncached) address: `virt | 0x20000000`
+#define KSEG1_ADDR(virt)                ((void *)((unsigned long)(virt) | 0x20000000UL))
+
 // Atomic register utils
 #define ATOMIC_REG(name)                atomic_reg_group_t name
 #define ATOMIC_REG_VALUE(reg)           ATOMIC_REG_PTR_VALUE(&reg)
@@ -29,9 +32,11 @@
 #define ATOMIC_REG_PTR(name)            atomic_reg_group_t * name
 #define ATOMIC_REG_PTR_CAST(addr)       ((atomic_reg_group_t *)addr)
 #define ATOMIC_REG_PTR_VALUE(reg)       *(((atomic_reg_ptr_t)reg) + 0)
+#ifndef ATOMIC_REG_PTR_CLR // May be provided by a simulated device header
 #define ATOMIC_REG_PTR_CLR(reg, mask)   *(((atomic_reg_ptr_t)reg) + 1) = mask
 #define ATOMIC_REG_PTR_SET(reg, mask)   *(((atomic_reg_ptr_t)reg) + 2) = mask
 #define ATOMIC_REG_PTR_INV(reg, mask)   *(((atomic_reg_ptr_t)reg) + 3) = mask
+#endif
 
 typedef volatile unsigned int atomic_reg_t;
 typedef atomic_reg_t * atomic_reg_ptr_t;
@@ -0,0 +1,292 @@
+#ifdef ANIMATION_ENABLE
+#include <app/animation.h>
+#include <app/layer.h>
+#include <app/frame_codec.h>
+#include <app/clock.h>
+#include <core/kernel_task.h>
+#include <core/nvm.h>
+#include <core/bus.h>
+#include <core/sys.h>
+#include <core/util.h>
+#include <core/assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#define ANIMATION_HEADER_SIZE       sizeof(struct animation_header)
+#define ANIMATION_FRAME_HEADER_SIZE sizeof(struct frame_header)
+#define ANIMATION_STORE             ((nvm_byte_t const *)KSEG1_ADDR(animation_store))
+#define ANIMATION_STORE_SIZE        NVM_PAGE_DATA_SIZE
+#define ANIMATION_DATA_START        (ANIMATION_STORE + ANIMATION_HEADER_SIZE)
+#define ANIMATION_NO_PERIOD         (~0ULL)
+
+enum animation_state
+{
+    ANIMATION_IDLE = 0,
+
+    ANIMATION_ERASE_PAGE,
+    ANIMATION_BURN_ROW,
+
+    ANIMATION_ERROR,
+};
+
+static void animation_rtask_execute(void);
+KERN_SIMPLE_RTASK(animation, NULL, animation_rtask_execute)
+
+static NVM_PAGE(animation_store);
+
+static struct animation_header animation_header; // Of the animation being played, validated when it was started
+static void const * animation_row_burn_address;
+static unsigned int animation_row_cursor;
+static crc16_t animation_row_crc;
+static enum animation_state animation_state = ANIMATION_IDLE;
+static bool animation_is_playing;
+static unsigned long long animation_start_time; // In microseconds of cube time
+static nvm_byte_t const * animation_cursor; // Header of the next frame to decode
+static unsigned int animation_next_frame; // Index of the frame at the cursor
+static unsigned long long animation_shown_period; // Frame periods since the start time at which the shown frame was due
+static unsigned int animation_played_frames;
+static unsigned int animation_skipped_frames;
+static unsigned int animation_decode_time_max;
+
+static void animation_rewind(void)
+{
+    animation_cursor = ANIMATION_DATA_START;
+    animation_next_frame = 0;
+}
+
+static bool animation_decode(unsigned char * frame)
+{
+    nvm_byte_t const * end = ANIMATION_DATA_START + animation_header.size;
+    struct frame_header header;
+    bool decoded;
+
+    if ((unsigned int)(end - animation_cursor) < ANIMATION_FRAME_HEADER_SIZE)
+        return false;
+    memcpy(&header, animation_cursor, ANIMATION_FRAME_HEADER_SIZE);
+
+    // Decoded straight from the flash, there is no copy of the data in RAM
+    nvm_byte_t const * data = animation_cursor + ANIMATION_FRAME_HEADER_SIZE;
+    if ((unsigned int)(end - data) < header.size)
+        return false;
+    if (header.encoding == FRAME_ENCODING_ROWS) {
+        struct frame_rows rows;
+        decoded = frame_decode_rows(frame, LAYER_FRAME_BUFFER_SIZE, LAYER_NUM_OF_ROWS, data, header.size, &rows);
+    } else
+        decoded = frame_decode(header.encoding, frame, LAYER_FRAME_BUFFER_SIZE, NULL, data, header.size);
+
+    animation_cursor = data + header.size;
+    animation_next_frame++;
+    return decoded;
+}
+
+static void animation_play_execute(void)
+{
+    long long elapsed = (long long)(clock_get_time() - animation_start_time);
+    if (elapsed < 0)
+        return;
+
+    unsigned long long period = (unsigned long long)elapsed / (animation_header.frame_period * 1000U);
+    if (period == animation_shown_period)
+        return;
+
+    // Retried on the next run, once the layer is back in a mode with a canvas
+    unsigned char * canvas = layer_canvas();
+    if (canvas == NULL)
+        return;
+
+    // Every frame depends on the previous one, so frames are decoded in sequence. The
+    // frames that are due in the meantime are decoded but not shown, after the last
+    // frame the animation starts over.
+    unsigned int frame = period % animation_header.frames;
+    unsigned int start = SYS_CORE_TICKS();
+    if (frame < animation_next_frame)
+        animation_rewind();
+    while (animation_next_frame <= frame) {
+        if (!animation_decode(canvas)) {
+            animation_is_playing = false;
+            return;
+        }
+    }
+
+    unsigned int decode_time = SYS_CORE_TICKS_TO_US(SYS_CORE_TICKS() - start);
+    if (decode_time > animation_decode_time_max)
+        animation_decode_time_max = decode_time;
+    if (animation_shown_period != ANIMATION_NO_PERIOD)
+        animation_skipped_frames += (unsigned int)(period - animation_shown_period - 1);
+
+    if (layer_canvas_commit(true))
+        animation_played_frames++;
+    else
+        animation_skipped_frames++;
+    animation_shown_period = period;
+}
+
+static void animation_rtask_execute(void)
+{
+    switch (animation_state) {
+        default:
+        case ANIMATION_IDLE:
+            if (animation_is_playing)
+                animation_play_execute();
+            break;
+
+        case ANIMATION_ERASE_PAGE:
+            if (bus_idle()) // Since erasing a page is a blocking operation
+                animation_state = nvm_erase_page_virt(animation_store) ? ANIMATION_IDLE : ANIMATION_ERROR;
+            break;
+        case ANIMATION_BURN_ROW:
+            if (bus_idle()) {
+                // Sealed right away, the bootloader wouldn't run the app with the row written alone
+                bool ok = nvm_write_row_virt(animation_row_burn_address) && nvm_seal_page_virt(animation_store);
+                animation_row_cursor = 0;
+                crc16_reset(&animation_row_crc);
+                // Note buffer is automatically cleared after a successful write
+                nvm_buffer_release(&animation_row_cursor);
+                animation_state = ok ? ANIMATION_IDLE : ANIMATION_ERROR;
+            }
+            break;
+
+        case ANIMATION_ERROR:
+            // Do nothing until the store is erased again
+            break;
+    }
+}
+
+bool animation_busy(void)
+{
+    return animation_state != ANIMATION_IDLE;
+}
+
+bool animation_ready(void)
+{
+    return !animation_busy();
+}
+
+bool animation_error(void)
+{
+    return animation_state == ANIMATION_ERROR;
+}
+
+bool animation_erase(void)
+{
+    if (animation_busy() && !animation_error())
+        return false;
+
+    // Flash operations stall the CPU, so the display flickers while the store is written
+    animation_stop();
+    animation_row_cursor = 0; // Drops the row being uploaded
+    nvm_buffer_release(&animation_row_cursor);
+    animation_state = ANIMATION_ERASE_PAGE;
+    return true;
+}
+
+bool animation_row_reset(void)
+{
+    if (animation_busy())
+        return false;
+    if (!nvm_buffer_acquire(&animation_row_cursor)) // E.g. the settings are being saved
+        return false;
+
+    animation_row_cursor = 0;
+    nvm_buffer_reset();
+    crc16_reset(&animation_row_crc);
+    return true;
+}
+
+bool animation_row_crc16(unsigned short * out)
+{
+    ASSERT_NOT_NULL(out);
+    if (out == NULL)
+        return false;
+
+    if (animation_row_cursor < NVM_ROW_BUFFER_SIZE)
+        return false;
+
+    *out = animation_row_crc;
+    return true;
+}
+
+bool animation_row_push_word(unsigned int word)
+{
+    if (animation_busy() || !nvm_buffer_owned(&animation_row_cursor))
+        return false;
+    if (animation_row_cursor >= NVM_ROW_BUFFER_SIZE)
+        return false;
+
+    nvm_row_buffer[animation_row_cursor++] = word;
+    crc16_update(&animation_row_crc, &word, sizeof(word));
+    return true;
+}
+
+bool animation_row_burn(unsigned int offset)
+{
+    if (animation_busy() || !nvm_buffer_owned(&animation_row_cursor))
+        return false;
+    if (animation_row_cursor < NVM_ROW_BUFFER_SIZE)
+        return false;
+    if (offset % NVM_ROW_SIZE || offset > ANIMATION_STORE_SIZE - NVM_ROW_SIZE)
+        return false;
+
+    animation_stop();
+    animation_row_burn_address = animation_store + offset;
+    animation_state = ANIMATION_BURN_ROW;
+    return true;
+}
+
+bool animation_play(unsigned int start_time)
+{
+    if (animation_busy())
+        return false;
+
+    // The store is validated once, the frames are checked while decoding
+    struct animation_header header;
+    crc16_t crc;
+    memcpy(&header, ANIMATION_STORE, ANIMATION_HEADER_SIZE);
+    if (header.magic != ANIMATION_MAGIC
+        || header.frames == 0
+        || header.frame_period == 0
+        || header.size > ANIMATION_STORE_SIZE - ANIMATION_HEADER_SIZE)
+        return false;
+    crc16_reset(&crc);
+    crc16_update(&crc, ANIMATION_DATA_START, header.size);
+    if (crc != header.crc)
+        return false;
+
+    // Extend the start time to the 64 bit cube time, it may be in the past or the future
+    unsigned long long now = clock_get_time();
+    animation_start_time = now + (int)(start_time - (unsigned int)now);
+    animation_header = header;
+    animation_shown_period = ANIMATION_NO_PERIOD;
+    animation_rewind();
+    animation_is_playing = true;
+    return true;
+}
+
+void animation_stop(void)
+{
+    // The last frame is kept
+    animation_is_playing = false;
+}
+
+bool animation_playing(void)
+{
+    return animation_is_playing;
+}
+
+bool animation_stat(enum animation_stat stat, unsigned int * out)
+{
+    ASSERT_NOT_NULL(out);
+    if (out == NULL)
+        return false;
+
+    switch (stat) {
+        case ANIMATION_STAT_STORE_SIZE:         *out = ANIMATION_STORE_SIZE;        break;
+        case ANIMATION_STAT_PLAYED_FRAMES:      *out = animation_played_frames;     break;
+        case ANIMATION_STAT_SKIPPED_FRAMES:     *out = animation_skipped_frames;    break;
+        case ANIMATION_STAT_DECODE_TIME_MAX:    *out = animation_decode_time_max;   break;
+        default:                                                                    return false;
+    }
+
+    return true;
+}
+#endif
@@ -1,16 +1,59 @@
 #include <core/bus.h>
 #include <core/assert.h>
+#include <core/job.h>
 #include <core/timer.h>
 #include <core/sys.h>
+#include <app/clock.h>
 #include <app/layer.h>
+#include <app/layer_config.h>
+#include <app/effect.h>
+#include <app/animation.h>
+#include <app/sprite.h>
+#include <app/text.h>
+#include <app/scene.h>
+#include <app/settings.h>
 #include <version.h>
 #include <stddef.h>
+#include <string.h>
 
 #define BUS_FUNCS_SIZE      (sizeof(bus_funcs) / sizeof(bus_func_t))
 #define UNUSED1(x)          ((void)x)
 #define UNUSED2(x, y)       ((void)x);((void)y)
 #define UNUSED3(x, y, z)    ((void)x);((void)y);((void)z)
 
+#ifdef LAYER_DRAW
+static struct layer_color bus_draw_color; // Of the drawing commands, until the host sets another
+#endif
+
+static struct job_handler const bus_job_layer_exec_lod =
+{
+    .done = layer_ready,
+};
+
+#ifdef ANIMATION_ENABLE
+static bool bus_job_animation_done(void)
+{
+    return animation_ready() || animation_error();
+}
+
+static struct job_handler const bus_job_animation =
+{
+    .done = bus_job_animation_done,
+    .failed = animation_error,
+};
+#endif
+
+static bool bus_job_settings_done(void)
+{
+    return settings_ready() || settings_error();
+}
+
+static struct job_handler const bus_job_settings =
+{
+    .done = bus_job_settings_done,
+    .failed = settings_error,
+};
+
 static enum bus_response_code bus_func_layer_auto_buffer_swap(
     bool broadcast,
     union bus_data const * request_data,
@@ -31,11 +74,14 @@ static enum bus_response_code bus_func_layer_exec_lod(
     union bus_data const * request_data,
     union bus_data * response_data)
 {
-    UNUSED3(broadcast, request_data, response_data);
+    UNUSED2(broadcast, request_data);
 
-    return layer_exec_lod()
-        ? BUS_OK
-        : BUS_ERR_AGAIN;
+    if (!layer_exec_lod())
+        return BUS_ERR_AGAIN;
+
+    // If no job could be started the host has to fall back to polling the status
+    response_data->by_int8 = job_start(&bus_job_layer_exec_lod);
+    return BUS_OK;
 }
 
 static enum bus_response_code bus_func_layer_dma_reset(
@@ -132,6 +178,884 @@ static enum bus_response_code bus_func_layer_clear(
     return BUS_OK;
 }
 
+static enum bus_response_code bus_func_bus_stat(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    unsigned int result;
+    if (!bus_stat(request_data->by_uint8, &result))
+        return BUS_ERR_INVALID_PAYLOAD;
+    response_data->by_uint32 = result;
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_layer_dma_arm_buffer_swap(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(request_data);
+
+    if (!layer_dma_arm_buffer_swap())
+        return BUS_ERR_AGAIN;
+
+    // Acknowledge an armed broadcast in our time slot, while the host carries on
+    response_data->by_uint32 = layer_get_missed_buffer_swap_commits();
+    if (broadcast)
+        bus_respond_in_slot();
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_layer_dma_commit_buffer_swap(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, request_data);
+
+    bool committed = layer_dma_commit_buffer_swap();
+    response_data->by_uint32 = layer_get_missed_buffer_swap_commits();
+    return committed
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_clock_sync(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // Request payload is the master's time in microseconds when it started sending the frame
+    clock_sync(request_data->by_uint32, bus_request_ticks());
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_clock_stat(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    unsigned int result;
+    if (!clock_stat(request_data->by_uint8, &result))
+        return BUS_ERR_INVALID_PAYLOAD;
+    response_data->by_uint32 = result;
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_layer_ingest_mode(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return layer_set_ingest_mode(request_data->by_uint8)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_layer_color_depth(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return layer_set_color_depth(request_data->by_uint8)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_layer_lut_write(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // Can be broadcasted so all layers are corrected alike, at the cost of not knowing if it failed
+    return layer_lut_write(request_data->by_lut_entry.channel, request_data->by_lut_entry.index, request_data->by_lut_entry.value)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_layer_lut_reset(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED3(broadcast, request_data, response_data);
+
+    layer_lut_reset();
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_layer_dither(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return layer_set_dither(request_data->by_bool)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_layer_low_latency(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return layer_set_low_latency(request_data->by_bool)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_layer_stat(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    unsigned int result;
+    if (!layer_stat(request_data->by_uint8, &result))
+        return BUS_ERR_INVALID_PAYLOAD;
+    response_data->by_uint32 = result;
+    return BUS_OK;
+}
+
+#ifdef EFFECT_ENABLE
+static enum bus_response_code bus_func_effect_start(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // All of them render into the canvas, so the last one started wins
+#ifdef ANIMATION_ENABLE
+    animation_stop();
+#endif
+#ifdef TEXT_ENABLE
+    text_stop();
+#endif
+
+    // Broadcast so all layers start in phase
+    return effect_start(request_data->by_effect.effect, request_data->by_effect.speed, request_data->by_effect.param)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_effect_stop(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED3(broadcast, request_data, response_data);
+
+    effect_stop();
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_effect_color(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    struct layer_color color =
+    {
+        .r = request_data->by_effect_color.r,
+        .g = request_data->by_effect_color.g,
+        .b = request_data->by_effect_color.b,
+    };
+
+    return effect_set_color(request_data->by_effect_color.index, color)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_effect_stat(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    unsigned int result;
+    if (!effect_stat(request_data->by_uint8, &result))
+        return BUS_ERR_INVALID_PAYLOAD;
+    response_data->by_uint32 = result;
+    return BUS_OK;
+}
+#endif
+
+#ifdef ANIMATION_ENABLE
+static enum bus_response_code bus_func_animation_erase(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, request_data);
+
+    if (!animation_erase())
+        return BUS_ERR_AGAIN;
+
+    // If no job could be started the host has to fall back to polling the status
+    response_data->by_int8 = job_start(&bus_job_animation);
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_animation_row_reset(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED3(broadcast, request_data, response_data);
+
+    return animation_row_reset()
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_animation_row_push_word(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return animation_row_push_word(request_data->by_uint32)
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_animation_row_burn(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    if (!animation_row_burn(request_data->by_uint32))
+        return BUS_ERR_AGAIN;
+
+    // If no job could be started the host has to fall back to polling the status
+    response_data->by_int8 = job_start(&bus_job_animation);
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_animation_row_crc16(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, request_data);
+
+    unsigned short result;
+    if (!animation_row_crc16(&result))
+        return BUS_ERR_AGAIN;
+    response_data->by_uint16 = result;
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_animation_play(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // Broadcast with a start time in the near future so all layers start in sync
+#ifdef EFFECT_ENABLE
+    effect_stop();
+#endif
+#ifdef TEXT_ENABLE
+    text_stop();
+#endif
+    return animation_play(request_data->by_uint32)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_animation_stop(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED3(broadcast, request_data, response_data);
+
+    animation_stop();
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_animation_stat(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    unsigned int result;
+    if (!animation_stat(request_data->by_uint8, &result))
+        return BUS_ERR_INVALID_PAYLOAD;
+    response_data->by_uint32 = result;
+    return BUS_OK;
+}
+#endif
+
+#ifdef LAYER_DRAW
+static enum bus_response_code bus_func_draw_color(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    bus_draw_color.r = request_data->by_draw_color.r;
+    bus_draw_color.g = request_data->by_draw_color.g;
+    bus_draw_color.b = request_data->by_draw_color.b;
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_draw_rect(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return layer_fill_rect(
+            request_data->by_draw_rect.x,
+            request_data->by_draw_rect.y,
+            request_data->by_draw_rect.width,
+            request_data->by_draw_rect.height,
+            bus_draw_color)
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_draw_line(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return layer_draw_line(
+            request_data->by_draw_line.x,
+            request_data->by_draw_line.y,
+            request_data->by_draw_line.length,
+            request_data->by_draw_line.vertical,
+            bus_draw_color)
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_draw_run(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return layer_fill_run(request_data->by_draw_run.index, request_data->by_draw_run.count, bus_draw_color)
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_draw_plane(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    if (request_data->by_draw_plane.channel > LAYER_CHANNEL_BLUE)
+        return BUS_ERR_INVALID_PAYLOAD;
+    return layer_fill_plane(request_data->by_draw_plane.channel, request_data->by_draw_plane.value)
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_draw_copy(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return layer_copy_rect(
+            request_data->by_draw_copy.x,
+            request_data->by_draw_copy.y,
+            request_data->by_draw_copy.width + 1,
+            request_data->by_draw_copy.height + 1,
+            request_data->by_draw_copy.dst_x,
+            request_data->by_draw_copy.dst_y)
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_draw_scroll(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // The area that is uncovered is filled with the drawing color
+    return layer_scroll_rect(
+            request_data->by_draw_scroll.x,
+            request_data->by_draw_scroll.y,
+            request_data->by_draw_scroll.width + 1,
+            request_data->by_draw_scroll.height + 1,
+            request_data->by_draw_scroll.dx,
+            request_data->by_draw_scroll.dy,
+            bus_draw_color)
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_draw_commit(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // Unless presented right away the frame is shown on the next buffer swap, so
+    // broadcast a buffer swap (or commit) to update the layers at once
+    return layer_canvas_commit(request_data->by_bool)
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+#endif
+
+#ifdef SPRITE_ENABLE
+static enum bus_response_code bus_func_sprite_reset(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED3(broadcast, request_data, response_data);
+
+    sprite_reset();
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_sprite_color(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    struct layer_color color =
+    {
+        .r = request_data->by_sprite_color.r,
+        .g = request_data->by_sprite_color.g,
+        .b = request_data->by_sprite_color.b,
+    };
+
+    return sprite_set_color(request_data->by_sprite_color.index, color)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_sprite_tile_address(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return sprite_tile_address(request_data->by_uint16)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_sprite_tile_push_word(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return sprite_tile_push_word(request_data->by_uint32)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_sprite_map(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return sprite_map_set(request_data->by_sprite_map.cell, request_data->by_sprite_map.tile)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_sprite_set(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return sprite_set(
+            request_data->by_sprite.sprite,
+            request_data->by_sprite.tile,
+            request_data->by_sprite.width,
+            request_data->by_sprite.height,
+            request_data->by_sprite.priority)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_sprite_move(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return sprite_move(request_data->by_sprite_move.sprite, request_data->by_sprite_move.x, request_data->by_sprite_move.y)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_sprite_compose(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // Composed right away, so the frame is committed by the time the host gets the response
+    return sprite_compose(request_data->by_bool)
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_sprite_stat(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    unsigned int result;
+    if (!sprite_stat(request_data->by_uint8, &result))
+        return BUS_ERR_INVALID_PAYLOAD;
+    response_data->by_uint32 = result;
+    return BUS_OK;
+}
+#endif
+
+#ifdef TEXT_ENABLE
+static enum bus_response_code bus_func_text_clear(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED3(broadcast, request_data, response_data);
+
+    text_clear();
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_text_append(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    char const * text = request_data->by_text;
+    return text_append(text, strnlen(text, sizeof(request_data->by_text)))
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_text_color(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    struct layer_color color =
+    {
+        .r = request_data->by_text_color.r,
+        .g = request_data->by_text_color.g,
+        .b = request_data->by_text_color.b,
+    };
+
+    return text_set_color(request_data->by_text_color.index, color)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_text_start(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // Broadcast so the layers scroll in step
+#ifdef EFFECT_ENABLE
+    effect_stop();
+#endif
+#ifdef ANIMATION_ENABLE
+    animation_stop();
+#endif
+    return text_start(request_data->by_text_start.row, request_data->by_text_start.speed)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_text_stop(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED3(broadcast, request_data, response_data);
+
+    text_stop();
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_text_stat(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    unsigned int result;
+    if (!text_stat(request_data->by_uint8, &result))
+        return BUS_ERR_INVALID_PAYLOAD;
+    response_data->by_uint32 = result;
+    return BUS_OK;
+}
+#endif
+
+#ifdef SCENE_ENABLE
+static enum bus_response_code bus_func_scene_clear(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED3(broadcast, request_data, response_data);
+
+    scene_clear();
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_scene_push_word(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // Broadcast, every layer holds the whole scene
+    return scene_push_word(request_data->by_uint32)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_scene_commit(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // Broadcast so every layer renders its slice, unless presented right away the slices
+    // are shown on the next buffer swap, so broadcast a buffer swap to update the cube at once
+    return scene_commit(request_data->by_bool)
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_scene_stat(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED1(broadcast);
+
+    unsigned int result;
+    if (!scene_stat(request_data->by_uint8, &result))
+        return BUS_ERR_INVALID_PAYLOAD;
+    response_data->by_uint32 = result;
+    return BUS_OK;
+}
+#endif
+
+static enum bus_response_code bus_func_layer_overlay(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    struct layer_color key =
+    {
+        .r = request_data->by_layer_overlay.r,
+        .g = request_data->by_layer_overlay.g,
+        .b = request_data->by_layer_overlay.b,
+    };
+
+    return layer_set_overlay(request_data->by_layer_overlay.opacity, key)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_layer_draw_target(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // The drawing commands draw into the overlay or the canvas
+    return layer_set_draw_target(request_data->by_uint8)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_layer_overlay_commit(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED3(broadcast, request_data, response_data);
+
+    return layer_overlay_commit()
+        ? BUS_OK
+        : BUS_ERR_AGAIN;
+}
+
+static enum bus_response_code bus_func_layer_fade(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return layer_set_fade(request_data->by_uint8)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_layer_remap(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return layer_set_remap(request_data->by_uint8)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_layer_remap_write(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // The last entries of the table are written with less than three sources
+    unsigned int index = request_data->by_layer_remap.index;
+    unsigned int count = sizeof(request_data->by_layer_remap.sources);
+    if (count > LAYER_NUM_OF_LEDS - index)
+        count = LAYER_NUM_OF_LEDS - index;
+
+    return layer_remap_write(index, request_data->by_layer_remap.sources, count)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_settings_save(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, request_data);
+
+    if (!settings_save())
+        return BUS_ERR_AGAIN;
+
+    // If no job could be started the host has to fall back to polling the status
+    response_data->by_int8 = job_start(&bus_job_settings);
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_settings_erase(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, request_data);
+
+    if (!settings_erase())
+        return BUS_ERR_AGAIN;
+
+    // If no job could be started the host has to fall back to polling the status
+    response_data->by_int8 = job_start(&bus_job_settings);
+    return BUS_OK;
+}
+
+static enum bus_response_code bus_func_layer_geometry(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    return layer_set_geometry(request_data->by_layer_geometry.rows, request_data->by_layer_geometry.order)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
+static enum bus_response_code bus_func_layer_row_map_write(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    UNUSED2(broadcast, response_data);
+
+    // The last rows of the map are written with less than three pins
+    unsigned int row = request_data->by_layer_row_map.row;
+    unsigned int count = sizeof(request_data->by_layer_row_map.pins);
+    if (row < LAYER_NUM_OF_ROWS && count > LAYER_NUM_OF_ROWS - row)
+        count = LAYER_NUM_OF_ROWS - row;
+
+    return layer_row_map_write(row, request_data->by_layer_row_map.pins, count)
+        ? BUS_OK
+        : BUS_ERR_INVALID_PAYLOAD;
+}
+
 bus_func_t const bus_funcs[] =
 {
     bus_func_layer_auto_buffer_swap,    // 0
@@ -142,6 +1066,97 @@ bus_func_t const bus_funcs[] =
     bus_func_version,                   // 5
     bus_func_sys_cpu_reset,             // 6
     bus_func_layer_clear,               // 7
+    bus_func_bus_stat,                  // 8
+    job_bus_wait,                       // 9
+    bus_func_layer_dma_arm_buffer_swap, // 10
+    bus_func_layer_dma_commit_buffer_swap, // 11
+    bus_func_clock_sync,                // 12
+    bus_func_clock_stat,                // 13
+    bus_func_layer_ingest_mode,         // 14
+    bus_func_layer_stat,                // 15
+    bus_func_layer_color_depth,         // 16
+    bus_func_layer_lut_write,           // 17
+    bus_func_layer_lut_reset,           // 18
+    bus_func_layer_dither,              // 19
+    bus_func_layer_low_latency,         // 20
+#ifdef EFFECT_ENABLE
+    bus_func_effect_start,              // 21
+    bus_func_effect_stop,               // 22
+    bus_func_effect_color,              // 23
+    bus_func_effect_stat,               // 24
+#else
+    NULL, NULL, NULL, NULL,             // 21 - 24, invalid commands
+#endif
+#ifdef ANIMATION_ENABLE
+    bus_func_animation_erase,           // 25
+    bus_func_animation_row_reset,       // 26
+    bus_func_animation_row_push_word,   // 27
+    bus_func_animation_row_burn,        // 28
+    bus_func_animation_row_crc16,       // 29
+    bus_func_animation_play,            // 30
+    bus_func_animation_stop,            // 31
+    bus_func_animation_stat,            // 32
+#else
+    NULL, NULL, NULL, NULL,             // 25 - 28, invalid commands
+    NULL, NULL, NULL, NULL,             // 29 - 32
+#endif
+#ifdef LAYER_DRAW
+    bus_func_draw_color,                // 33
+    bus_func_draw_rect,                 // 34
+    bus_func_draw_line,                 // 35
+    bus_func_draw_run,                  // 36
+    bus_func_draw_plane,                // 37
+    bus_func_draw_copy,                 // 38
+    bus_func_draw_scroll,               // 39
+    bus_func_draw_commit,               // 40
+#else
+    NULL, NULL, NULL, NULL,             // 33 - 36, invalid commands
+    NULL, NULL, NULL, NULL,             // 37 - 40
+#endif
+#ifdef SPRITE_ENABLE
+    bus_func_sprite_reset,              // 41
+    bus_func_sprite_color,              // 42
+    bus_func_sprite_tile_address,       // 43
+    bus_func_sprite_tile_push_word,     // 44
+    bus_func_sprite_map,                // 45
+    bus_func_sprite_set,                // 46
+    bus_func_sprite_move,               // 47
+    bus_func_sprite_compose,            // 48
+    bus_func_sprite_stat,               // 49
+#else
+    NULL, NULL, NULL, NULL,             // 41 - 44, invalid commands
+    NULL, NULL, NULL, NULL,             // 45 - 48
+    NULL,                               // 49
+#endif
+#ifdef TEXT_ENABLE
+    bus_func_text_clear,                // 50
+    bus_func_text_append,               // 51
+    bus_func_text_color,                // 52
+    bus_func_text_start,                // 53
+    bus_func_text_stop,                 // 54
+    bus_func_text_stat,                 // 55
+#else
+    NULL, NULL, NULL, NULL,             // 50 - 53, invalid commands
+    NULL, NULL,                         // 54 - 55
+#endif
+#ifdef SCENE_ENABLE
+    bus_func_scene_clear,               // 56
+    bus_func_scene_push_word,           // 57
+    bus_func_scene_commit,              // 58
+    bus_func_scene_stat,                // 59
+#else
+    NULL, NULL, NULL, NULL,             // 56 - 59, invalid commands
+#endif
+    bus_func_layer_overlay,             // 60
+    bus_func_layer_draw_target,         // 61
+    bus_func_layer_overlay_commit,      // 62
+    bus_func_layer_fade,                // 63
+    bus_func_layer_remap,               // 64
+    bus_func_layer_remap_write,         // 65
+    bus_func_settings_save,             // 66
+    bus_func_settings_erase,            // 67
+    bus_func_layer_geometry,            // 68
+    bus_func_layer_row_map_write,       // 69
 };
 size_t const bus_funcs_size = BUS_FUNCS_SIZE;
 size_t const bus_funcs_start = 0;
\ No newline at end of file
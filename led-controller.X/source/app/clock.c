@@ -0,0 +1,122 @@
+#include <app/clock.h>
+#include <core/kernel_task.h>
+#include <core/bus.h>
+#include <core/rs485.h>
+#include <core/assert.h>
+#include <core/sys.h>
+#include <core/util.h>
+#include <stddef.h>
+
+#define CLOCK_TICKS_PER_US          (SYS_CORE_TIMER_CLOCK / 1000000LU)
+// The master sends its time when it starts sending a sync frame, and the frame is timestamped when
+// its last character is received (see rs485_read_ticks). So the latency is the frame's transfer time.
+// What's left is within a few microseconds: the master's time has a resolution of 1 us, and the
+// receiver flags a character half a bit before its stop bit ends.
+#define CLOCK_SYNC_LATENCY          RS485_TRANSFER_TIME(BUS_FRAME_SIZE) // In microseconds
+#define CLOCK_SYNC_STEP_LIMIT       10000 // In microseconds, errors larger than this restart the estimation
+#define CLOCK_SYNC_PHASE_GAIN       2 // Correct 1/x of the error immediately
+#define CLOCK_SYNC_DRIFT_GAIN       4 // Correct 1/x of the observed frequency error
+#define CLOCK_DRIFT_LIMIT           500000 // In ppb
+
+static void clock_rtask_execute(void);
+KERN_SIMPLE_RTASK(clock, NULL, clock_rtask_execute)
+
+static unsigned long long clock_ticks; // Core timer extended to 64 bits
+static unsigned int clock_ticks_last;
+static unsigned long long clock_local_base; // In microseconds of local time, ...
+static long long clock_cube_base; // ...corresponding to this cube time
+static int clock_drift; // In ppb
+static int clock_error_last;
+static unsigned int clock_sync_count;
+
+static unsigned long long clock_update_ticks(void)
+{
+    // Must be called at least once per core timer overflow (~89 seconds)
+    unsigned int ticks = SYS_CORE_TICKS();
+    clock_ticks += ticks - clock_ticks_last;
+    clock_ticks_last = ticks;
+    return clock_ticks;
+}
+
+static void clock_rtask_execute(void)
+{
+    clock_update_ticks();
+}
+
+static long long clock_cube_time(unsigned long long local)
+{
+    long long elapsed = (long long)(local - clock_local_base);
+    return clock_cube_base + elapsed + (elapsed * clock_drift) / 1000000000LL;
+}
+
+bool clock_synced(void)
+{
+    return clock_sync_count > 1;
+}
+
+unsigned long long clock_get_time(void)
+{
+    return clock_cube_time(clock_update_ticks() / CLOCK_TICKS_PER_US);
+}
+
+void clock_sync(unsigned int master_time, unsigned int ticks)
+{
+    // Local time at which the sync frame was received, ticks is a core timer snapshot
+    unsigned long long now = clock_update_ticks();
+    unsigned long long local = (now - (clock_ticks_last - ticks)) / CLOCK_TICKS_PER_US;
+    master_time += CLOCK_SYNC_LATENCY;
+
+    if (clock_sync_count == 0) {
+        clock_local_base = local;
+        clock_cube_base = master_time;
+        clock_error_last = 0;
+        clock_sync_count = 1;
+        return;
+    }
+
+    // The master time is 32 bits, so extend it from our own estimate
+    long long predicted = clock_cube_time(local);
+    int error = (int)(master_time - (unsigned int)predicted);
+    clock_error_last = error;
+
+    if (error > CLOCK_SYNC_STEP_LIMIT || error < -CLOCK_SYNC_STEP_LIMIT) {
+        // Way off, e.g. the master restarted: step to its time and estimate again
+        clock_local_base = local;
+        clock_cube_base = predicted + error;
+        clock_sync_count = 1;
+        return;
+    }
+
+    // Phase and frequency correction, a proportional-integral servo. The
+    // frequency error is observed over the interval since the last sync.
+    long long interval = (long long)(local - clock_local_base);
+    if (interval > 0) {
+        long long drift = clock_drift + (error * 1000000000LL) / interval / CLOCK_SYNC_DRIFT_GAIN;
+        if (drift > CLOCK_DRIFT_LIMIT)
+            drift = CLOCK_DRIFT_LIMIT;
+        else if (drift < -CLOCK_DRIFT_LIMIT)
+            drift = -CLOCK_DRIFT_LIMIT;
+        clock_drift = (int)drift;
+    }
+
+    clock_local_base = local;
+    clock_cube_base = predicted + error / CLOCK_SYNC_PHASE_GAIN;
+    clock_sync_count++;
+}
+
+bool clock_stat(enum clock_stat stat, unsigned int * out)
+{
+    ASSERT_NOT_NULL(out);
+    if (out == NULL)
+        return false;
+
+    switch (stat) {
+        case CLOCK_STAT_TIME:           *out = (unsigned int)clock_get_time();  break;
+        case CLOCK_STAT_ERROR_LAST:     *out = (unsigned int)clock_error_last;  break;
+        case CLOCK_STAT_DRIFT:          *out = (unsigned int)clock_drift;       break;
+        case CLOCK_STAT_SYNC_COUNT:     *out = clock_sync_count;                break;
+        default:                                                                return false;
+    }
+
+    return true;
+}
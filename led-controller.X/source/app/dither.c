@@ -0,0 +1,66 @@
+#include <app/dither.h>
+#include <core/assert.h>
+#include <stddef.h>
+
+#define DITHER_PHASE_MASK           (DITHER_PHASES - 1)
+#define DITHER_FRACTION_MASK        (DITHER_PHASES - 1)
+#define DITHER_MAX_VALUE            0xfff // 12 bit
+
+// Thresholds in bit reversed order, so the phases in which a channel is rounded
+// up are spread as evenly as possible over time. This keeps the flicker of the
+// dithered channels at the highest possible frequency.
+static unsigned char const dither_pattern[DITHER_PHASES] =
+{
+    0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15,
+};
+
+// Phase offset per channel, so neighbouring channels with the same fraction are
+// not rounded up in the same phase
+static unsigned char const dither_offset[DITHER_PHASES] =
+{
+    0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11,
+};
+
+inline static unsigned int __attribute__((always_inline)) dither_round(unsigned int value, unsigned int fraction, unsigned int phase)
+{
+    if (fraction > dither_pattern[phase & DITHER_PHASE_MASK] && value < DITHER_MAX_VALUE)
+        value++;
+    return value;
+}
+
+void dither_set_fraction(unsigned char * fractions, unsigned int channel, unsigned char fraction)
+{
+    ASSERT_NOT_NULL(fractions);
+
+    unsigned char * byte = &fractions[channel >> 1];
+    fraction &= DITHER_FRACTION_MASK;
+    if (channel & 1)
+        *byte = (*byte & 0xf0) | fraction;
+    else
+        *byte = (*byte & 0x0f) | (fraction << 4);
+}
+
+void dither_row(
+    unsigned char * row,
+    unsigned char const * source,
+    unsigned char const * fractions,
+    unsigned int channels,
+    unsigned int phase)
+{
+    ASSERT_NOT_NULL(row);
+    ASSERT_NOT_NULL(source);
+    ASSERT_NOT_NULL(fractions);
+
+    // Two channels are packed in three bytes and their fractions in one byte
+    for (unsigned int channel = 0; channel < channels; channel += 2, row += 3, source += 3, ++fractions) {
+        unsigned int a = source[0] << 4 | source[1] >> 4;
+        unsigned int b = (source[1] & 0x0f) << 8 | source[2];
+
+        a = dither_round(a, *fractions >> 4, phase + dither_offset[channel & DITHER_PHASE_MASK]);
+        b = dither_round(b, *fractions & 0x0f, phase + dither_offset[(channel + 1) & DITHER_PHASE_MASK]);
+
+        row[0] = (unsigned char)(a >> 4);
+        row[1] = (unsigned char)((a & 0x0f) << 4 | b >> 8);
+        row[2] = (unsigned char)(b & 0xff);
+    }
+}
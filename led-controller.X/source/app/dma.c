@@ -280,6 +280,34 @@ void dma_disable_transfer(struct dma_channel * channel)
     ATOMIC_REG_CLR(channel->dma_reg->dchcon, DMA_DCHCON_CHEN_MASK);
 }
 
+unsigned short dma_get_dst_pointer(struct dma_channel * channel)
+{
+    ASSERT_NOT_NULL(channel);
+
+    return (unsigned short)ATOMIC_REG_VALUE(channel->dma_reg->dchdptr);
+}
+
+bool dma_block_transfer_pending(struct dma_channel * channel)
+{
+    ASSERT_NOT_NULL(channel);
+
+    return ATOMIC_REG_VALUE(channel->dma_reg->dchint) & DMA_DCHINT_CHBCIF_MASK;
+}
+
+void dma_mask_interrupt(struct dma_channel * channel)
+{
+    ASSERT_NOT_NULL(channel);
+
+    ATOMIC_REG_PTR_CLR(channel->dma_int->iec, channel->dma_int->mask);
+}
+
+void dma_unmask_interrupt(struct dma_channel * channel)
+{
+    ASSERT_NOT_NULL(channel);
+
+    ATOMIC_REG_PTR_SET(channel->dma_int->iec, channel->dma_int->mask);
+}
+
 bool dma_busy(struct dma_channel * channel)
 {
     ASSERT_NOT_NULL(channel);
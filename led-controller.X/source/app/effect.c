@@ -0,0 +1,415 @@
+#ifdef EFFECT_ENABLE
+#include <app/effect.h>
+#include <app/swar.h>
+#include <core/kernel_task.h>
+#include <core/bus_address.h>
+#include <core/sys.h>
+#include <core/util.h>
+#include <core/assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#define EFFECT_PHASE_SHIFT          4 // The phase is in 1/16 steps of the lookup tables
+#define EFFECT_TABLE_SIZE           256
+#define EFFECT_TABLE_INDEX(value)   ((value) & (EFFECT_TABLE_SIZE - 1))
+#define EFFECT_ROW_WORDS            (LAYER_NUM_OF_COLS / SWAR_LANES)
+#define EFFECT_RAMP_SIZE            (LAYER_NUM_OF_COLS + LAYER_NUM_OF_ROWS - 1) // Positions along the diagonal
+#define EFFECT_RAMP_STEP            16 // In table steps per pixel, so a gradient repeats every 16 pixels
+#define EFFECT_HUE_GREEN            85 // The plasma colors are sines a third of the table apart
+#define EFFECT_HUE_BLUE             170
+#define EFFECT_PLASMA_SCALE         8 // Default spatial frequency, in table steps per pixel
+#define EFFECT_FIRE_COOLING         48 // Default maximum cooling per step
+#define EFFECT_FIRE_SPARKS          160 // Maximum heat added to the last row per step
+#define EFFECT_FIRE_DECAY           224 // Heat of the last row that is kept per step, out of 256
+#define EFFECT_FIRE_STEPS_MAX       4 // Steps that are caught up at once at high speeds
+#define EFFECT_NOISE_CELL_SHIFT     2 // Default size of a noise cell, log2 of the pixels
+#define EFFECT_NOISE_CELL_SHIFT_MIN 1
+#define EFFECT_NOISE_CELL_SHIFT_MAX 3
+#define EFFECT_NOISE_GRID_SIZE      ((LAYER_NUM_OF_COLS >> EFFECT_NOISE_CELL_SHIFT_MIN) + 1)
+#define EFFECT_NOISE_TIME_SHIFT     2 // Table steps to lattice steps in time, 8.8 fixed point
+#define EFFECT_RANDOM_SEED          0x5940U
+
+STATIC_ASSERT(LAYER_NUM_OF_COLS % SWAR_LANES == 0)
+STATIC_ASSERT(LAYER_NUM_OF_COLS == LAYER_NUM_OF_ROWS) // Square noise grid
+
+static void effect_rtask_execute(void);
+KERN_SIMPLE_RTASK(effect, NULL, effect_rtask_execute)
+
+// Sine over one period, offset and scaled to the full 8 bit range
+static const unsigned char effect_sine[EFFECT_TABLE_SIZE] =
+{
+    128, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
+    176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
+    218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
+    245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+    255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+    245, 244, 243, 241, 240, 238, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+    218, 215, 213, 211, 208, 206, 203, 201, 198, 196, 193, 190, 188, 185, 182, 179,
+    176, 173, 170, 167, 165, 162, 158, 155, 152, 149, 146, 143, 140, 137, 134, 131,
+    128, 124, 121, 118, 115, 112, 109, 106, 103, 100,  97,  93,  90,  88,  85,  82,
+     79,  76,  73,  70,  67,  65,  62,  59,  57,  54,  52,  49,  47,  44,  42,  40,
+     37,  35,  33,  31,  29,  27,  25,  23,  21,  20,  18,  17,  15,  14,  12,  11,
+     10,   9,   7,   6,   5,   5,   4,   3,   2,   2,   1,   1,   1,   0,   0,   0,
+      0,   0,   0,   0,   1,   1,   1,   2,   2,   3,   4,   5,   5,   6,   7,   9,
+     10,  11,  12,  14,  15,  17,  18,  20,  21,  23,  25,  27,  29,  31,  33,  35,
+     37,  40,  42,  44,  47,  49,  52,  54,  57,  59,  62,  65,  67,  70,  73,  76,
+     79,  82,  85,  88,  90,  93,  97, 100, 103, 106, 109, 112, 115, 118, 121, 124,
+};
+
+// Permutation of all bytes, chained lookups hash the lattice points of the value noise
+static const unsigned char effect_noise[EFFECT_TABLE_SIZE] =
+{
+     94,  77,  27, 164,  58, 216, 147, 208,  50,  89,  55, 197,  25, 192, 222,  16,
+     84, 242,  13, 141,  15, 235, 103, 169, 209, 117, 118, 113, 144, 150, 155, 129,
+     29, 195,  36, 122, 151, 104,  59,  19,  62,   6, 202, 219,  85,  83, 207, 188,
+    133, 198, 191, 116, 114, 194, 174,  18, 189, 173, 138,  82,  90, 215, 135, 184,
+    225,  30, 171, 251, 172,  79, 161,  14,  87,  81, 205,   5, 146, 247,  72,   1,
+     66,  42, 101,  54, 158,  33,  69, 186, 211,  41,  17, 231,   9,  91,  73,  70,
+    193, 156, 210, 177,  38,   7,   3,  12, 102, 245,  95,  78, 178,  35, 168,  28,
+     46, 250,  24, 249, 246, 227, 136, 255, 152,  75, 132, 183, 112,  23, 229,   4,
+    111, 221, 125, 110, 218, 217, 240, 108, 162, 130, 199,  60,  64, 220, 230,  34,
+    223,  74, 203,  51, 176,  43, 239,  11,  47,  44,  63, 224, 163,  22,  86, 121,
+    143,  97, 201, 123, 167, 182, 233,  49, 124,  92, 232,  32, 128, 149,  61, 142,
+     48,  98,  10, 166, 154, 180, 252,  21, 213, 241, 243, 170, 236, 190, 134, 165,
+      2,  65, 237,  68, 204, 148, 185,  80, 234,  96, 106, 254, 107,  40,  31,  39,
+    226, 157, 109, 196,  53, 120, 200, 159, 137,  26, 153,   8, 253, 160, 126,  71,
+    248,  93,  37, 228, 187, 181, 145,  76,  57, 214, 131, 105, 175,  67, 100,  45,
+     88, 127, 115,   0,  99, 119,  52,  20, 206, 244, 212, 139, 179, 140, 238,  56,
+};
+
+static const unsigned int effect_planes[LAYER_FRAME_DEPTH] =
+{
+    LAYER_RED_OFFSET,
+    LAYER_GREEN_OFFSET,
+    LAYER_BLUE_OFFSET,
+};
+
+static struct layer_color effect_colors[EFFECT_NUM_OF_COLORS] =
+{
+    { .r = 255, .g = 0, .b = 0 },
+    { .r = 0, .g = 0, .b = 255 },
+};
+
+static uint32_t effect_heat[LAYER_NUM_OF_ROWS][EFFECT_ROW_WORDS]; // Of the fire, four pixels per word
+static uint32_t effect_random_state = EFFECT_RANDOM_SEED;
+static enum effect_type effect_type = EFFECT_NONE;
+static unsigned char effect_speed;
+static unsigned char effect_param;
+static unsigned int effect_phase; // Advanced by the speed every frame
+static unsigned int effect_fire_time; // Table steps the fire is simulated up to
+static unsigned int effect_frame_ticks; // Core timer ticks at which the last frame was due
+static unsigned int effect_frame_period; // In core timer ticks
+static unsigned int effect_rendered_frames;
+static unsigned int effect_skipped_frames;
+static unsigned int effect_render_time_last;
+static unsigned int effect_render_time_max;
+
+inline static unsigned char __attribute__((always_inline)) effect_mix(unsigned int a, unsigned int b, unsigned int weight)
+{
+    // Weight of b out of 256
+    return (unsigned char)((a * (256 - weight) + b * weight) >> 8);
+}
+
+inline static unsigned int __attribute__((always_inline)) effect_triangle(unsigned int phase)
+{
+    // Up and down again over one period of the tables, so a fade or gradient wraps around smoothly
+    phase = EFFECT_TABLE_INDEX(phase);
+    return (phase < EFFECT_TABLE_SIZE / 2) ? phase * 2 : (EFFECT_TABLE_SIZE - 1 - phase) * 2;
+}
+
+inline static unsigned int __attribute__((always_inline)) effect_smooth(unsigned int weight)
+{
+    // Smoothstep of a weight out of 256, 3w^2 - 2w^3
+    return (weight * weight * (3 * 256 - 2 * weight)) >> 16;
+}
+
+inline static unsigned char __attribute__((always_inline)) effect_lattice(unsigned int x, unsigned int y, unsigned int z)
+{
+    return effect_noise[EFFECT_TABLE_INDEX(effect_noise[EFFECT_TABLE_INDEX(effect_noise[EFFECT_TABLE_INDEX(x)] + y)] + z)];
+}
+
+static uint32_t effect_random(void)
+{
+    // Xorshift, four random bytes at once
+    effect_random_state ^= effect_random_state << 13;
+    effect_random_state ^= effect_random_state >> 17;
+    effect_random_state ^= effect_random_state << 5;
+    return effect_random_state;
+}
+
+static void effect_mix_colors(unsigned int weight, unsigned char * rgb)
+{
+    rgb[LAYER_CHANNEL_RED] = effect_mix(effect_colors[0].r, effect_colors[1].r, weight);
+    rgb[LAYER_CHANNEL_GREEN] = effect_mix(effect_colors[0].g, effect_colors[1].g, weight);
+    rgb[LAYER_CHANNEL_BLUE] = effect_mix(effect_colors[0].b, effect_colors[1].b, weight);
+}
+
+static void effect_render_plasma(unsigned char * frame, unsigned int time)
+{
+    unsigned int scale = effect_param ? effect_param : EFFECT_PLASMA_SCALE;
+    unsigned int z = bus_address_get() * scale; // The layers of the cube are slices of a volume
+    unsigned char cols[LAYER_NUM_OF_COLS];
+    unsigned char rows[LAYER_NUM_OF_ROWS];
+
+    // Terms that only depend on the column or the row are looked up once
+    for (unsigned int x = 0; x < LAYER_NUM_OF_COLS; ++x)
+        cols[x] = effect_sine[EFFECT_TABLE_INDEX(x * scale + time)];
+    for (unsigned int y = 0; y < LAYER_NUM_OF_ROWS; ++y)
+        rows[y] = effect_sine[EFFECT_TABLE_INDEX(y * scale + z - time)];
+
+    for (unsigned int y = 0, pixel = 0; y < LAYER_NUM_OF_ROWS; ++y) {
+        for (unsigned int x = 0; x < LAYER_NUM_OF_COLS; ++x, ++pixel) {
+            unsigned int value = cols[x] + rows[y]
+                + effect_sine[EFFECT_TABLE_INDEX((x + y) * scale + z + 2 * time)]
+                + effect_sine[EFFECT_TABLE_INDEX((x - y) * scale - z + 3 * time)];
+
+            value >>= 2; // Average of the four sines
+            frame[LAYER_RED_OFFSET + pixel] = effect_sine[value];
+            frame[LAYER_GREEN_OFFSET + pixel] = effect_sine[EFFECT_TABLE_INDEX(value + EFFECT_HUE_GREEN)];
+            frame[LAYER_BLUE_OFFSET + pixel] = effect_sine[EFFECT_TABLE_INDEX(value + EFFECT_HUE_BLUE)];
+        }
+    }
+}
+
+static void effect_step_fire(void)
+{
+    unsigned int cooling = effect_param ? effect_param : EFFECT_FIRE_COOLING;
+
+    // Heat rises by blending every row with the two rows below it, which are
+    // not updated yet, and cools down by a random amount on the way
+    for (unsigned int y = 0; y < LAYER_NUM_OF_ROWS - 1; ++y) {
+        uint32_t const * below = effect_heat[y + 1];
+        uint32_t const * further = effect_heat[(y + 2 < LAYER_NUM_OF_ROWS) ? (y + 2) : (y + 1)];
+
+        for (unsigned int word = 0; word < EFFECT_ROW_WORDS; ++word) {
+            uint32_t heat = swar_avg(below[word], swar_avg(below[word], further[word]));
+            effect_heat[y][word] = swar_sub_sat(heat, swar_scale(effect_random(), cooling));
+        }
+    }
+
+    // Sparks keep the last row burning
+    uint32_t * source = effect_heat[LAYER_NUM_OF_ROWS - 1];
+    for (unsigned int word = 0; word < EFFECT_ROW_WORDS; ++word)
+        source[word] = swar_add_sat(swar_scale(source[word], EFFECT_FIRE_DECAY), swar_scale(effect_random(), EFFECT_FIRE_SPARKS));
+}
+
+static void effect_render_fire(unsigned char * frame, unsigned int time)
+{
+    unsigned int steps = time - effect_fire_time;
+    if (steps > EFFECT_FIRE_STEPS_MAX)
+        steps = EFFECT_FIRE_STEPS_MAX;
+    effect_fire_time = time;
+    while (steps--)
+        effect_step_fire();
+
+    // Black to red to yellow to white, every color starts at a higher heat
+    swar_word_t * red = (swar_word_t *)(frame + LAYER_RED_OFFSET);
+    swar_word_t * green = (swar_word_t *)(frame + LAYER_GREEN_OFFSET);
+    swar_word_t * blue = (swar_word_t *)(frame + LAYER_BLUE_OFFSET);
+    uint32_t const green_start = swar_splat(96);
+    uint32_t const blue_start = swar_splat(192);
+
+    for (unsigned int y = 0; y < LAYER_NUM_OF_ROWS; ++y) {
+        for (unsigned int word = 0; word < EFFECT_ROW_WORDS; ++word) {
+            uint32_t heat = effect_heat[y][word];
+            uint32_t g = swar_sub_sat(heat, green_start);
+            uint32_t b = swar_sub_sat(heat, blue_start);
+
+            b = swar_add_sat(b, b);
+            *red++ = swar_add_sat(heat, heat);
+            *green++ = swar_add_sat(g, g);
+            *blue++ = swar_add_sat(b, b);
+        }
+    }
+}
+
+static void effect_render_gradient(unsigned char * frame, unsigned int time)
+{
+    unsigned char ramp[LAYER_FRAME_DEPTH][EFFECT_RAMP_SIZE];
+    unsigned char rgb[LAYER_FRAME_DEPTH];
+
+    for (unsigned int i = 0; i < EFFECT_RAMP_SIZE; ++i) {
+        effect_mix_colors(effect_triangle(i * EFFECT_RAMP_STEP + time), rgb);
+        for (unsigned int channel = 0; channel < LAYER_FRAME_DEPTH; ++channel)
+            ramp[channel][i] = rgb[channel];
+    }
+
+    // Every row is a fill or a copy out of the ramp, which are done word wise
+    for (unsigned int channel = 0; channel < LAYER_FRAME_DEPTH; ++channel) {
+        unsigned char * row = frame + effect_planes[channel];
+        for (unsigned int y = 0; y < LAYER_NUM_OF_ROWS; ++y, row += LAYER_NUM_OF_COLS) {
+            switch (effect_param) {
+                default:
+                case EFFECT_DIRECTION_COLS:     memcpy(row, ramp[channel], LAYER_NUM_OF_COLS);      break;
+                case EFFECT_DIRECTION_ROWS:     memset(row, ramp[channel][y], LAYER_NUM_OF_COLS);   break;
+                case EFFECT_DIRECTION_DIAGONAL: memcpy(row, ramp[channel] + y, LAYER_NUM_OF_COLS);  break;
+            }
+        }
+    }
+}
+
+static void effect_render_fade(unsigned char * frame, unsigned int time)
+{
+    unsigned char rgb[LAYER_FRAME_DEPTH];
+
+    effect_mix_colors(effect_triangle(time), rgb);
+    for (unsigned int channel = 0; channel < LAYER_FRAME_DEPTH; ++channel) {
+        swar_word_t * plane = (swar_word_t *)(frame + effect_planes[channel]);
+        uint32_t value = swar_splat(rgb[channel]);
+
+        for (unsigned int word = 0; word < LAYER_NUM_OF_LEDS / SWAR_LANES; ++word)
+            plane[word] = value;
+    }
+}
+
+static void effect_render_noise(unsigned char * frame, unsigned int time)
+{
+    unsigned int shift = effect_param ? effect_param : EFFECT_NOISE_CELL_SHIFT;
+    unsigned int cells = LAYER_NUM_OF_COLS >> shift;
+    unsigned int offset = bus_address_get() * LAYER_NUM_OF_COLS; // Every layer shows another part of the noise
+    unsigned int z = time << EFFECT_NOISE_TIME_SHIFT;
+    unsigned int z_weight = effect_smooth(EFFECT_TABLE_INDEX(z));
+    unsigned char grid[EFFECT_NOISE_GRID_SIZE][EFFECT_NOISE_GRID_SIZE];
+    unsigned char weights[LAYER_NUM_OF_COLS >> EFFECT_NOISE_CELL_SHIFT_MIN];
+
+    // Lattice points are interpolated in time first, then every pixel in between them
+    z >>= 8;
+    for (unsigned int y = 0; y <= cells; ++y)
+        for (unsigned int x = 0; x <= cells; ++x)
+            grid[y][x] = effect_mix(effect_lattice(x + offset, y, z), effect_lattice(x + offset, y, z + 1), z_weight);
+    for (unsigned int i = 0; i < BIT(shift); ++i)
+        weights[i] = (unsigned char)effect_smooth(i << (8 - shift));
+
+    for (unsigned int y = 0, pixel = 0; y < LAYER_NUM_OF_ROWS; ++y) {
+        unsigned char const * top = grid[y >> shift];
+        unsigned char const * bottom = grid[(y >> shift) + 1];
+        unsigned int y_weight = weights[y & (BIT(shift) - 1)];
+
+        for (unsigned int x = 0; x < LAYER_NUM_OF_COLS; ++x, ++pixel) {
+            unsigned int cell = x >> shift;
+            unsigned int x_weight = weights[x & (BIT(shift) - 1)];
+            unsigned int value = effect_mix(
+                effect_mix(top[cell], top[cell + 1], x_weight),
+                effect_mix(bottom[cell], bottom[cell + 1], x_weight),
+                y_weight);
+
+            frame[LAYER_RED_OFFSET + pixel] = effect_mix(effect_colors[0].r, effect_colors[1].r, value);
+            frame[LAYER_GREEN_OFFSET + pixel] = effect_mix(effect_colors[0].g, effect_colors[1].g, value);
+            frame[LAYER_BLUE_OFFSET + pixel] = effect_mix(effect_colors[0].b, effect_colors[1].b, value);
+        }
+    }
+}
+
+static void effect_rtask_execute(void)
+{
+    if (effect_type == EFFECT_NONE)
+        return;
+
+    // Frames are due every scan cycle, the schedule restarts if we fell behind
+    unsigned int now = SYS_CORE_TICKS();
+    if (now - effect_frame_ticks < effect_frame_period)
+        return;
+    effect_frame_ticks += effect_frame_period;
+    if (now - effect_frame_ticks >= effect_frame_period)
+        effect_frame_ticks = now;
+
+    unsigned char * frame = layer_canvas();
+    if (frame == NULL) {
+        effect_skipped_frames++;
+        return;
+    }
+
+    effect_render(frame);
+    effect_render_time_last = SYS_CORE_TICKS_TO_US(SYS_CORE_TICKS() - now);
+    if (effect_render_time_last > effect_render_time_max)
+        effect_render_time_max = effect_render_time_last;
+
+    if (layer_canvas_commit(true))
+        effect_rendered_frames++;
+    else
+        effect_skipped_frames++;
+}
+
+bool effect_start(enum effect_type effect, unsigned char speed, unsigned char param)
+{
+    switch (effect) {
+        case EFFECT_PLASMA:
+        case EFFECT_FIRE:
+        case EFFECT_FADE:
+            break;
+        case EFFECT_GRADIENT:
+            if (param > EFFECT_DIRECTION_DIAGONAL)
+                return false;
+            break;
+        case EFFECT_NOISE:
+            if (param != 0 && (param < EFFECT_NOISE_CELL_SHIFT_MIN || param > EFFECT_NOISE_CELL_SHIFT_MAX))
+                return false;
+            break;
+        default:
+            return false;
+    }
+
+    effect_speed = speed;
+    effect_param = param;
+    effect_phase = 0;
+    effect_fire_time = 0;
+    memset(effect_heat, 0, sizeof(effect_heat));
+    effect_frame_period = SYS_US_TO_CORE_TICKS(layer_scan_period()); // One frame per scan cycle
+    effect_frame_ticks = SYS_CORE_TICKS() - effect_frame_period; // First frame is rendered right away
+    effect_type = effect;
+    return true;
+}
+
+void effect_stop(void)
+{
+    effect_type = EFFECT_NONE;
+}
+
+enum effect_type effect_get(void)
+{
+    return effect_type;
+}
+
+bool effect_set_color(unsigned int index, struct layer_color color)
+{
+    if (index >= EFFECT_NUM_OF_COLORS)
+        return false;
+
+    // Takes effect from the next frame on
+    effect_colors[index] = color;
+    return true;
+}
+
+bool effect_stat(enum effect_stat stat, unsigned int * out)
+{
+    ASSERT_NOT_NULL(out);
+    if (out == NULL)
+        return false;
+
+    switch (stat) {
+        case EFFECT_STAT_RENDERED_FRAMES:   *out = effect_rendered_frames;  break;
+        case EFFECT_STAT_SKIPPED_FRAMES:    *out = effect_skipped_frames;   break;
+        case EFFECT_STAT_RENDER_TIME_LAST:  *out = effect_render_time_last; break;
+        case EFFECT_STAT_RENDER_TIME_MAX:   *out = effect_render_time_max;  break;
+        default:                                                            return false;
+    }
+
+    return true;
+}
+
+void effect_render(unsigned char * frame)
+{
+    unsigned int time = effect_phase >> EFFECT_PHASE_SHIFT; // In table steps
+
+    switch (effect_type) {
+        case EFFECT_PLASMA:     effect_render_plasma(frame, time);      break;
+        case EFFECT_FIRE:       effect_render_fire(frame, time);        break;
+        case EFFECT_GRADIENT:   effect_render_gradient(frame, time);    break;
+        case EFFECT_FADE:       effect_render_fade(frame, time);        break;
+        case EFFECT_NOISE:      effect_render_noise(frame, time);       break;
+        default:                                                        return;
+    }
+
+    effect_phase += effect_speed;
+}
+#endif
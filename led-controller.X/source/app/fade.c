@@ -0,0 +1,31 @@
+#include <app/fade.h>
+#include <core/assert.h>
+#include <stddef.h>
+
+inline static unsigned int __attribute__((always_inline)) fade_blend(int from, int to, int weight)
+{
+    // Rounds towards the source channel, the difference times the weight fits easily in an int
+    return (unsigned int)(from + (((to - from) * weight) >> FADE_WEIGHT_BITS));
+}
+
+void fade_row(
+    unsigned char * row,
+    unsigned char const * from,
+    unsigned char const * to,
+    unsigned int channels,
+    unsigned int weight)
+{
+    ASSERT_NOT_NULL(row);
+    ASSERT_NOT_NULL(from);
+    ASSERT_NOT_NULL(to);
+
+    // Two channels are packed in three bytes
+    for (unsigned int channel = 0; channel < channels; channel += 2, row += 3, from += 3, to += 3) {
+        unsigned int a = fade_blend(from[0] << 4 | from[1] >> 4, to[0] << 4 | to[1] >> 4, weight);
+        unsigned int b = fade_blend((from[1] & 0x0f) << 8 | from[2], (to[1] & 0x0f) << 8 | to[2], weight);
+
+        row[0] = (unsigned char)(a >> 4);
+        row[1] = (unsigned char)((a & 0x0f) << 4 | b >> 8);
+        row[2] = (unsigned char)(b & 0xff);
+    }
+}
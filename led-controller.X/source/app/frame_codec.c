@@ -0,0 +1,188 @@
+#include <app/frame_codec.h>
+#include <core/assert.h>
+#include <stddef.h>
+#include <string.h>
+
+// Run length encoding, the data is a sequence of runs each starting with a
+// control byte n:
+// - n < 128: literal run, the next n + 1 bytes are copied as is
+// - n >= 128: repeat run, the next byte is repeated n - 126 times
+// For the delta encoding the runs are XOR'ed into the previous frame instead,
+// so unchanged parts of the frame are long runs of zeros which are skipped.
+//
+// The palette encodings send one byte per pixel, which is expanded into the
+// three color planes. Loaded palette entries replace the entries of the palette
+// kept by the caller, so a palette can be sent once and be used for many frames.
+//
+// The rows encoding sends a range of rows of some of the planes as is, they are
+// copied into the frame in place. This makes small changes (e.g. a scrolling line
+// of text) cheap to send, without having to go through the whole frame.
+
+#define FRAME_RLE_REPEAT_FLAG       0x80
+#define FRAME_PALETTE_ENTRY_SIZE    3 // RGB
+
+static bool frame_decode_palette_load(
+    struct frame_palette * palette,
+    unsigned char const ** data,
+    unsigned int * size)
+{
+    struct frame_palette_load const * load = (struct frame_palette_load const *)*data;
+    if (*size < sizeof(*load))
+        return false;
+
+    unsigned int first = load->first;
+    unsigned int count = load->count + 1;
+    unsigned int load_size = sizeof(*load) + count * FRAME_PALETTE_ENTRY_SIZE;
+    if (first + count > FRAME_PALETTE_SIZE || *size < load_size)
+        return false;
+
+    unsigned char const * entry = *data + sizeof(*load);
+    for (unsigned int i = first; i < first + count; ++i, entry += FRAME_PALETTE_ENTRY_SIZE) {
+        palette->red[i] = entry[0];
+        palette->green[i] = entry[1];
+        palette->blue[i] = entry[2];
+    }
+
+    *data += load_size;
+    *size -= load_size;
+    return true;
+}
+
+static bool frame_decode_palette(
+    struct frame_palette const * palette,
+    unsigned char * frame,
+    unsigned int frame_size,
+    unsigned char const * data,
+    unsigned int size)
+{
+    unsigned int pixels = frame_size / FRAME_PALETTE_ENTRY_SIZE;
+    if (size != pixels)
+        return false;
+
+    unsigned char * red = frame;
+    unsigned char * green = frame + pixels;
+    unsigned char * blue = frame + pixels * 2;
+    for (unsigned int i = 0; i < pixels; ++i) {
+        unsigned char index = data[i];
+        red[i] = palette->red[index];
+        green[i] = palette->green[index];
+        blue[i] = palette->blue[index];
+    }
+
+    return true;
+}
+
+bool frame_decode_rows(
+    unsigned char * frame,
+    unsigned int frame_size,
+    unsigned int rows,
+    unsigned char const * data,
+    unsigned int size,
+    struct frame_rows * updated)
+{
+    ASSERT_NOT_NULL(frame);
+    ASSERT_NOT_NULL(data);
+    ASSERT_NOT_NULL(updated);
+
+    struct frame_rows const * header = (struct frame_rows const *)data;
+    if (size < sizeof(*header) || rows == 0)
+        return false;
+
+    unsigned int plane_size = frame_size / FRAME_NUM_OF_PLANES;
+    unsigned int row_size = plane_size / rows;
+    unsigned int first = header->first;
+    unsigned int count = header->count + 1;
+    unsigned int planes = header->planes;
+    if (first + count > rows || planes == 0 || planes >= FRAME_PLANE(FRAME_NUM_OF_PLANES))
+        return false;
+
+    // Check the size up front, so the frame is left untouched if the data is not valid
+    unsigned int rows_size = count * row_size;
+    unsigned int expected_size = sizeof(*header);
+    for (unsigned int plane = 0; plane < FRAME_NUM_OF_PLANES; ++plane) {
+        if (planes & FRAME_PLANE(plane))
+            expected_size += rows_size;
+    }
+    if (size != expected_size)
+        return false;
+
+    *updated = *header;
+    data += sizeof(*header);
+    for (unsigned int plane = 0; plane < FRAME_NUM_OF_PLANES; ++plane) {
+        if (planes & FRAME_PLANE(plane)) {
+            memcpy(frame + plane * plane_size + first * row_size, data, rows_size);
+            data += rows_size;
+        }
+    }
+
+    return true;
+}
+
+bool frame_decode(
+    enum frame_encoding encoding,
+    unsigned char * frame,
+    unsigned int frame_size,
+    struct frame_palette * palette,
+    unsigned char const * data,
+    unsigned int size)
+{
+    ASSERT_NOT_NULL(frame);
+    ASSERT_NOT_NULL(data);
+
+    unsigned char const * data_end = data + size;
+    unsigned char * frame_end = frame + frame_size;
+    unsigned int count;
+    bool delta;
+
+    switch (encoding) {
+        case FRAME_ENCODING_RAW:
+            if (size != frame_size)
+                return false;
+            memcpy(frame, data, size);
+            return true;
+        case FRAME_ENCODING_PALETTE_LOAD:
+            if (palette == NULL || !frame_decode_palette_load(palette, &data, &size))
+                return false;
+            // no break
+        case FRAME_ENCODING_PALETTE:
+            return palette != NULL && frame_decode_palette(palette, frame, frame_size, data, size);
+        case FRAME_ENCODING_RLE:    delta = false;  break;
+        case FRAME_ENCODING_DELTA:  delta = true;   break;
+        default:                                    return false;
+    }
+
+    while (data < data_end) {
+        unsigned char control = *data++;
+
+        if (control & FRAME_RLE_REPEAT_FLAG) {
+            count = control - (FRAME_RLE_REPEAT_FLAG - FRAME_RLE_REPEAT_MIN);
+            if (data == data_end || count > (unsigned int)(frame_end - frame))
+                return false;
+
+            unsigned char value = *data++;
+            if (!delta)
+                memset(frame, value, count);
+            else if (value) {
+                for (unsigned char * end = frame + count; frame < end; ++frame)
+                    *frame ^= value;
+                continue;
+            }
+            frame += count;
+        } else {
+            count = control + 1;
+            if (count > (unsigned int)(data_end - data) || count > (unsigned int)(frame_end - frame))
+                return false;
+
+            if (!delta) {
+                memcpy(frame, data, count);
+                frame += count;
+                data += count;
+            } else {
+                for (unsigned char * end = frame + count; frame < end; ++frame, ++data)
+                    *frame ^= *data;
+            }
+        }
+    }
+
+    return frame == frame_end;
+}
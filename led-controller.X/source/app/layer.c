@@ -1,5 +1,10 @@
 #include <app/layer.h>
 #include <app/layer_config.h>
+#include <app/frame_codec.h>
+#include <app/dither.h>
+#include <app/fade.h>
+#include <app/swar.h>
+#include <app/clock.h>
 #include <app/tlc5940.h>
 #include <app/spi.h>
 #include <app/dma.h>
@@ -8,21 +13,46 @@
 #include <core/sys.h>
 #include <core/util.h>
 #include <core/assert.h>
+#include <sys/attribs.h>
 #include <stddef.h>
 #include <string.h>
 #include <xc.h>
 
-#define LAYER_NUM_OF_ROWS           16
-#define LAYER_NUM_OF_COLS           16
-#define LAYER_NUM_OF_LEDS           (LAYER_NUM_OF_ROWS * LAYER_NUM_OF_COLS)
-#define LAYER_RED_OFFSET            (LAYER_NUM_OF_LEDS * 0)
-#define LAYER_GREEN_OFFSET          (LAYER_NUM_OF_LEDS * 1)
-#define LAYER_BLUE_OFFSET           (LAYER_NUM_OF_LEDS * 2)
-#define LAYER_FRAME_DEPTH           3 // RGB
-#define LAYER_FRAME_BUFFER_SIZE     (LAYER_NUM_OF_LEDS * LAYER_FRAME_DEPTH)
+#if defined(LAYER_OVERLAY) && !defined(LAYER_DRAW)
+#error "The overlay is drawn on with the drawing primitives, define LAYER_DRAW"
+#endif
+
+#define LAYER_ROW_SIZE_12           (LAYER_NUM_OF_COLS * 3 / 2) // Size of a row of one color in the 12 bit color depth
+#define LAYER_RED_OFFSET_12         (LAYER_NUM_OF_ROWS * LAYER_ROW_SIZE_12 * 0)
+#define LAYER_GREEN_OFFSET_12       (LAYER_NUM_OF_ROWS * LAYER_ROW_SIZE_12 * 1)
+#define LAYER_BLUE_OFFSET_12        (LAYER_NUM_OF_ROWS * LAYER_ROW_SIZE_12 * 2)
+#define LAYER_FRAME_BUFFER_SIZE_12  (LAYER_NUM_OF_ROWS * LAYER_ROW_SIZE_12 * LAYER_FRAME_DEPTH)
+#ifdef LAYER_DEEP_COLOR
+#define LAYER_FRAME_BUFFER_MAX_SIZE LAYER_FRAME_BUFFER_SIZE_12
+#else
+#define LAYER_FRAME_BUFFER_MAX_SIZE LAYER_FRAME_BUFFER_SIZE
+#endif
 #define LAYER_LOD_SETTLE_DELAY      10 // In microseconds, datasheet specs atleast 15 * td (20ns) + tpd2 (1us typ.)
 #define LAYER_LOD_ERROR_DELAY       1000 // In milliseconds
-#define LAYER_OFFSET(index)         (index * LAYER_NUM_OF_COLS)
+#define LAYER_OFFSET(index)         ((index) * LAYER_NUM_OF_COLS)
+#define LAYER_FRAME_HEADER_SIZE     sizeof(struct frame_header)
+#define LAYER_TIMED_HEADER_SIZE     sizeof(struct layer_timed_header)
+#define LAYER_IMAGE_POOL_SIZE       (LAYER_FRAME_QUEUE_DEPTH + 1) // Image being drawn and the queued images
+#define LAYER_QUEUE_NEXT(index)     (((index) + 1) % LAYER_IMAGE_POOL_SIZE)
+#define LAYER_QUEUE_PREVIOUS(index) (((index) + LAYER_IMAGE_POOL_SIZE - 1) % LAYER_IMAGE_POOL_SIZE)
+#define LAYER_HOLD_MAX              60000000 // In microseconds, the core timer must not overflow while holding a frame
+#define LAYER_PRESENT_LEAD_MAX      10000000 // In microseconds, frames that are further ahead are presented right away
+#define LAYER_STREAM_ALL_ROWS       (~0U)
+#define LAYER_BLUE_DEVICE           0 // TLC5940 device driving the blue channels
+#define LAYER_GREEN_DEVICE          1
+#define LAYER_RED_DEVICE            2
+#define LAYER_SCALE_MODE8(value)    ((unsigned short)((value) << 4 | (value) >> 4)) // Scale 8 bit to 12 bit equivalent
+#define LAYER_ROW_CHANNELS          (LAYER_NUM_OF_COLS * LAYER_FRAME_DEPTH)
+#define LAYER_LUT_SIZE              256
+#define LAYER_LUT_FRACTION_BITS     DITHER_FRACTION_BITS
+#define LAYER_LUT_MAX_VALUE         (0xfff << LAYER_LUT_FRACTION_BITS) // 12 bit with fraction
+#define LAYER_LUT_ROUND(value)      (((value) + (BIT(LAYER_LUT_FRACTION_BITS) / 2)) >> LAYER_LUT_FRACTION_BITS)
+#define LAYER_FADE_CYCLES_MAX       255 // In scan cycles, about four seconds
 
 #define LAYER_SPI_CHANNEL           SPI_CHANNEL1
 #define LAYER_SDI_PPS_REG           SDI1R
@@ -31,6 +61,40 @@
 #define LAYER_SDI_PPS_WORD          MASK(0xe, 0)
 #define LAYER_SS_PPS_WORD           MASK(0x3, 0)
 
+#define LAYER_CN_CON_REG            CNCONB
+#define LAYER_CN_EN_REG             CNENB
+#define LAYER_CN_IEC_REG            IEC1
+#define LAYER_CN_IFS_REG            IFS1
+#define LAYER_CN_IPC_REG            IPC8
+
+#define LAYER_CN_ON_MASK            BIT(15)
+#define LAYER_CN_SS_MASK            BIT(15) // SS1 is RB15
+#define LAYER_CN_INT_MASK           BIT(14) // Change notice of port B
+#define LAYER_CN_INT_PRIORITY_MASK  MASK(0x3, 18) // Interrupt handler must use IPL3SOFT, same as the DMA so they can't preempt each other
+
+#define LAYER_CN_ISR_VECTOR         _CHANGE_NOTICE_VECTOR
+
+STATIC_ASSERT(TLC5940_NUM_OF_DEVICES == LAYER_FRAME_DEPTH)
+STATIC_ASSERT(TLC5940_IMAGE_SIZE == LAYER_ROW_CHANNELS * 3 / 2)
+STATIC_ASSERT(LAYER_FRAME_QUEUE_DEPTH >= 1)
+STATIC_ASSERT(LAYER_TIMED_HEADER_SIZE == LAYER_FRAME_HEADER_SIZE + 8)
+STATIC_ASSERT(LAYER_NUM_OF_ROWS <= 32) // Streamed rows are tracked in a word
+STATIC_ASSERT(LAYER_NUM_OF_LEDS <= 256) // Entries of the remap table are bytes
+STATIC_ASSERT(LAYER_NUM_OF_ROWS == LAYER_NUM_OF_COLS) // Rotations and transpositions keep the layer square
+STATIC_ASSERT(LAYER_BLUE_OFFSET > LAYER_GREEN_OFFSET && LAYER_BLUE_OFFSET > LAYER_RED_OFFSET) // Blue is received last
+
+// A frame packed into the TLC5940 native format, one image per row. Packing is done once
+// when a frame is received, so a row is sent to the TLC5940s as is on every GSCLK period.
+struct layer_image
+{
+    unsigned char rows[LAYER_NUM_OF_ROWS][TLC5940_IMAGE_SIZE];
+#ifdef LAYER_DITHER
+    unsigned char fractions[LAYER_NUM_OF_ROWS][DITHER_FRACTION_SIZE(LAYER_ROW_CHANNELS)]; // Dithered when a row is sent
+#endif
+    enum layer_timing timing;
+    unsigned int time; // In microseconds, see struct layer_timed_header
+};
+
 struct layer_flags
 {
     // Don't use a bit field for flags that are set from an ISR. Updating the bit
@@ -40,11 +104,16 @@ struct layer_flags
 
     volatile bool do_buffer_swap; // Set flag to schedule a buffer swap on the next vertical sync
 
-    // Buffers are swapped from two different ISRs, after completion of a DMA block transfer
-    // or the TLC5940 latch handler (which is indirectly called by the PWM interrupt). The
+    // Set once the timing of the next queued frame allows it to be presented, which is
+    // decided by the layer task as the cube time can't be read from an interrupt.
+    volatile bool present_due;
+
+    // Frames are queued and presented from two different ISRs, after completion of a DMA block
+    // transfer or the TLC5940 latch handler (which is indirectly called by the PWM interrupt). The
     // DMA interrupt can be preempted by the PWM interrupt because it has a higher interrupt priority.
-    // To avoid race conditions (as swapping buffers is not an atomic operation), a semaphore is
-    // used to signal the TLC5940 latch handler that it can safely do a buffer swap.
+    // A frame without timing replaces a queued frame without timing in place, to avoid race
+    // conditions a semaphore is used to signal the TLC5940 latch handler that it can safely
+    // present the next frame.
     volatile bool buffer_swap_semaphore;
 
     // Set if a DMA transfer was aborted (e.g. SPI error) and a manual DMA reset is required.
@@ -67,76 +136,18 @@ enum layer_state
 
 static void layer_dma_block_transfer_complete(struct dma_channel * channel);
 static void layer_dma_transfer_abort(struct dma_channel * channel);
+static void layer_dma_restart(void);
+static bool layer_queue_frame(unsigned char const * frame, struct frame_rows rows, enum layer_timing timing, unsigned int time);
 
 static int layer_rtask_init(void);
 static void layer_rtask_execute(void);
 KERN_SIMPLE_RTASK(layer, layer_rtask_init, layer_rtask_execute)
 
-#ifdef LAYER_INTERLACED
-static const unsigned int layer_offset[LAYER_NUM_OF_ROWS] =
-{
-    LAYER_OFFSET(1), // Row 1
-    LAYER_OFFSET(3), // Row 3
-    LAYER_OFFSET(5), // ...
-    LAYER_OFFSET(7),
-    LAYER_OFFSET(9),
-    LAYER_OFFSET(11),
-    LAYER_OFFSET(13),
-    LAYER_OFFSET(15),
-    LAYER_OFFSET(0), // Row 0
-    LAYER_OFFSET(2), // Row 2
-    LAYER_OFFSET(4), // ...
-    LAYER_OFFSET(6),
-    LAYER_OFFSET(8),
-    LAYER_OFFSET(10),
-    LAYER_OFFSET(12),
-    LAYER_OFFSET(14),
-};
-
-static const struct io_pin layer_pins[LAYER_NUM_OF_ROWS] =
+// Row pins of the board, the row map selects the pin of every row
+static const struct io_pin layer_pins[] =
 {
-    IO_PIN(6, D), // Row 1
-    IO_PIN(4, D), // Row 3
-    IO_ANLG_PIN(2, D), // ...
-    IO_PIN(0, D),
-    IO_ANLG_PIN(2, E),
-    IO_PIN(0, E),
-    IO_PIN(10, D),
-    IO_PIN(8, D),
-    IO_PIN(7, D), // Row 0
-    IO_PIN(5, D), // Row 2
-    IO_ANLG_PIN(3, D), // ...
-    IO_ANLG_PIN(1, D),
-    IO_PIN(3, E),
-    IO_PIN(1, E),
-    IO_PIN(11, D),
-    IO_PIN(9, D),
-};
-#else
-static const unsigned int layer_offset[LAYER_NUM_OF_ROWS] =
-{
-    LAYER_OFFSET(0), // Row 0
-    LAYER_OFFSET(1), // Row 1
-    LAYER_OFFSET(2), // ...
-    LAYER_OFFSET(3),
-    LAYER_OFFSET(4),
-    LAYER_OFFSET(5),
-    LAYER_OFFSET(6),
-    LAYER_OFFSET(7),
-    LAYER_OFFSET(8),
-    LAYER_OFFSET(9),
-    LAYER_OFFSET(10),
-    LAYER_OFFSET(11),
-    LAYER_OFFSET(12),
-    LAYER_OFFSET(13),
-    LAYER_OFFSET(14),
-    LAYER_OFFSET(15),
-};
-
-static const struct io_pin layer_pins[LAYER_NUM_OF_ROWS] =
-{
-    IO_PIN(7, D), // Row 0
-    IO_PIN(6, D), // Row 1
+    IO_PIN(7, D), // Pin 0
+    IO_PIN(6, D), // Pin 1
     IO_PIN(5, D), // ...
     IO_PIN(4, D),
     IO_ANLG_PIN(3, D),
@@ -152,7 +163,9 @@ static const struct io_pin layer_pins[LAYER_NUM_OF_ROWS] =
     IO_PIN(9, D),
     IO_PIN(8, D),
 };
-#endif
+
+#define LAYER_NUM_OF_PINS           (sizeof(layer_pins) / sizeof(layer_pins[0]))
+STATIC_ASSERT(LAYER_NUM_OF_PINS >= LAYER_NUM_OF_ROWS) // The row map defaults to a pin for every row
 
 static struct dma_config const layer_dma_config =
 {
@@ -175,37 +188,522 @@ static struct layer_flags layer_flags =
     .buffer_swap_semaphore = true,
 };
 
-static unsigned char layer_buffer_pool[3][LAYER_FRAME_BUFFER_SIZE]; // Triple buffering to receive new pixel data while waiting on the vertical sync swap
-static unsigned char * layer_draw_buffer = layer_buffer_pool[0]; // Buffer that is used to write data to the TLC5940s
-static unsigned char * layer_sync_buffer = layer_buffer_pool[1]; // Buffer that contains a new frame but is still waiting to be swapped with draw_buffer
-static unsigned char * layer_recv_buffer = layer_buffer_pool[2]; // Buffer for receiving pixel data to form a new frame
+static unsigned char layer_buffer_pool[2][LAYER_FRAME_BUFFER_MAX_SIZE] __attribute__((aligned(4))); // Double buffering to receive a new frame while the previous one is being packed
+static unsigned char layer_frame_pool[2][LAYER_FRAME_BUFFER_MAX_SIZE] __attribute__((aligned(4))); // Frames are decoded into the one that isn't the reference
+static unsigned char * layer_frame = layer_frame_pool[0]; // Last decoded frame, reference for the delta encoding
+static unsigned char layer_canvas_frame[LAYER_FRAME_BUFFER_SIZE] __attribute__((aligned(4))); // Only accessed outside of the interrupts
+static struct layer_timed_header layer_frame_header; // Only the frame header is received in framed ingest mode
+static struct frame_palette layer_frame_palette; // Kept across frames for the palette encodings
+static unsigned short layer_lut[LAYER_FRAME_DEPTH][LAYER_LUT_SIZE]; // Indexed by enum layer_channel
+static struct layer_image layer_image_pool[LAYER_IMAGE_POOL_SIZE]; // Ring of the image being drawn followed by the queued images
+static unsigned char * layer_recv_buffer = layer_buffer_pool[0]; // Buffer for receiving pixel data to form a new frame
+static struct layer_image * layer_draw_image = &layer_image_pool[0]; // Image that is used to write data to the TLC5940s
+static volatile unsigned int layer_draw_index; // Index of draw_image, only advanced by the latch handler
+static volatile unsigned int layer_queue_tail = 1; // Index of the image the next frame is packed into, only advanced by the DMA interrupt
+static volatile unsigned int layer_present_ticks; // Core timer ticks at which draw_image was presented
+static unsigned char layer_send_row[TLC5940_IMAGE_SIZE]; // Dithered or faded row that is being sent to the TLC5940s
+#ifdef LAYER_DITHER
+static unsigned int layer_dither_phase; // Advanced every scan cycle
+#endif
+static struct layer_image * volatile layer_fade_image; // Image that is faded from, NULL if not fading
+static unsigned int layer_fade_cycles; // Number of scan cycles a fade takes, 0 if disabled
+static unsigned int layer_fade_cycle; // Scan cycles since the fade started
+static unsigned int layer_fade_weight; // Weight of the image being drawn, see fade_row
+#ifdef LAYER_REMAP
+static enum layer_remap layer_remap = LAYER_REMAP_NONE;
+static unsigned char layer_remap_table[LAYER_NUM_OF_LEDS]; // Pixel of the frame every pixel takes, in row-major order
+#endif
+#ifdef LAYER_INTERLACED
+static enum layer_scan_order layer_scan_order = LAYER_SCAN_INTERLACED;
+#else
+static enum layer_scan_order layer_scan_order = LAYER_SCAN_INCREMENTAL;
+#endif
+static unsigned int layer_scan_rows = LAYER_NUM_OF_ROWS; // Configured geometry, the scan is built from it at init
+static unsigned char layer_row_map[LAYER_NUM_OF_ROWS]; // Pin of every row
+static bool layer_row_map_loaded; // Else the rows default to the pins in order at init
+static unsigned char layer_scan[LAYER_NUM_OF_ROWS]; // Row of every scan slot
+static struct io_pin const * layer_scan_pins[LAYER_NUM_OF_ROWS]; // Pin of every scan slot
+static unsigned int layer_scan_length = 1; // Number of scan slots
+static unsigned int layer_row_next; // Scan slot of row_pin
 static struct io_pin const * layer_row_pin = layer_pins;
-static struct io_pin const * layer_row_previous_pin = &layer_pins[LAYER_NUM_OF_ROWS - 1];
+static struct io_pin const * layer_row_previous_pin = layer_pins;
 static struct dma_channel * layer_dma_channel;
 static struct spi_module * layer_spi_module;
 static struct timer_module * layer_countdown_timer;
 static enum layer_state layer_state = LAYER_SWITCH_ENABLED_MODE;
+static enum layer_ingest_mode layer_ingest_mode = LAYER_INGEST_RAW;
+static enum layer_color_depth layer_color_depth = LAYER_COLOR_DEPTH_8;
 #ifdef LAYER_AUTO_BUFFER_SWAP_ON
 #warning "LAYER_AUTO_BUFFER_SWAP_ON defined"
 static enum layer_buffer_swap_mode layer_buffer_swap_mode = LAYER_BUFFER_SWAP_AUTO;
 #else
 static enum layer_buffer_swap_mode layer_buffer_swap_mode = LAYER_BUFFER_SWAP_MANUAL;
 #endif
-static unsigned int layer_row_index; // Active row, corresponding row IO is layer_pins[layer_row_index]
+static unsigned int layer_row_index; // Active scan slot, corresponding row IO is layer_scan_pins[layer_row_index]
+static volatile bool layer_buffer_swap_armed; // Buffer swap waiting for a commit, also read by the DMA interrupt
+static unsigned int layer_missed_buffer_swap_commits; // Number of commits received without being armed
+static bool layer_recv_frame_header; // Set if the DMA is receiving a frame header instead of the frame data
+static unsigned int layer_received_frames;
+static unsigned int layer_dropped_frames;
+static bool layer_keyframe_needed; // Set when a frame failed to decode, until a frame that doesn't depend on the reference is decoded
+static unsigned int layer_partial_frames;
+static unsigned int layer_queue_overflows;
+static unsigned int layer_late_frames;
+static bool layer_pack_all_rows; // Set if a frame was dropped after decoding, so the images miss its rows
+static volatile bool layer_low_latency;
+static volatile unsigned int layer_stream_rows[2]; // Rows of the frame in each receive buffer that are drawn in low latency mode
+static unsigned int layer_streamed_rows;
+static unsigned int layer_resyncs;
+static unsigned int layer_dma_recoveries;
+static volatile bool layer_canvas_outdated; // Set when a frame is decoded, which is copied into the canvas before it's drawn on
+static unsigned int layer_committed_frames;
+static unsigned int layer_ingest_ticks_max; // See layer_ingest_time
+static bool layer_dither;
+#ifdef LAYER_OVERLAY
+static unsigned char layer_overlay[LAYER_FRAME_BUFFER_SIZE] __attribute__((aligned(4)));
+static uint32_t layer_overlay_key[LAYER_FRAME_DEPTH]; // Key color splat over the lanes, indexed by enum layer_channel
+static volatile unsigned int layer_overlay_weight; // Weight of the overlay out of 256, 0 if disabled
+static enum layer_draw_target layer_draw_target = LAYER_DRAW_CANVAS;
+#endif
+
+inline static bool __attribute__((always_inline)) layer_queue_empty(void)
+{
+    return layer_queue_tail == LAYER_QUEUE_NEXT(layer_draw_index);
+}
+
+inline static unsigned int __attribute__((always_inline)) layer_queued_frames(void)
+{
+    return (layer_queue_tail + LAYER_IMAGE_POOL_SIZE - layer_draw_index - 1) % LAYER_IMAGE_POOL_SIZE;
+}
+
+inline static unsigned int __attribute__((always_inline)) layer_frame_size(void)
+{
+    return (layer_color_depth == LAYER_COLOR_DEPTH_12)
+        ? LAYER_FRAME_BUFFER_SIZE_12
+        : LAYER_FRAME_BUFFER_SIZE;
+}
+
+// Holds off the DMA interrupt, which ingests the received frames, and the slave select interrupt,
+// which restarts the reception, while the task changes what they work with. They're not configured
+// yet while the settings are loaded at boot.
+inline static void __attribute__((always_inline)) layer_hold_ingest(void)
+{
+    if (layer_dma_channel != NULL) {
+        ATOMIC_REG_CLR(LAYER_CN_IEC_REG, LAYER_CN_INT_MASK);
+        dma_mask_interrupt(layer_dma_channel);
+    }
+}
+
+inline static void __attribute__((always_inline)) layer_release_ingest(void)
+{
+    if (layer_dma_channel != NULL) {
+        dma_unmask_interrupt(layer_dma_channel);
+        ATOMIC_REG_SET(LAYER_CN_IEC_REG, LAYER_CN_INT_MASK);
+    }
+}
+
+static void layer_pack_channels(
+    struct layer_image * image,
+    unsigned int row,
+    unsigned int device,
+    unsigned char const * values,
+    unsigned short const * lut)
+{
+    unsigned short pwm_values[LAYER_NUM_OF_COLS];
+
+#ifdef LAYER_DITHER
+    if (layer_dither) {
+        // Pack the integer part, the fraction is added by dithering the row when it is sent
+        for (unsigned int col = 0; col < LAYER_NUM_OF_COLS; ++col) {
+            unsigned short value = lut[values[col]];
+            pwm_values[col] = value >> LAYER_LUT_FRACTION_BITS;
+            dither_set_fraction(image->fractions[row], device * LAYER_NUM_OF_COLS + col, value);
+        }
+        tlc5940_pack_channels(image->rows[row], device, pwm_values);
+        return;
+    }
+#endif
+
+    for (unsigned int col = 0; col < LAYER_NUM_OF_COLS; ++col)
+        pwm_values[col] = LAYER_LUT_ROUND(lut[values[col]]);
+    tlc5940_pack_channels(image->rows[row], device, pwm_values);
+}
+
+#ifdef LAYER_REMAP
+static void layer_remap_row(
+    swar_word_t remapped[LAYER_FRAME_DEPTH][LAYER_NUM_OF_COLS / SWAR_LANES],
+    unsigned char const * frame,
+    unsigned int row)
+{
+    unsigned char const * sources = &layer_remap_table[LAYER_OFFSET(row)];
+
+    for (unsigned int channel = 0; channel < LAYER_FRAME_DEPTH; ++channel) {
+        unsigned char const * plane = frame + channel * LAYER_NUM_OF_LEDS;
+        unsigned char * values = (unsigned char *)remapped[channel];
+        for (unsigned int col = 0; col < LAYER_NUM_OF_COLS; ++col)
+            values[col] = plane[sources[col]];
+    }
+}
+
+static void layer_remap_row_mode12(
+    unsigned short remapped[LAYER_FRAME_DEPTH][LAYER_NUM_OF_COLS],
+    unsigned char const * frame,
+    unsigned int row)
+{
+    unsigned char const * sources = &layer_remap_table[LAYER_OFFSET(row)];
+
+    // Two channels are packed in three bytes, the even channel in the most significant bits
+    for (unsigned int channel = 0; channel < LAYER_FRAME_DEPTH; ++channel) {
+        unsigned char const * plane = frame + channel * LAYER_NUM_OF_ROWS * LAYER_ROW_SIZE_12;
+        for (unsigned int col = 0; col < LAYER_NUM_OF_COLS; ++col) {
+            unsigned int source = sources[col];
+            unsigned char const * pair = plane + (source / LAYER_NUM_OF_COLS) * LAYER_ROW_SIZE_12 + (source % LAYER_NUM_OF_COLS) / 2 * 3;
+            remapped[channel][col] = (source & 1)
+                ? (pair[1] & 0x0f) << 8 | pair[2]
+                : pair[0] << 4 | pair[1] >> 4;
+        }
+    }
+}
+#endif
+
+#ifdef LAYER_OVERLAY
+static void layer_compose_row(
+    swar_word_t composed[LAYER_FRAME_DEPTH][LAYER_NUM_OF_COLS / SWAR_LANES],
+    unsigned char const * frame,
+    unsigned int frame_stride, // Between the planes
+    unsigned char const * overlay,
+    unsigned int overlay_stride,
+    unsigned int weight)
+{
+    for (unsigned int i = 0; i < LAYER_NUM_OF_COLS / SWAR_LANES; ++i) {
+        uint32_t below[LAYER_FRAME_DEPTH];
+        uint32_t above[LAYER_FRAME_DEPTH];
+        for (unsigned int channel = 0; channel < LAYER_FRAME_DEPTH; ++channel) {
+            below[channel] = ((swar_word_t const *)(frame + channel * frame_stride))[i];
+            above[channel] = ((swar_word_t const *)(overlay + channel * overlay_stride))[i];
+        }
+
+        // Pixels that differ from the key color in any channel are blended, the others are transparent
+        uint32_t mask = swar_mask_nonzero(
+            (above[LAYER_CHANNEL_RED] ^ layer_overlay_key[LAYER_CHANNEL_RED])
+            | (above[LAYER_CHANNEL_GREEN] ^ layer_overlay_key[LAYER_CHANNEL_GREEN])
+            | (above[LAYER_CHANNEL_BLUE] ^ layer_overlay_key[LAYER_CHANNEL_BLUE]));
+
+        for (unsigned int channel = 0; channel < LAYER_FRAME_DEPTH; ++channel)
+            composed[channel][i] = (swar_lerp(below[channel], above[channel], weight) & mask) | (below[channel] & ~mask);
+    }
+}
+#endif
+
+static void layer_pack_rows(struct layer_image * image, unsigned char const * frame, unsigned int first, unsigned int count)
+{
+#ifdef LAYER_REMAP
+    enum layer_remap remap = layer_remap; // The same for all rows
+#endif
+
+    if (layer_color_depth == LAYER_COLOR_DEPTH_12) {
+        for (unsigned int row = first; row < first + count; ++row) {
+#ifdef LAYER_REMAP
+            if (remap != LAYER_REMAP_NONE) {
+                unsigned short remapped[LAYER_FRAME_DEPTH][LAYER_NUM_OF_COLS];
+                layer_remap_row_mode12(remapped, frame, row);
+                tlc5940_pack_channels(image->rows[row], LAYER_BLUE_DEVICE, remapped[LAYER_CHANNEL_BLUE]);
+                tlc5940_pack_channels(image->rows[row], LAYER_GREEN_DEVICE, remapped[LAYER_CHANNEL_GREEN]);
+                tlc5940_pack_channels(image->rows[row], LAYER_RED_DEVICE, remapped[LAYER_CHANNEL_RED]);
+            } else
+#endif
+            {
+                unsigned char const * values = frame + row * LAYER_ROW_SIZE_12;
+                tlc5940_pack_channels_mode12(image->rows[row], LAYER_BLUE_DEVICE, values + LAYER_BLUE_OFFSET_12);
+                tlc5940_pack_channels_mode12(image->rows[row], LAYER_GREEN_DEVICE, values + LAYER_GREEN_OFFSET_12);
+                tlc5940_pack_channels_mode12(image->rows[row], LAYER_RED_DEVICE, values + LAYER_RED_OFFSET_12);
+            }
+#ifdef LAYER_DITHER
+            memset(image->fractions[row], 0, sizeof(image->fractions[row])); // Nothing to dither
+#endif
+        }
+        return;
+    }
+
+    // Lookup tables are only applied to the 8 bit color depth, 12 bit frames are expected to be corrected by the host
+    for (unsigned int row = first; row < first + count; ++row) {
+        unsigned char const * values = frame + LAYER_OFFSET(row);
+        unsigned int stride = LAYER_NUM_OF_LEDS; // Between the planes of the values
+
+#ifdef LAYER_REMAP
+        swar_word_t remapped[LAYER_FRAME_DEPTH][LAYER_NUM_OF_COLS / SWAR_LANES];
+        if (remap != LAYER_REMAP_NONE) {
+            layer_remap_row(remapped, frame, row);
+            values = (unsigned char const *)remapped;
+            stride = LAYER_NUM_OF_COLS;
+        }
+#endif
+
+#ifdef LAYER_OVERLAY
+        // The overlay is composited a row at a time, so the frame itself is left as is. The
+        // overlay is drawn in the orientation of the frames, so it's remapped the same way.
+        swar_word_t composed[LAYER_FRAME_DEPTH][LAYER_NUM_OF_COLS / SWAR_LANES];
+        unsigned int weight = layer_overlay_weight;
+        if (weight) {
+            unsigned char const * overlay = layer_overlay + LAYER_OFFSET(row);
+            unsigned int overlay_stride = LAYER_NUM_OF_LEDS;
+#ifdef LAYER_REMAP
+            if (remap != LAYER_REMAP_NONE) {
+                layer_remap_row(composed, layer_overlay, row);
+                overlay = (unsigned char const *)composed;
+                overlay_stride = LAYER_NUM_OF_COLS;
+            }
+#endif
+
+            // Composited in place, every word is read before it's written
+            layer_compose_row(composed, values, stride, overlay, overlay_stride, weight);
+            values = (unsigned char const *)composed;
+            stride = LAYER_NUM_OF_COLS;
+        }
+#endif
+
+        layer_pack_channels(image, row, LAYER_BLUE_DEVICE, values + LAYER_CHANNEL_BLUE * stride, layer_lut[LAYER_CHANNEL_BLUE]);
+        layer_pack_channels(image, row, LAYER_GREEN_DEVICE, values + LAYER_CHANNEL_GREEN * stride, layer_lut[LAYER_CHANNEL_GREEN]);
+        layer_pack_channels(image, row, LAYER_RED_DEVICE, values + LAYER_CHANNEL_RED * stride, layer_lut[LAYER_CHANNEL_RED]);
+    }
+}
+
+static void layer_dma_start_transfer(struct dma_channel * channel)
+{
+    // In framed ingest mode every transfer of frame data is preceded by a transfer
+    // of the header, which tells how much data to expect
+    layer_recv_frame_header = (layer_ingest_mode != LAYER_INGEST_RAW);
+    if (layer_ingest_mode == LAYER_INGEST_TIMED)
+        dma_configure_dst(channel, &layer_frame_header, LAYER_TIMED_HEADER_SIZE);
+    else if (layer_ingest_mode == LAYER_INGEST_FRAMED)
+        dma_configure_dst(channel, &layer_frame_header, LAYER_FRAME_HEADER_SIZE);
+    else
+        dma_configure_dst(channel, layer_recv_buffer, layer_frame_size());
+    dma_enable_transfer(channel);
+}
+
+inline static unsigned int __attribute__((always_inline)) layer_stream_row_end(unsigned int row)
+{
+    // Frames are planar and the blue plane is received last
+    return (layer_color_depth == LAYER_COLOR_DEPTH_12)
+        ? LAYER_BLUE_OFFSET_12 + (row + 1) * LAYER_ROW_SIZE_12
+        : LAYER_BLUE_OFFSET + (row + 1) * LAYER_NUM_OF_COLS;
+}
+
+static void layer_stream_row(unsigned int row)
+{
+    // Draw the row of the frame that is being received if it has arrived, or else
+    // the row of the previously received frame, unless it is drawn already
+    unsigned int index = (layer_recv_buffer == layer_buffer_pool[0]) ? 0 : 1;
+    bool received = dma_get_dst_pointer(layer_dma_channel) >= layer_stream_row_end(row);
+    if (!received)
+        index ^= 1;
+
+    if (layer_stream_rows[index] & BIT(row))
+        return;
+
+    layer_pack_rows(layer_draw_image, layer_buffer_pool[index], row, 1);
+    layer_stream_rows[index] |= BIT(row);
+    if (received)
+        layer_streamed_rows++;
+}
+
+// Received frames are decoded and packed in the DMA interrupt (IPL3), so they are ready to be
+// presented as soon as they are received. The RS485 interrupt (IPL5) and the TLC5940 interrupts
+// (IPL7) preempt it, so no bus character is lost and the scan carries on, but the main loop is
+// held up meanwhile. The bus reads the characters received in the meantime afterwards, which
+// only fails when a request is held up for longer than BUS_FRAME_PART_DEADLINE (2 ms) or the
+// RS485 receive FIFO fills up (100 characters, 8.7 ms at 115200 baud). The worst case is a
+// framed 12 bit frame that is remapped with the overlay and dithering on, estimated at half a
+// millisecond (some 50 cycles for every channel). The longest time is kept for
+// LAYER_STAT_INGEST_TIME_MAX, so the margin can be checked on the device.
+inline static void __attribute__((always_inline)) layer_ingest_time(unsigned int start)
+{
+    unsigned int ticks = SYS_CORE_TICKS() - start;
+    if (ticks > layer_ingest_ticks_max)
+        layer_ingest_ticks_max = ticks;
+}
+
+static void layer_dma_receive(struct dma_channel * channel)
+{
+    unsigned char * frame = layer_recv_buffer;
+
+    if (layer_recv_frame_header) {
+        // We are out of sync with the host if the header is not valid, which needs a DMA reset
+        if (layer_frame_header.frame.encoding >= FRAME_ENCODING_COUNT
+            || layer_frame_header.frame.size == 0
+            || layer_frame_header.frame.size > LAYER_FRAME_BUFFER_MAX_SIZE
+            || (layer_ingest_mode == LAYER_INGEST_TIMED && layer_frame_header.timing > LAYER_TIMING_HOLD)) {
+            layer_dma_transfer_abort(channel);
+            return;
+        }
+
+        layer_recv_frame_header = false;
+        dma_configure_dst(channel, layer_recv_buffer, layer_frame_header.frame.size);
+        dma_enable_transfer(channel);
+        return;
+    }
+
+    // Start next transfer before decoding and packing, so no data is lost in the meantime.
+    // This includes the next header, hence the copy.
+    struct frame_header header = layer_frame_header.frame;
+    enum layer_timing timing = (layer_ingest_mode == LAYER_INGEST_TIMED) ? layer_frame_header.timing : LAYER_TIMING_NONE;
+    unsigned int time = layer_frame_header.time;
+    struct frame_rows rows = { .first = 0, .count = LAYER_NUM_OF_ROWS - 1 };
+    unsigned int next = (frame == layer_buffer_pool[0]) ? 1 : 0;
+    layer_stream_rows[next] = LAYER_STREAM_ALL_ROWS; // Nothing to draw until the transfer is started
+    layer_recv_buffer = layer_buffer_pool[next];
+    layer_dma_start_transfer(channel);
+
+    // The rows are drawn by the update handler as they arrive, rows of this frame that
+    // are not drawn yet are taken from this buffer until the next frame's rows arrive
+    if (layer_low_latency) {
+        layer_stream_rows[next] = 0;
+        layer_received_frames++;
+        return;
+    }
+
+    if (layer_ingest_mode != LAYER_INGEST_RAW) {
+        // The frame is decoded into the other frame of the pool, which only becomes the reference
+        // once it decoded without errors, so a frame that fails leaves the reference as it was.
+        // The encodings that change the reference in place start from a copy of it.
+        unsigned char * decoded_frame = (layer_frame == layer_frame_pool[0]) ? layer_frame_pool[1] : layer_frame_pool[0];
+        bool keyframe = header.encoding == FRAME_ENCODING_RAW || header.encoding == FRAME_ENCODING_RLE;
+        bool decoded;
+
+        if (header.encoding == FRAME_ENCODING_DELTA || header.encoding == FRAME_ENCODING_ROWS)
+            memcpy(decoded_frame, layer_frame, layer_frame_size());
+
+        // The rows are copied in place, so the rows that are not sent carry over
+        if (header.encoding == FRAME_ENCODING_ROWS)
+            decoded = frame_decode_rows(decoded_frame, layer_frame_size(), LAYER_NUM_OF_ROWS, frame, header.size, &rows);
+        // The palette holds 8 bit colors, so it can't be used for the 12 bit color depth
+        else
+            decoded = frame_decode(
+                header.encoding,
+                decoded_frame,
+                layer_frame_size(),
+                (layer_color_depth == LAYER_COLOR_DEPTH_8) ? &layer_frame_palette : NULL,
+                frame,
+                header.size);
+
+        // The host computed the frames that follow from the frame that failed, so they're
+        // wrong until the host sends a keyframe, see LAYER_STAT_KEYFRAME_NEEDED
+        if (!decoded) {
+            layer_dropped_frames++;
+            layer_keyframe_needed = true;
+            return;
+        }
+        if (keyframe)
+            layer_keyframe_needed = false;
+        layer_frame = decoded_frame;
+        layer_canvas_outdated = true;
+        frame = layer_frame;
+    }
+#ifdef LAYER_OVERLAY
+    // The frame underneath the overlay is kept, so the overlay can be committed without the frame being sent again
+    else if (layer_color_depth == LAYER_COLOR_DEPTH_8) {
+        memcpy(layer_frame, frame, LAYER_FRAME_BUFFER_SIZE);
+        layer_canvas_outdated = true;
+        frame = layer_frame;
+    }
+#endif
+
+    if (layer_queue_frame(frame, rows, timing, time))
+        layer_received_frames++;
+}
 
 static void layer_dma_block_transfer_complete(struct dma_channel * channel)
+{
+    unsigned int start = SYS_CORE_TICKS();
+    layer_dma_receive(channel);
+    layer_ingest_time(start);
+}
+
+static bool layer_queue_frame(unsigned char const * frame, struct frame_rows rows, enum layer_timing timing, unsigned int time)
 {
     layer_flags.buffer_swap_semaphore = false;
-    unsigned char * tmp = layer_sync_buffer;
-    layer_sync_buffer = layer_recv_buffer;
-    layer_recv_buffer = tmp;
 
-    layer_flags.do_buffer_swap = (layer_buffer_swap_mode == LAYER_BUFFER_SWAP_AUTO);
+    // A frame without timing replaces a queued frame without timing, so there is only
+    // one such frame waiting for a buffer swap. Other frames are added to the queue, as
+    // is every frame while the queued frame is armed or committed for a buffer swap, so
+    // the frame that is swapped to is the frame that was armed.
+    unsigned int newest = LAYER_QUEUE_PREVIOUS(layer_queue_tail);
+    bool swap_pending = layer_buffer_swap_armed
+        || (layer_buffer_swap_mode == LAYER_BUFFER_SWAP_MANUAL && layer_flags.do_buffer_swap);
+    bool replace = timing == LAYER_TIMING_NONE
+        && !swap_pending
+        && !layer_queue_empty()
+        && layer_image_pool[newest].timing == LAYER_TIMING_NONE;
+    struct layer_image * image = replace ? &layer_image_pool[newest] : &layer_image_pool[layer_queue_tail];
+
+    // The image that is faded from precedes the image being drawn in the ring, so the queue only
+    // wraps around to it when it's full but for one image. It's kept until the fade ends, a frame
+    // that would be packed into it is dropped just like a frame that overflows the queue.
+    if ((!replace && layer_queue_tail == layer_draw_index) || image == layer_fade_image) {
+        layer_queue_overflows++;
+        layer_pack_all_rows = true;
+        layer_flags.buffer_swap_semaphore = true;
+        return false;
+    }
+
+    // Only the updated rows are packed, the others are taken from the newest image,
+    // which is the image being drawn if the queue is empty
+    if (layer_pack_all_rows) {
+        rows.first = 0;
+        rows.count = LAYER_NUM_OF_ROWS - 1;
+        layer_pack_all_rows = false;
+    } else if (rows.count != LAYER_NUM_OF_ROWS - 1) {
+        if (!replace)
+            *image = layer_image_pool[newest];
+        layer_partial_frames++;
+    }
+#ifdef LAYER_REMAP
+    // A remapped row takes its pixels from any of the rows
+    if (layer_remap != LAYER_REMAP_NONE) {
+        rows.first = 0;
+        rows.count = LAYER_NUM_OF_ROWS - 1;
+    }
+#endif
+    layer_pack_rows(image, frame, rows.first, rows.count + 1);
+    image->timing = timing;
+    image->time = (timing == LAYER_TIMING_HOLD && time > LAYER_HOLD_MAX) ? LAYER_HOLD_MAX : time;
+
+    if (!replace)
+        layer_queue_tail = LAYER_QUEUE_NEXT(layer_queue_tail);
+    if (!swap_pending)
+        layer_flags.do_buffer_swap = (layer_buffer_swap_mode == LAYER_BUFFER_SWAP_AUTO);
     layer_flags.buffer_swap_semaphore = true;
+    return true;
+}
 
-    // Start next transfer
-    dma_configure_dst(channel, layer_recv_buffer, LAYER_FRAME_BUFFER_SIZE);
-    dma_enable_transfer(channel);
+inline static bool __attribute__((always_inline)) layer_dma_at_frame_start(void)
+{
+    // The slave select interrupt has a lower vector than the DMA interrupt, so at the same
+    // priority it's serviced first when both are pending. The block that completed is then
+    // still to be handled, the pointer is already back at 0 but the header is not expected.
+    if (dma_block_transfer_pending(layer_dma_channel))
+        return true;
+
+    // The DMA moves every received byte long before the slave select interrupt is
+    // serviced, so nothing is received of the next frame if the pointer is 0
+    return dma_get_dst_pointer(layer_dma_channel) == 0 && layer_recv_frame_header;
+}
+
+void __ISR(LAYER_CN_ISR_VECTOR, IPL3SOFT) layer_ss_interrupt(void)
+{
+    // A host sending framed or timed frames releases the slave select after every frame, if we
+    // are not at the start of the next frame by then the frame was truncated (or too long) and is
+    // dropped, so the next frame is received from its start. Hosts sending raw frames may keep the
+    // slave select low or release it anywhere, so they aren't resynced. Reading the pin clears the
+    // change notice.
+    if (IO_READ(layer_ss_pin) && layer_ingest_mode != LAYER_INGEST_RAW
+        && !layer_flags.dma_error && !layer_dma_at_frame_start()) {
+        layer_resyncs++;
+        layer_dma_restart();
+    }
+
+    ATOMIC_REG_CLR(LAYER_CN_IFS_REG, LAYER_CN_INT_MASK);
 }
 
 static void layer_dma_transfer_abort(struct dma_channel * channel)
@@ -220,20 +718,21 @@ static void layer_row_reset(void)
     IO_PTR_CLR(layer_row_previous_pin);
     IO_PTR_CLR(layer_row_pin);
 
-    layer_row_pin = layer_pins;
-    layer_row_previous_pin = &layer_pins[LAYER_NUM_OF_ROWS - 1];
+    layer_row_pin = layer_scan_pins[0];
+    layer_row_previous_pin = layer_scan_pins[layer_scan_length - 1];
+    layer_row_next = 0;
     layer_row_index = 0;
 }
 
 inline static bool __attribute__((always_inline)) layer_row_at_end(void)
 {
-    return layer_row_index == (LAYER_NUM_OF_ROWS - 1);
+    return layer_row_index == (layer_scan_length - 1);
 }
 
 inline static unsigned int __attribute__((always_inline)) layer_next_row_index(void)
 {
-    if (IO_READ(layer_pins[layer_row_index]))
-        return (layer_row_index + 1) % LAYER_NUM_OF_ROWS;
+    if (IO_READ(*layer_scan_pins[layer_row_index]))
+        return layer_row_at_end() ? 0 : layer_row_index + 1;
 
     // This means that layer_row_reset() was just called (or a CPU reset)
     // and we have yet to make the first row active in tlc5940_latch_callback
@@ -245,28 +744,104 @@ inline static void  __attribute__((always_inline)) layer_advance_row(void)
     IO_PTR_CLR(layer_row_previous_pin);
     IO_PTR_SET(layer_row_pin);
 
-    layer_row_index = (unsigned int)(layer_row_pin - layer_pins);
+    layer_row_index = layer_row_next;
     layer_row_previous_pin = layer_row_pin;
-    layer_row_pin = layer_row_at_end() ? layer_pins : (layer_row_pin + 1);
+    layer_row_next = layer_row_at_end() ? 0 : (layer_row_next + 1);
+    layer_row_pin = layer_scan_pins[layer_row_next];
+}
+
+static void layer_scan_build(void)
+{
+    unsigned int slot = 0;
+
+    // Interlaced scanning does the odd rows first, then the even rows
+    if (layer_scan_order == LAYER_SCAN_INTERLACED) {
+        for (unsigned int row = 1; row < layer_scan_rows; row += 2)
+            layer_scan[slot++] = row;
+        for (unsigned int row = 0; row < layer_scan_rows; row += 2)
+            layer_scan[slot++] = row;
+    } else {
+        for (unsigned int row = 0; row < layer_scan_rows; ++row)
+            layer_scan[slot++] = row;
+    }
+
+    for (slot = 0; slot < layer_scan_rows; ++slot)
+        layer_scan_pins[slot] = &layer_pins[layer_row_map[layer_scan[slot]]];
+    layer_scan_length = layer_scan_rows;
+    layer_row_pin = layer_scan_pins[0];
+    layer_row_previous_pin = layer_scan_pins[layer_scan_length - 1];
 }
 
 void tlc5940_update_handler(void)
 {
-    unsigned int offset = layer_offset[layer_next_row_index()];
-    tlc5940_write_channels_mode8(0, &layer_draw_buffer[offset + LAYER_BLUE_OFFSET]);
-    tlc5940_write_channels_mode8(1, &layer_draw_buffer[offset + LAYER_GREEN_OFFSET]);
-    tlc5940_write_channels_mode8(2, &layer_draw_buffer[offset + LAYER_RED_OFFSET]);
+    unsigned int row = layer_scan[layer_next_row_index()];
+
+    if (layer_low_latency)
+        layer_stream_row(row);
+
+    // The previous row is already sent, so the row buffer can be reused. The fractions
+    // of the dithering are left out while fading, as the fade changes the channels anyway.
+    // The fade can end in the latch handler while the row is faded, after which the DMA interrupt
+    // may pack a received frame into the image, so it's held off until the row is faded (a few
+    // microseconds).
+    dma_mask_interrupt(layer_dma_channel);
+    struct layer_image const * fade_image = layer_fade_image;
+    if (fade_image != NULL) {
+        fade_row(layer_send_row, fade_image->rows[row], layer_draw_image->rows[row], LAYER_ROW_CHANNELS, layer_fade_weight);
+        dma_unmask_interrupt(layer_dma_channel);
+        tlc5940_write_image(layer_send_row);
+        return;
+    }
+    dma_unmask_interrupt(layer_dma_channel);
+
+#ifdef LAYER_DITHER
+    if (layer_dither) {
+        dither_row(layer_send_row, layer_draw_image->rows[row], layer_draw_image->fractions[row], LAYER_ROW_CHANNELS, layer_dither_phase + row);
+        tlc5940_write_image(layer_send_row);
+        return;
+    }
+#endif
+
+    tlc5940_write_image(layer_draw_image->rows[row]);
 }
 
 void tlc5940_latch_handler(void)
 {
-    // Only swap the buffers when we wrap around from the last row
+    // Only present the next frame when we wrap around from the last row
     // to the first row so we prevent any mid frame tearing.
-    if (layer_row_at_end() && layer_flags.buffer_swap_semaphore && layer_flags.do_buffer_swap) {
-        unsigned char * tmp = layer_draw_buffer;
-        layer_draw_buffer = layer_sync_buffer;
-        layer_sync_buffer = tmp;
-        layer_flags.do_buffer_swap = false;
+    if (layer_row_at_end() && layer_flags.buffer_swap_semaphore && !layer_queue_empty()) {
+        unsigned int next = LAYER_QUEUE_NEXT(layer_draw_index);
+        bool present = (layer_image_pool[next].timing == LAYER_TIMING_NONE)
+            ? layer_flags.do_buffer_swap
+            : layer_flags.present_due;
+
+        if (present) {
+            // Fade from the image that was drawn, if a fade is still going on it's cut short
+            if (layer_fade_cycles) {
+                layer_fade_image = layer_draw_image;
+                layer_fade_cycle = 0;
+            }
+
+            layer_draw_image = &layer_image_pool[next];
+            layer_draw_index = next;
+            layer_present_ticks = SYS_CORE_TICKS();
+            layer_flags.do_buffer_swap = false;
+            layer_flags.present_due = false;
+        }
+    }
+
+#ifdef LAYER_DITHER
+    if (layer_row_at_end())
+        layer_dither_phase++;
+#endif
+
+    // The weight of the image being drawn goes up every scan cycle, it's never faded all the
+    // way so the fade ends after the given number of scan cycles with the image as it is
+    if (layer_row_at_end() && layer_fade_image != NULL) {
+        if (layer_fade_cycle >= layer_fade_cycles)
+            layer_fade_image = NULL;
+        else
+            layer_fade_weight = (++layer_fade_cycle * FADE_WEIGHT_MAX) / (layer_fade_cycles + 1);
     }
 
     layer_advance_row();
@@ -274,6 +849,13 @@ void tlc5940_latch_handler(void)
 
 static int layer_rtask_init(void)
 {
+    layer_lut_reset();
+    if (!layer_row_map_loaded) {
+        for (unsigned int row = 0; row < LAYER_NUM_OF_ROWS; ++row)
+            layer_row_map[row] = row;
+    }
+    layer_scan_build(); // The geometry is loaded with the settings by now
+
     // Configure PPS
     sys_unlock();
     LAYER_SDI_PPS_REG = LAYER_SDI_PPS_WORD;
@@ -284,7 +866,7 @@ static int layer_rtask_init(void)
     io_configure(IO_DIRECTION_DIN, &layer_sdi_pin, 1);
     io_configure(IO_DIRECTION_DIN, &layer_sck_pin, 1);
     io_configure(IO_DIRECTION_DIN, &layer_ss_pin, 1);
-    io_configure(IO_DIRECTION_DOUT_LOW, layer_pins, LAYER_NUM_OF_ROWS);
+    io_configure(IO_DIRECTION_DOUT_LOW, layer_pins, LAYER_NUM_OF_PINS); // Also the pins of the rows that aren't scanned
 
     // Initialize timer
     layer_countdown_timer = timer_construct(TIMER_TYPE_COUNTDOWN, NULL);
@@ -303,9 +885,17 @@ static int layer_rtask_init(void)
     spi_configure_dma_src(layer_spi_module, layer_dma_channel); // SPI module is the source of the dma module
 
     // Enable transfer
-    dma_enable_transfer(layer_dma_channel);
+    layer_dma_start_transfer(layer_dma_channel);
     spi_enable(layer_spi_module);
 
+    // Enable change notice of the slave select to resync on frame boundaries
+    REG_SET(LAYER_CN_CON_REG, LAYER_CN_ON_MASK);
+    REG_SET(LAYER_CN_EN_REG, LAYER_CN_SS_MASK);
+    (void)IO_READ(layer_ss_pin); // Clears the mismatch
+    REG_SET(LAYER_CN_IPC_REG, LAYER_CN_INT_PRIORITY_MASK);
+    ATOMIC_REG_CLR(LAYER_CN_IFS_REG, LAYER_CN_INT_MASK);
+    ATOMIC_REG_SET(LAYER_CN_IEC_REG, LAYER_CN_INT_MASK);
+
     return KERN_INIT_SUCCESS;
 
 fail_spi:
@@ -317,8 +907,42 @@ fail_timer:
     return KERN_INIT_FAILED;
 }
 
+static void layer_queue_execute(void)
+{
+    if (layer_flags.present_due || layer_queue_empty())
+        return;
+
+    // Frames with timing are only presented by the latch handler once this flag is set,
+    // so the image being drawn and the next image can't change in the meantime
+    struct layer_image const * next = &layer_image_pool[LAYER_QUEUE_NEXT(layer_draw_index)];
+    if (next->timing == LAYER_TIMING_NONE)
+        return;
+    if (layer_draw_image->timing == LAYER_TIMING_HOLD
+        && SYS_CORE_TICKS_TO_US(SYS_CORE_TICKS() - layer_present_ticks) < layer_draw_image->time)
+        return;
+
+    if (next->timing == LAYER_TIMING_PRESENT) {
+        int lead = (int)(next->time - (unsigned int)clock_get_time());
+        if (lead > 0 && lead <= LAYER_PRESENT_LEAD_MAX)
+            return;
+        if (lead < -(int)layer_scan_period()) // Late by more than one scan cycle
+            layer_late_frames++;
+    }
+
+    layer_flags.present_due = true;
+}
+
 static void layer_rtask_execute(void)
 {
+    // Recover from a DMA error once the host is done sending (slave select is
+    // high), so the next frame is received from its start
+    if (layer_flags.dma_error && IO_READ(layer_ss_pin)) {
+        layer_dma_recoveries++;
+        layer_dma_reset();
+    }
+
+    layer_queue_execute();
+
     switch (layer_state) {
         default:
         case LAYER_SWITCH_ENABLED_MODE:
@@ -397,18 +1021,27 @@ bool layer_dma_error(void)
     return layer_flags.dma_error;
 }
 
-void layer_dma_reset(void)
+static void layer_dma_restart(void)
 {
     dma_disable_transfer(layer_dma_channel); // Keep this first as it prevents the interrupt from being serviced
     spi_disable(layer_spi_module); // Resets the SPI module
 
     layer_flags.dma_error = false;
+    layer_buffer_swap_armed = false; // Armed for a frame that may not be received anymore
 
-    dma_configure_dst(layer_dma_channel, layer_recv_buffer, LAYER_FRAME_BUFFER_SIZE);
-    dma_enable_transfer(layer_dma_channel);
+    layer_dma_start_transfer(layer_dma_channel);
+    layer_stream_rows[(layer_recv_buffer == layer_buffer_pool[0]) ? 0 : 1] = 0; // Rows of the restarted frame are drawn once they arrive
     spi_enable(layer_spi_module);
 }
 
+void layer_dma_reset(void)
+{
+    // The slave select interrupt restarts the reception as well
+    layer_hold_ingest();
+    layer_dma_restart();
+    layer_release_ingest();
+}
+
 bool layer_dma_swap_buffers(void)
 {
     if (layer_buffer_swap_mode != LAYER_BUFFER_SWAP_MANUAL)
@@ -420,6 +1053,39 @@ bool layer_dma_swap_buffers(void)
     return true;
 }
 
+bool layer_dma_arm_buffer_swap(void)
+{
+    // Two phase buffer swap so all layers of the cube can show a new frame at
+    // once: every layer is armed once it received the frame, then a single
+    // commit makes all armed layers swap on their next vertical sync. Frames
+    // received in the meantime are queued behind the armed frame.
+    if (layer_buffer_swap_mode != LAYER_BUFFER_SWAP_MANUAL)
+        return false;
+    if (layer_flags.do_buffer_swap || layer_queue_empty())
+        return false;
+
+    layer_buffer_swap_armed = true;
+    return true;
+}
+
+bool layer_dma_commit_buffer_swap(void)
+{
+    if (!layer_buffer_swap_armed) {
+        layer_missed_buffer_swap_commits++;
+        return false;
+    }
+
+    // Swap before disarming, so the DMA interrupt always sees one of them set (see layer_queue_frame)
+    layer_flags.do_buffer_swap = true;
+    layer_buffer_swap_armed = false;
+    return true;
+}
+
+unsigned int layer_get_missed_buffer_swap_commits(void)
+{
+    return layer_missed_buffer_swap_commits;
+}
+
 enum layer_buffer_swap_mode layer_get_buffer_swap_mode(void)
 {
     return layer_buffer_swap_mode;
@@ -428,8 +1094,591 @@ enum layer_buffer_swap_mode layer_get_buffer_swap_mode(void)
 void layer_set_buffer_swap_mode(enum layer_buffer_swap_mode mode)
 {
     layer_buffer_swap_mode = mode;
+    layer_buffer_swap_armed = false; // Only armed in the manual mode
+}
+
+enum layer_ingest_mode layer_get_ingest_mode(void)
+{
+    return layer_ingest_mode;
+}
+
+bool layer_set_ingest_mode(enum layer_ingest_mode mode)
+{
+    switch (mode) {
+        case LAYER_INGEST_RAW:
+        case LAYER_INGEST_FRAMED:
+        case LAYER_INGEST_TIMED:
+            break;
+        default:
+            return false;
+    }
+
+    if (layer_low_latency && mode != LAYER_INGEST_RAW)
+        return false;
+
+    // A frame that is being received is dropped, the host must
+    // start sending in the new mode after this call completes
+    layer_ingest_mode = mode;
+    layer_dma_reset();
+    return true;
+}
+
+enum layer_color_depth layer_get_color_depth(void)
+{
+    return layer_color_depth;
+}
+
+bool layer_set_color_depth(enum layer_color_depth depth)
+{
+    switch (depth) {
+        case LAYER_COLOR_DEPTH_8:
+#ifdef LAYER_DEEP_COLOR
+        case LAYER_COLOR_DEPTH_12:
+#endif
+            break;
+        default:
+            return false;
+    }
+
+    // The reference frame of the delta encoding is meaningless in another color
+    // depth, so the host must start with a full frame after this call completes
+    layer_color_depth = depth;
+    memset(layer_frame, 0, LAYER_FRAME_BUFFER_MAX_SIZE);
+    layer_canvas_outdated = true;
+    layer_dma_reset();
+    return true;
+}
+
+bool layer_get_low_latency(void)
+{
+    return layer_low_latency;
+}
+
+bool layer_set_low_latency(bool enable)
+{
+    if (enable && layer_ingest_mode != LAYER_INGEST_RAW)
+        return false;
+    if (enable == layer_low_latency)
+        return true;
+
+    // Queued frames would be drawn over by the streamed rows, so they are dropped
+    dma_disable_transfer(layer_dma_channel);
+    layer_stream_rows[0] = LAYER_STREAM_ALL_ROWS;
+    layer_stream_rows[1] = LAYER_STREAM_ALL_ROWS;
+    layer_queue_tail = LAYER_QUEUE_NEXT(layer_draw_index);
+    layer_low_latency = enable;
+    layer_dma_reset();
+    return true;
+}
+
+bool layer_stat(enum layer_stat stat, unsigned int * out)
+{
+    ASSERT_NOT_NULL(out);
+    if (out == NULL)
+        return false;
+
+    switch (stat) {
+        case LAYER_STAT_RECEIVED_FRAMES:    *out = layer_received_frames;   break;
+        case LAYER_STAT_DROPPED_FRAMES:     *out = layer_dropped_frames;    break;
+        case LAYER_STAT_PARTIAL_FRAMES:     *out = layer_partial_frames;    break;
+        case LAYER_STAT_QUEUED_FRAMES:      *out = layer_queued_frames();   break;
+        case LAYER_STAT_QUEUE_OVERFLOWS:    *out = layer_queue_overflows;   break;
+        case LAYER_STAT_LATE_FRAMES:        *out = layer_late_frames;       break;
+        case LAYER_STAT_STREAMED_ROWS:      *out = layer_streamed_rows;     break;
+        case LAYER_STAT_RESYNCS:            *out = layer_resyncs;           break;
+        case LAYER_STAT_DMA_RECOVERIES:     *out = layer_dma_recoveries;    break;
+        case LAYER_STAT_COMMITTED_FRAMES:   *out = layer_committed_frames;  break;
+        case LAYER_STAT_INGEST_TIME_MAX:    *out = SYS_CORE_TICKS_TO_US(layer_ingest_ticks_max); break;
+        case LAYER_STAT_KEYFRAME_NEEDED:    *out = layer_keyframe_needed;   break;
+        default:                                                            return false;
+    }
+
+    return true;
+}
+
+bool layer_lut_write(enum layer_channel channel, unsigned char index, unsigned short value)
+{
+    if (channel >= LAYER_FRAME_DEPTH || value > LAYER_LUT_MAX_VALUE)
+        return false;
+
+    // Takes effect from the next received frame on
+    layer_lut[channel][index] = value;
+    return true;
+}
+
+void layer_lut_reset(void)
+{
+    // Same linear scaling as without lookup table
+    for (unsigned int i = 0; i < LAYER_LUT_SIZE; ++i) {
+        layer_lut[LAYER_CHANNEL_RED][i] = LAYER_SCALE_MODE8(i) << LAYER_LUT_FRACTION_BITS;
+        layer_lut[LAYER_CHANNEL_GREEN][i] = LAYER_SCALE_MODE8(i) << LAYER_LUT_FRACTION_BITS;
+        layer_lut[LAYER_CHANNEL_BLUE][i] = LAYER_SCALE_MODE8(i) << LAYER_LUT_FRACTION_BITS;
+    }
+}
+
+bool layer_get_dither(void)
+{
+    return layer_dither;
+}
+
+bool layer_set_dither(bool enable)
+{
+#ifdef LAYER_DITHER
+    // Takes effect from the next received frame on, as the fractions are stored while packing
+    layer_dither = enable;
+    return true;
+#else
+    return !enable;
+#endif
+}
+
+unsigned int layer_get_fade(void)
+{
+    return layer_fade_cycles;
+}
+
+bool layer_set_fade(unsigned int cycles)
+{
+    if (cycles > LAYER_FADE_CYCLES_MAX)
+        return false;
+
+    // Takes effect from the next buffer swap on, a fade that is going on ends when it's disabled
+    layer_fade_cycles = cycles;
+    if (!cycles)
+        layer_fade_image = NULL;
+    return true;
+}
+
+enum layer_remap layer_get_remap(void)
+{
+#ifdef LAYER_REMAP
+    return layer_remap;
+#else
+    return LAYER_REMAP_NONE;
+#endif
+}
+
+bool layer_set_remap(enum layer_remap remap)
+{
+#ifdef LAYER_REMAP
+    if (remap > LAYER_REMAP_CUSTOM)
+        return false;
+
+    // The DMA interrupt packs the received frames with the table, so it's held off while the
+    // table is generated (some tens of microseconds) and the remap is switched, a frame is
+    // remapped either the old way or the new way. A row streamed in low latency mode meanwhile
+    // may mix both, until the next frame. Takes effect from the next frame on.
+    layer_hold_ingest();
+    for (unsigned int y = 0; y < LAYER_NUM_OF_ROWS && remap != LAYER_REMAP_CUSTOM; ++y) {
+        for (unsigned int x = 0; x < LAYER_NUM_OF_COLS; ++x) {
+            unsigned int last = LAYER_NUM_OF_COLS - 1;
+            unsigned int source_x = x;
+            unsigned int source_y = y;
+
+            switch (remap) {
+                case LAYER_REMAP_ROTATE_90:         source_x = y;           source_y = last - x;    break;
+                case LAYER_REMAP_ROTATE_180:        source_x = last - x;    source_y = last - y;    break;
+                case LAYER_REMAP_ROTATE_270:        source_x = last - y;    source_y = x;           break;
+                case LAYER_REMAP_MIRROR_X:          source_x = last - x;                            break;
+                case LAYER_REMAP_MIRROR_Y:                                  source_y = last - y;    break;
+                case LAYER_REMAP_TRANSPOSE:         source_x = y;           source_y = x;           break;
+                case LAYER_REMAP_ANTI_TRANSPOSE:    source_x = last - y;    source_y = last - x;    break;
+                default:                                                                            break;
+            }
+
+            layer_remap_table[LAYER_OFFSET(y) + x] = (unsigned char)(LAYER_OFFSET(source_y) + source_x);
+        }
+    }
+
+    layer_remap = remap;
+    layer_release_ingest();
+    return true;
+#else
+    return remap == LAYER_REMAP_NONE;
+#endif
+}
+
+bool layer_remap_write(unsigned int index, unsigned char const * sources, unsigned int count)
+{
+    ASSERT_NOT_NULL(sources);
+    if (sources == NULL)
+        return false;
+
+    if (index >= LAYER_NUM_OF_LEDS || count > LAYER_NUM_OF_LEDS - index)
+        return false;
+
+#ifdef LAYER_REMAP
+    // Every pixel of the layer is a valid source, as there are as many pixels as table entries.
+    // Held off from the DMA interrupt like layer_set_remap.
+    layer_hold_ingest();
+    memcpy(&layer_remap_table[index], sources, count);
+    layer_release_ingest();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void layer_get_settings(struct layer_settings * out)
+{
+    ASSERT_NOT_NULL(out);
+    if (out == NULL)
+        return;
+
+    memset(out, 0, sizeof(*out));
+    out->remap = layer_get_remap();
+    out->scan_rows = layer_scan_rows;
+    out->scan_order = layer_scan_order;
+#ifdef LAYER_REMAP
+    memcpy(out->remap_table, layer_remap_table, sizeof(out->remap_table));
+#endif
+    memcpy(out->row_map, layer_row_map, sizeof(out->row_map));
+}
+
+bool layer_load_settings(struct layer_settings const * settings)
+{
+    ASSERT_NOT_NULL(settings);
+    if (settings == NULL)
+        return false;
+
+    // The table is only used as is by the custom remap, the others generate it
+    if (settings->remap > LAYER_REMAP_CUSTOM)
+        return false;
+    if (!layer_set_geometry(settings->scan_rows, settings->scan_order))
+        return false;
+    if (!layer_row_map_write(0, settings->row_map, LAYER_NUM_OF_ROWS))
+        return false;
+    layer_row_map_loaded = true;
+#ifdef LAYER_REMAP
+    layer_hold_ingest(); // See layer_set_remap
+    memcpy(layer_remap_table, settings->remap_table, sizeof(layer_remap_table));
+    layer_release_ingest();
+#endif
+    return layer_set_remap(settings->remap);
+}
+
+void layer_get_geometry(unsigned int * rows, enum layer_scan_order * order)
+{
+    ASSERT_NOT_NULL(rows);
+    ASSERT_NOT_NULL(order);
+    if (rows == NULL || order == NULL)
+        return;
+
+    *rows = layer_scan_rows;
+    *order = layer_scan_order;
+}
+
+unsigned int layer_scan_period(void)
+{
+    return layer_scan_length * TLC5940_GSCLK_PERIOD;
+}
+
+bool layer_set_geometry(unsigned int rows, enum layer_scan_order order)
+{
+    if (rows == 0 || rows > LAYER_NUM_OF_ROWS || order > LAYER_SCAN_INTERLACED)
+        return false;
+
+    layer_scan_rows = rows;
+    layer_scan_order = order;
+    return true;
+}
+
+bool layer_row_map_write(unsigned int row, unsigned char const * pins, unsigned int count)
+{
+    ASSERT_NOT_NULL(pins);
+    if (pins == NULL)
+        return false;
+
+    if (row >= LAYER_NUM_OF_ROWS || count > LAYER_NUM_OF_ROWS - row)
+        return false;
+    for (unsigned int i = 0; i < count; ++i) {
+        if (pins[i] >= LAYER_NUM_OF_PINS)
+            return false;
+    }
+
+    memcpy(&layer_row_map[row], pins, count);
+    return true;
+}
+
+unsigned char * layer_canvas(void)
+{
+    // Low latency mode draws over the queued frames, and the 12 bit frames have another layout
+    if (layer_low_latency || layer_color_depth != LAYER_COLOR_DEPTH_8)
+        return NULL;
+
+    // The DMA interrupt decodes the frames, so it's held off while the last one is copied
+    if (layer_canvas_outdated) {
+        dma_mask_interrupt(layer_dma_channel);
+        memcpy(layer_canvas_frame, layer_frame, LAYER_FRAME_BUFFER_SIZE);
+        layer_canvas_outdated = false;
+        dma_unmask_interrupt(layer_dma_channel);
+    }
+    return layer_canvas_frame;
+}
+
+bool layer_canvas_commit(bool present)
+{
+    if (layer_canvas() == NULL)
+        return false;
+
+    // The DMA interrupt queues the received frames, so it's held off while the canvas is queued
+    struct frame_rows rows = { .first = 0, .count = LAYER_NUM_OF_ROWS - 1 };
+    unsigned int start = SYS_CORE_TICKS();
+    dma_mask_interrupt(layer_dma_channel);
+    bool queued = layer_queue_frame(layer_canvas_frame, rows, LAYER_TIMING_NONE, 0);
+    if (queued) {
+        layer_committed_frames++;
+        if (present)
+            layer_flags.do_buffer_swap = true;
+    }
+    layer_ingest_time(start);
+    dma_unmask_interrupt(layer_dma_channel);
+    return queued;
+}
+
+bool layer_set_overlay(unsigned char opacity, struct layer_color key)
+{
+#ifdef LAYER_OVERLAY
+    // Takes effect from the next packed frame on, so commit the overlay to show it right away
+    layer_overlay_key[LAYER_CHANNEL_RED] = swar_splat(key.r);
+    layer_overlay_key[LAYER_CHANNEL_GREEN] = swar_splat(key.g);
+    layer_overlay_key[LAYER_CHANNEL_BLUE] = swar_splat(key.b);
+    layer_overlay_weight = opacity + (opacity >> 7); // Fully opaque at 255
+    return true;
+#else
+    (void)key;
+    return !opacity;
+#endif
+}
+
+bool layer_set_draw_target(enum layer_draw_target target)
+{
+    switch (target) {
+        case LAYER_DRAW_CANVAS:
+#ifdef LAYER_OVERLAY
+        case LAYER_DRAW_OVERLAY:
+#endif
+            break;
+        default:
+            return false;
+    }
+
+#ifdef LAYER_OVERLAY
+    layer_draw_target = target;
+#endif
+    return true;
+}
+
+bool layer_overlay_commit(void)
+{
+#ifdef LAYER_OVERLAY
+    // The frame underneath is queued again, replacing a queued frame without timing. If the queue
+    // is empty that frame is being drawn, so it's presented right away. Also used to remove the
+    // overlay from the frame being drawn once it's disabled.
+    return layer_canvas_commit(layer_queue_empty());
+#else
+    return false;
+#endif
+}
+
+#ifdef LAYER_DRAW
+inline static unsigned char * __attribute__((always_inline)) layer_draw_buffer(void)
+{
+#ifdef LAYER_OVERLAY
+    if (layer_draw_target == LAYER_DRAW_OVERLAY)
+        return layer_overlay;
+#endif
+    return layer_canvas();
+}
+
+inline static bool __attribute__((always_inline)) layer_clip(
+    unsigned int x,
+    unsigned int y,
+    unsigned int * width,
+    unsigned int * height)
+{
+    if (x >= LAYER_NUM_OF_COLS || y >= LAYER_NUM_OF_ROWS || *width == 0 || *height == 0)
+        return false;
+
+    if (*width > LAYER_NUM_OF_COLS - x)
+        *width = LAYER_NUM_OF_COLS - x;
+    if (*height > LAYER_NUM_OF_ROWS - y)
+        *height = LAYER_NUM_OF_ROWS - y;
+    return true;
+}
+
+inline static void __attribute__((always_inline)) layer_fill_span(unsigned char * row, unsigned int x, unsigned int width, uint32_t fill)
+{
+    // Byte lanes of every word of the row that are in the span, only those words are written
+    static uint32_t const lane_masks[BIT(SWAR_LANES)] =
+    {
+        0x00000000, 0x000000ff, 0x0000ff00, 0x0000ffff, 0x00ff0000, 0x00ff00ff, 0x00ffff00, 0x00ffffff,
+        0xff000000, 0xff0000ff, 0xff00ff00, 0xff00ffff, 0xffff0000, 0xffff00ff, 0xffffff00, 0xffffffff,
+    };
+
+    swar_word_t * words = (swar_word_t *)row;
+    unsigned int lanes = (BIT(width) - 1) << x;
+    for (unsigned int i = 0; i < LAYER_NUM_OF_COLS / SWAR_LANES; ++i, lanes >>= SWAR_LANES) {
+        uint32_t mask = lane_masks[lanes & (BIT(SWAR_LANES) - 1)];
+        if (mask)
+            words[i] = (words[i] & ~mask) | (fill & mask);
+    }
+}
+
+static void layer_fill(
+    unsigned char * canvas,
+    unsigned int x,
+    unsigned int y,
+    unsigned int width,
+    unsigned int height,
+    struct layer_color color)
+{
+    unsigned char const values[LAYER_FRAME_DEPTH] = { color.r, color.g, color.b };
+
+    for (unsigned int channel = 0; channel < LAYER_FRAME_DEPTH; ++channel) {
+        uint32_t fill = swar_splat(values[channel]);
+        unsigned char * row = canvas + channel * LAYER_NUM_OF_LEDS + LAYER_OFFSET(y);
+        for (unsigned int i = 0; i < height; ++i, row += LAYER_NUM_OF_COLS)
+            layer_fill_span(row, x, width, fill);
+    }
+}
+
+bool layer_fill_rect(
+    unsigned int x,
+    unsigned int y,
+    unsigned int width,
+    unsigned int height,
+    struct layer_color color)
+{
+    unsigned char * canvas = layer_draw_buffer();
+    if (canvas == NULL)
+        return false;
+
+    if (layer_clip(x, y, &width, &height))
+        layer_fill(canvas, x, y, width, height, color);
+    return true;
+}
+
+bool layer_draw_line(unsigned int x, unsigned int y, unsigned int length, bool vertical, struct layer_color color)
+{
+    return vertical
+        ? layer_fill_rect(x, y, 1, length, color)
+        : layer_fill_rect(x, y, length, 1, color);
+}
+
+bool layer_fill_run(unsigned int index, unsigned int count, struct layer_color color)
+{
+    unsigned char * canvas = layer_draw_buffer();
+    if (canvas == NULL)
+        return false;
+
+    // Row by row, the run continues at the start of the next row
+    if (count > LAYER_NUM_OF_LEDS - index || index >= LAYER_NUM_OF_LEDS)
+        count = index < LAYER_NUM_OF_LEDS ? LAYER_NUM_OF_LEDS - index : 0;
+    while (count) {
+        unsigned int x = index % LAYER_NUM_OF_COLS;
+        unsigned int width = LAYER_NUM_OF_COLS - x;
+        if (width > count)
+            width = count;
+        layer_fill(canvas, x, index / LAYER_NUM_OF_COLS, width, 1, color);
+        index += width;
+        count -= width;
+    }
+    return true;
 }
 
+bool layer_fill_plane(enum layer_channel channel, unsigned char value)
+{
+    unsigned char * canvas = layer_draw_buffer();
+    if (canvas == NULL)
+        return false;
+    if (channel >= LAYER_FRAME_DEPTH)
+        return false;
+
+    swar_word_t * words = (swar_word_t *)(canvas + channel * LAYER_NUM_OF_LEDS);
+    uint32_t fill = swar_splat(value);
+    for (unsigned int i = 0; i < LAYER_NUM_OF_LEDS / SWAR_LANES; ++i)
+        words[i] = fill;
+    return true;
+}
+
+static void layer_copy(
+    unsigned char * canvas,
+    unsigned int x,
+    unsigned int y,
+    unsigned int width,
+    unsigned int height,
+    unsigned int dst_x,
+    unsigned int dst_y)
+{
+    // Rows are copied away from the destination, so overlapping rows are read before they're overwritten
+    int step = (dst_y > y) ? -LAYER_NUM_OF_COLS : LAYER_NUM_OF_COLS;
+    unsigned int first = (dst_y > y) ? height - 1 : 0;
+
+    for (unsigned int channel = 0; channel < LAYER_FRAME_DEPTH; ++channel) {
+        unsigned char * plane = canvas + channel * LAYER_NUM_OF_LEDS;
+        unsigned char const * src = plane + LAYER_OFFSET(y + first) + x;
+        unsigned char * dst = plane + LAYER_OFFSET(dst_y + first) + dst_x;
+        for (unsigned int i = 0; i < height; ++i, src += step, dst += step)
+            memmove(dst, src, width);
+    }
+}
+
+bool layer_copy_rect(
+    unsigned int x,
+    unsigned int y,
+    unsigned int width,
+    unsigned int height,
+    unsigned int dst_x,
+    unsigned int dst_y)
+{
+    unsigned char * canvas = layer_draw_buffer();
+    if (canvas == NULL)
+        return false;
+
+    if (layer_clip(x, y, &width, &height) && layer_clip(dst_x, dst_y, &width, &height))
+        layer_copy(canvas, x, y, width, height, dst_x, dst_y);
+    return true;
+}
+
+bool layer_scroll_rect(
+    unsigned int x,
+    unsigned int y,
+    unsigned int width,
+    unsigned int height,
+    int dx,
+    int dy,
+    struct layer_color fill)
+{
+    unsigned char * canvas = layer_draw_buffer();
+    if (canvas == NULL)
+        return false;
+    if (!layer_clip(x, y, &width, &height))
+        return true;
+
+    unsigned int shift_x = (dx < 0) ? -dx : dx;
+    unsigned int shift_y = (dy < 0) ? -dy : dy;
+    if (shift_x >= width || shift_y >= height) {
+        layer_fill(canvas, x, y, width, height, fill);
+        return true;
+    }
+
+    // Move what stays in the region, then fill the columns and rows that are uncovered
+    layer_copy(canvas,
+        dx < 0 ? x + shift_x : x,
+        dy < 0 ? y + shift_y : y,
+        width - shift_x,
+        height - shift_y,
+        dx > 0 ? x + shift_x : x,
+        dy > 0 ? y + shift_y : y);
+    if (shift_x)
+        layer_fill(canvas, dx > 0 ? x : x + width - shift_x, y, shift_x, height, fill);
+    if (shift_y)
+        layer_fill(canvas, x, dy > 0 ? y : y + height - shift_y, width, shift_y, fill);
+    return true;
+}
+#endif
+
 void layer_draw_pixel(unsigned char x, unsigned char y, struct layer_color color)
 {
     if (x >= LAYER_NUM_OF_COLS)
@@ -437,10 +1686,15 @@ void layer_draw_pixel(unsigned char x, unsigned char y, struct layer_color color
     if (y >= LAYER_NUM_OF_ROWS)
         y = LAYER_NUM_OF_ROWS - 1;
 
-    unsigned int pos = x + y * LAYER_NUM_OF_ROWS;
-    layer_draw_buffer[pos + LAYER_RED_OFFSET] = color.r;
-    layer_draw_buffer[pos + LAYER_GREEN_OFFSET] = color.g;
-    layer_draw_buffer[pos + LAYER_BLUE_OFFSET] = color.b;
+    unsigned char * image = layer_draw_image->rows[y];
+    tlc5940_pack(image, LAYER_RED_DEVICE, x, LAYER_LUT_ROUND(layer_lut[LAYER_CHANNEL_RED][color.r]));
+    tlc5940_pack(image, LAYER_GREEN_DEVICE, x, LAYER_LUT_ROUND(layer_lut[LAYER_CHANNEL_GREEN][color.g]));
+    tlc5940_pack(image, LAYER_BLUE_DEVICE, x, LAYER_LUT_ROUND(layer_lut[LAYER_CHANNEL_BLUE][color.b]));
+#ifdef LAYER_DITHER
+    dither_set_fraction(layer_draw_image->fractions[y], LAYER_RED_DEVICE * LAYER_NUM_OF_COLS + x, 0);
+    dither_set_fraction(layer_draw_image->fractions[y], LAYER_GREEN_DEVICE * LAYER_NUM_OF_COLS + x, 0);
+    dither_set_fraction(layer_draw_image->fractions[y], LAYER_BLUE_DEVICE * LAYER_NUM_OF_COLS + x, 0);
+#endif
 }
 
 void layer_draw_all_pixels(struct layer_color color)
@@ -456,4 +1710,8 @@ void layer_clear_all_pixels()
     // Just clear the whole buffer region so invoking buffer swap
     // after this function is called will not show old data
     memset(layer_buffer_pool, 0, sizeof(layer_buffer_pool));
+    memset(layer_image_pool, 0, sizeof(layer_image_pool));
+    layer_queue_tail = LAYER_QUEUE_NEXT(layer_draw_index); // Queued frames are gone as well
+    memset(layer_frame, 0, LAYER_FRAME_BUFFER_MAX_SIZE); // Also the reference of the delta encoding
+    layer_canvas_outdated = true;
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <core/kernel.h>
 #include <core/kernel_task.h>
 #include <core/bus_address.h>
+#include <core/nvm.h>
 
 int main(void)
 {
@@ -18,6 +19,7 @@ int main(void)
     // Initialize hardware
     dma_init();
     pwm_init();
+    nvm_init();
 
     // Then do the kernel init
     kernel_init();
@@ -0,0 +1,193 @@
+#ifdef SCENE_ENABLE
+#include <app/scene.h>
+#include <core/bus_address.h>
+#include <core/sys.h>
+#include <core/util.h>
+#include <core/assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#define SCENE_BUFFER_WORDS          (SCENE_NUM_OF_PRIMITIVES * SCENE_PRIMITIVE_WORDS)
+
+STATIC_ASSERT(sizeof(struct scene_primitive) == SCENE_PRIMITIVE_WORDS * sizeof(uint32_t))
+
+union scene_buffer
+{
+    uint32_t words[SCENE_BUFFER_WORDS];
+    struct scene_primitive primitives[SCENE_NUM_OF_PRIMITIVES];
+};
+
+static union scene_buffer scene_buffer;
+static unsigned int scene_cursor; // In words, only complete primitives are rendered
+static unsigned int scene_rendered_frames;
+static unsigned int scene_render_time_last;
+static unsigned int scene_render_time_max;
+
+inline static int __attribute__((always_inline)) scene_abs(int value)
+{
+    return (value < 0) ? -value : value;
+}
+
+inline static void __attribute__((always_inline)) scene_set_pixel(
+    unsigned char * frame,
+    unsigned int x,
+    unsigned int y,
+    struct scene_primitive const * primitive)
+{
+    unsigned int pos = y * LAYER_NUM_OF_COLS + x;
+    frame[pos + LAYER_RED_OFFSET] = primitive->r;
+    frame[pos + LAYER_GREEN_OFFSET] = primitive->g;
+    frame[pos + LAYER_BLUE_OFFSET] = primitive->b;
+}
+
+static void scene_render_sphere(unsigned char * frame, struct scene_primitive const * primitive, int z, bool shell)
+{
+    int cx = primitive->sphere.x;
+    int cy = primitive->sphere.y;
+    int r = primitive->sphere.radius;
+    int dz = z - primitive->sphere.z;
+
+    // The shell holds the pixels within half a pixel of the radius, compared at twice the scale
+    int outer = shell ? (2 * r + 1) * (2 * r + 1) : 4 * r * r;
+    int inner = shell ? (2 * r - 1) * (2 * r - 1) : -1;
+    if (r == 0)
+        inner = -1;
+
+    // Only the rows and columns of the bounding square in the slice
+    if (4 * dz * dz > outer)
+        return;
+    int y_start = (cy - r < 0) ? 0 : cy - r;
+    int y_end = (cy + r >= LAYER_NUM_OF_ROWS) ? LAYER_NUM_OF_ROWS - 1 : cy + r;
+    int x_start = (cx - r < 0) ? 0 : cx - r;
+    int x_end = (cx + r >= LAYER_NUM_OF_COLS) ? LAYER_NUM_OF_COLS - 1 : cx + r;
+
+    for (int y = y_start; y <= y_end; ++y) {
+        int dy = y - cy;
+        for (int x = x_start; x <= x_end; ++x) {
+            int dx = x - cx;
+            int distance = 4 * (dx * dx + dy * dy + dz * dz);
+            if (distance <= outer && distance > inner)
+                scene_set_pixel(frame, x, y, primitive);
+        }
+    }
+}
+
+static void scene_render_box(unsigned char * frame, struct scene_primitive const * primitive, int z)
+{
+    if (z < primitive->box.z0 || z > primitive->box.z1)
+        return;
+
+    unsigned int x_end = (primitive->box.x1 >= LAYER_NUM_OF_COLS) ? LAYER_NUM_OF_COLS - 1 : primitive->box.x1;
+    unsigned int y_end = (primitive->box.y1 >= LAYER_NUM_OF_ROWS) ? LAYER_NUM_OF_ROWS - 1 : primitive->box.y1;
+    if (primitive->box.x0 > x_end || primitive->box.y0 > y_end)
+        return;
+
+    // A span of every row of every plane
+    unsigned int width = x_end - primitive->box.x0 + 1;
+    for (unsigned int y = primitive->box.y0; y <= y_end; ++y) {
+        unsigned int pos = y * LAYER_NUM_OF_COLS + primitive->box.x0;
+        memset(frame + pos + LAYER_RED_OFFSET, primitive->r, width);
+        memset(frame + pos + LAYER_GREEN_OFFSET, primitive->g, width);
+        memset(frame + pos + LAYER_BLUE_OFFSET, primitive->b, width);
+    }
+}
+
+static void scene_render_plane(unsigned char * frame, struct scene_primitive const * primitive, int z)
+{
+    int nx = primitive->plane.nx;
+    int ny = primitive->plane.ny;
+    int nz = primitive->plane.nz;
+    int scale = scene_abs(nx);
+    if (scene_abs(ny) > scale)
+        scale = scene_abs(ny);
+    if (scene_abs(nz) > scale)
+        scale = scene_abs(nz);
+    if (scale == 0)
+        return;
+
+    // A pixel is on the plane if its distance along the largest component of the normal is
+    // less than half a pixel, compared at twice the scale. The distance is stepped along x.
+    int limit = scale * (2 * primitive->plane.thickness + 1);
+    int distance = 2 * (nz * z - primitive->plane.d);
+    for (int y = 0; y < LAYER_NUM_OF_ROWS; ++y, distance += 2 * ny) {
+        int value = distance;
+        for (int x = 0; x < LAYER_NUM_OF_COLS; ++x, value += 2 * nx) {
+            if (scene_abs(value) < limit)
+                scene_set_pixel(frame, x, y, primitive);
+        }
+    }
+}
+
+static void scene_render_point(unsigned char * frame, struct scene_primitive const * primitive, int z)
+{
+    if (z == primitive->point.z && primitive->point.x < LAYER_NUM_OF_COLS && primitive->point.y < LAYER_NUM_OF_ROWS)
+        scene_set_pixel(frame, primitive->point.x, primitive->point.y, primitive);
+}
+
+void scene_clear(void)
+{
+    scene_cursor = 0;
+}
+
+bool scene_push_word(unsigned int word)
+{
+    if (scene_cursor >= SCENE_BUFFER_WORDS)
+        return false;
+
+    scene_buffer.words[scene_cursor++] = word;
+    return true;
+}
+
+bool scene_commit(bool present)
+{
+    unsigned char * canvas = layer_canvas();
+    if (canvas == NULL)
+        return false;
+
+    unsigned int start = SYS_CORE_TICKS();
+    scene_render(canvas);
+    scene_render_time_last = SYS_CORE_TICKS_TO_US(SYS_CORE_TICKS() - start);
+    if (scene_render_time_last > scene_render_time_max)
+        scene_render_time_max = scene_render_time_last;
+
+    scene_rendered_frames++;
+    return layer_canvas_commit(present);
+}
+
+bool scene_stat(enum scene_stat stat, unsigned int * out)
+{
+    ASSERT_NOT_NULL(out);
+    if (out == NULL)
+        return false;
+
+    switch (stat) {
+        case SCENE_STAT_PRIMITIVES:         *out = scene_cursor / SCENE_PRIMITIVE_WORDS;    break;
+        case SCENE_STAT_RENDERED_FRAMES:    *out = scene_rendered_frames;                   break;
+        case SCENE_STAT_RENDER_TIME_LAST:   *out = scene_render_time_last;                  break;
+        case SCENE_STAT_RENDER_TIME_MAX:    *out = scene_render_time_max;                   break;
+        default:                                                                            return false;
+    }
+
+    return true;
+}
+
+void scene_render(unsigned char * frame)
+{
+    int z = bus_address_get(); // The layers of the cube are slices of the scene
+    unsigned int count = scene_cursor / SCENE_PRIMITIVE_WORDS;
+
+    memset(frame, 0, LAYER_FRAME_BUFFER_SIZE);
+    for (unsigned int i = 0; i < count; ++i) {
+        struct scene_primitive const * primitive = &scene_buffer.primitives[i];
+
+        switch (primitive->type) {
+            case SCENE_SPHERE:  scene_render_sphere(frame, primitive, z, false);    break;
+            case SCENE_SHELL:   scene_render_sphere(frame, primitive, z, true);     break;
+            case SCENE_BOX:     scene_render_box(frame, primitive, z);              break;
+            case SCENE_PLANE:   scene_render_plane(frame, primitive, z);            break;
+            case SCENE_POINT:   scene_render_point(frame, primitive, z);            break;
+            default:                                                                break;
+        }
+    }
+}
+#endif
@@ -0,0 +1,134 @@
+#include <app/settings.h>
+#include <core/kernel_task.h>
+#include <core/nvm.h>
+#include <core/bus.h>
+#include <core/util.h>
+#include <core/assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#define SETTINGS_HEADER_SIZE        sizeof(struct settings_header)
+#define SETTINGS_SIZE               sizeof(struct settings)
+#define SETTINGS_PAGE               ((nvm_byte_t const *)KSEG1_ADDR(settings_page))
+
+STATIC_ASSERT(SETTINGS_HEADER_SIZE + SETTINGS_SIZE <= NVM_ROW_SIZE) // Written as a single row
+
+enum settings_state
+{
+    SETTINGS_IDLE = 0,
+
+    SETTINGS_ERASE_PAGE,
+    SETTINGS_BURN_ROW,
+
+    SETTINGS_ERROR,
+};
+
+static int settings_rtask_init(void);
+static void settings_rtask_execute(void);
+KERN_RTASK(settings, settings_rtask_init, settings_rtask_execute, NULL, KERN_INIT_CORE) // Loaded before the layer is initialized
+
+static NVM_PAGE(settings_page);
+
+static enum settings_state settings_state = SETTINGS_IDLE;
+static bool settings_burn; // Set if the row is written once the page is erased
+
+static int settings_rtask_init(void)
+{
+    struct settings_header header;
+    struct settings settings;
+    crc16_t crc;
+
+    memcpy(&header, SETTINGS_PAGE, SETTINGS_HEADER_SIZE);
+    memcpy(&settings, SETTINGS_PAGE + SETTINGS_HEADER_SIZE, SETTINGS_SIZE);
+    crc16_reset(&crc);
+    crc16_update(&crc, &settings, SETTINGS_SIZE);
+
+    // Not being able to load the settings is not fatal, the defaults are used instead
+    if (header.magic == SETTINGS_MAGIC && header.size == SETTINGS_SIZE && header.crc == crc)
+        layer_load_settings(&settings.layer);
+    return KERN_INIT_SUCCESS;
+}
+
+static void settings_rtask_execute(void)
+{
+    switch (settings_state) {
+        default:
+        case SETTINGS_IDLE:
+            break;
+
+        case SETTINGS_ERASE_PAGE:
+            if (bus_idle()) { // Since erasing a page is a blocking operation
+                if (!nvm_erase_page_virt(settings_page)) {
+                    nvm_buffer_release(&settings_state);
+                    settings_state = SETTINGS_ERROR;
+                } else {
+                    settings_state = settings_burn ? SETTINGS_BURN_ROW : SETTINGS_IDLE;
+                }
+            }
+            break;
+        case SETTINGS_BURN_ROW:
+            if (bus_idle()) {
+                // Sealed right away, the bootloader wouldn't run the app with the row written alone
+                bool ok = nvm_write_row_virt(settings_page) && nvm_seal_page_virt(settings_page);
+                // Note buffer is automatically cleared after a successful write
+                nvm_buffer_release(&settings_state);
+                settings_state = ok ? SETTINGS_IDLE : SETTINGS_ERROR;
+            }
+            break;
+
+        case SETTINGS_ERROR:
+            // Do nothing until saved or erased again
+            break;
+    }
+}
+
+bool settings_busy(void)
+{
+    return settings_state != SETTINGS_IDLE;
+}
+
+bool settings_ready(void)
+{
+    return !settings_busy();
+}
+
+bool settings_error(void)
+{
+    return settings_state == SETTINGS_ERROR;
+}
+
+bool settings_save(void)
+{
+    if (settings_busy() && !settings_error())
+        return false;
+    if (!nvm_buffer_acquire(&settings_state)) // E.g. an animation row is being uploaded
+        return false;
+
+    struct settings_header header = { .magic = SETTINGS_MAGIC, .size = SETTINGS_SIZE };
+    struct settings settings;
+    crc16_t crc;
+
+    layer_get_settings(&settings.layer);
+    crc16_reset(&crc);
+    crc16_update(&crc, &settings, SETTINGS_SIZE);
+    header.crc = crc;
+
+    // The rest of the row stays erased
+    nvm_buffer_reset();
+    memcpy(nvm_row_buffer, &header, SETTINGS_HEADER_SIZE);
+    memcpy((nvm_byte_t *)nvm_row_buffer + SETTINGS_HEADER_SIZE, &settings, SETTINGS_SIZE);
+
+    settings_burn = true;
+    settings_state = SETTINGS_ERASE_PAGE;
+    return true;
+}
+
+bool settings_erase(void)
+{
+    if (settings_busy() && !settings_error())
+        return false;
+
+    settings_burn = false;
+    settings_state = SETTINGS_ERASE_PAGE;
+    return true;
+}
@@ -0,0 +1,228 @@
+#ifdef SPRITE_ENABLE
+#include <app/sprite.h>
+#include <app/swar.h>
+#include <core/sys.h>
+#include <core/util.h>
+#include <core/assert.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define SPRITE_POOL_WORDS           (SPRITE_NUM_OF_TILES * SPRITE_TILE_WORDS)
+#define SPRITE_MAP_SIZE             (SPRITE_MAP_COLS * SPRITE_MAP_ROWS)
+#define SPRITE_INDEX_BITS           4
+#define SPRITE_INDEX_MASK           (SPRITE_NUM_OF_COLORS - 1)
+#define SPRITE_ROW_BITS             (SPRITE_TILE_SIZE * SPRITE_INDEX_BITS)
+#define SPRITE_ROW_MASK             (BIT(SPRITE_ROW_BITS) - 1)
+#define SPRITE_TRANSPARENT          0
+
+STATIC_ASSERT(SPRITE_TILE_SIZE == SWAR_LANES) // A row of a tile is a word of every plane
+STATIC_ASSERT(SPRITE_TILE_WORDS * 32 == SPRITE_TILE_SIZE * SPRITE_ROW_BITS)
+STATIC_ASSERT(SPRITE_NUM_OF_COLORS == BIT(SPRITE_INDEX_BITS))
+STATIC_ASSERT(LAYER_NUM_OF_COLS % SPRITE_TILE_SIZE == 0 && LAYER_NUM_OF_ROWS % SPRITE_TILE_SIZE == 0)
+STATIC_ASSERT(SPRITE_NUM_OF_TILES <= 256) // Indices of the tile map are bytes
+
+struct sprite
+{
+    int x;
+    int y;
+    unsigned char tile; // First tile
+    unsigned char width; // In tiles, 0 if hidden
+    unsigned char height;
+    unsigned char priority;
+};
+
+static uint32_t sprite_tiles[SPRITE_POOL_WORDS]; // 512 bytes for 64 tiles
+static unsigned char sprite_palette[LAYER_FRAME_DEPTH][SPRITE_NUM_OF_COLORS]; // Planar, just like the canvas
+static unsigned char sprite_map[SPRITE_MAP_SIZE];
+static struct sprite sprite_table[SPRITE_NUM_OF_SPRITES];
+static unsigned char sprite_order[SPRITE_NUM_OF_SPRITES]; // By priority, the lowest first, sorted whenever a sprite is set
+static unsigned int sprite_tile_cursor; // In words
+static unsigned int sprite_composed_frames;
+static unsigned int sprite_compose_time_last;
+static unsigned int sprite_compose_time_max;
+
+inline static unsigned int __attribute__((always_inline)) sprite_tile_row(unsigned int tile, unsigned int row)
+{
+    // Two rows per word, the first row in the low half
+    unsigned int word = tile * SPRITE_TILE_WORDS + row / 2;
+    return (sprite_tiles[word] >> ((row % 2) * SPRITE_ROW_BITS)) & SPRITE_ROW_MASK;
+}
+
+static void sprite_render_background(unsigned char * frame)
+{
+    // Every row of a tile is a whole word of every plane
+    for (unsigned int cell = 0; cell < SPRITE_MAP_SIZE; ++cell) {
+        unsigned int tile = sprite_map[cell];
+        unsigned int offset = (cell / SPRITE_MAP_COLS) * SPRITE_TILE_SIZE * LAYER_NUM_OF_COLS
+            + (cell % SPRITE_MAP_COLS) * SPRITE_TILE_SIZE;
+
+        for (unsigned int row = 0; row < SPRITE_TILE_SIZE; ++row, offset += LAYER_NUM_OF_COLS) {
+            unsigned int pixels = sprite_tile_row(tile, row);
+            for (unsigned int channel = 0; channel < LAYER_FRAME_DEPTH; ++channel) {
+                unsigned char const * palette = sprite_palette[channel];
+                *(swar_word_t *)(frame + channel * LAYER_NUM_OF_LEDS + offset) =
+                    (uint32_t)palette[pixels & SPRITE_INDEX_MASK]
+                    | (uint32_t)palette[(pixels >> 4) & SPRITE_INDEX_MASK] << 8
+                    | (uint32_t)palette[(pixels >> 8) & SPRITE_INDEX_MASK] << 16
+                    | (uint32_t)palette[(pixels >> 12) & SPRITE_INDEX_MASK] << 24;
+            }
+        }
+    }
+}
+
+static void sprite_render_sprite(unsigned char * frame, struct sprite const * sprite)
+{
+    // Clip to the layer once, instead of checking every pixel
+    int width = sprite->width * SPRITE_TILE_SIZE;
+    int height = sprite->height * SPRITE_TILE_SIZE;
+    int x_start = (sprite->x < 0) ? -sprite->x : 0;
+    int y_start = (sprite->y < 0) ? -sprite->y : 0;
+    int x_end = (sprite->x + width > LAYER_NUM_OF_COLS) ? LAYER_NUM_OF_COLS - sprite->x : width;
+    int y_end = (sprite->y + height > LAYER_NUM_OF_ROWS) ? LAYER_NUM_OF_ROWS - sprite->y : height;
+
+    for (int y = y_start; y < y_end; ++y) {
+        unsigned int tiles = sprite->tile + (y / SPRITE_TILE_SIZE) * sprite->width;
+        unsigned char * row = frame + (sprite->y + y) * LAYER_NUM_OF_COLS;
+
+        for (int x = x_start; x < x_end; ++x) {
+            unsigned int pixels = sprite_tile_row(tiles + x / SPRITE_TILE_SIZE, y % SPRITE_TILE_SIZE);
+            unsigned int index = (pixels >> ((x % SPRITE_TILE_SIZE) * SPRITE_INDEX_BITS)) & SPRITE_INDEX_MASK;
+            if (index == SPRITE_TRANSPARENT)
+                continue;
+
+            unsigned int col = sprite->x + x;
+            row[col + LAYER_RED_OFFSET] = sprite_palette[LAYER_CHANNEL_RED][index];
+            row[col + LAYER_GREEN_OFFSET] = sprite_palette[LAYER_CHANNEL_GREEN][index];
+            row[col + LAYER_BLUE_OFFSET] = sprite_palette[LAYER_CHANNEL_BLUE][index];
+        }
+    }
+}
+
+static void sprite_sort(void)
+{
+    // Insertion sort, which keeps sprites of the same priority in the order of their index
+    for (unsigned int i = 0; i < SPRITE_NUM_OF_SPRITES; ++i)
+        sprite_order[i] = i;
+    for (unsigned int i = 1; i < SPRITE_NUM_OF_SPRITES; ++i) {
+        unsigned char sprite = sprite_order[i];
+        unsigned int j = i;
+        for (; j > 0 && sprite_table[sprite_order[j - 1]].priority > sprite_table[sprite].priority; --j)
+            sprite_order[j] = sprite_order[j - 1];
+        sprite_order[j] = sprite;
+    }
+}
+
+void sprite_reset(void)
+{
+    memset(sprite_map, 0, sizeof(sprite_map));
+    memset(sprite_table, 0, sizeof(sprite_table));
+    sprite_sort();
+}
+
+bool sprite_set_color(unsigned int index, struct layer_color color)
+{
+    if (index >= SPRITE_NUM_OF_COLORS)
+        return false;
+
+    sprite_palette[LAYER_CHANNEL_RED][index] = color.r;
+    sprite_palette[LAYER_CHANNEL_GREEN][index] = color.g;
+    sprite_palette[LAYER_CHANNEL_BLUE][index] = color.b;
+    return true;
+}
+
+bool sprite_tile_address(unsigned int address)
+{
+    if (address >= SPRITE_POOL_WORDS)
+        return false;
+
+    sprite_tile_cursor = address;
+    return true;
+}
+
+bool sprite_tile_push_word(unsigned int word)
+{
+    if (sprite_tile_cursor >= SPRITE_POOL_WORDS)
+        return false;
+
+    sprite_tiles[sprite_tile_cursor++] = word;
+    return true;
+}
+
+bool sprite_map_set(unsigned int cell, unsigned int tile)
+{
+    if (cell >= SPRITE_MAP_SIZE || tile >= SPRITE_NUM_OF_TILES)
+        return false;
+
+    sprite_map[cell] = tile;
+    return true;
+}
+
+bool sprite_set(unsigned int sprite, unsigned int tile, unsigned int width, unsigned int height, unsigned char priority)
+{
+    if (sprite >= SPRITE_NUM_OF_SPRITES || width > SPRITE_SIZE_MAX || height > SPRITE_SIZE_MAX)
+        return false;
+    if (tile + width * height > SPRITE_NUM_OF_TILES)
+        return false;
+
+    struct sprite * entry = &sprite_table[sprite];
+    entry->tile = tile;
+    entry->width = width && height ? width : 0;
+    entry->height = height;
+    entry->priority = priority;
+    sprite_sort();
+    return true;
+}
+
+bool sprite_move(unsigned int sprite, int x, int y)
+{
+    if (sprite >= SPRITE_NUM_OF_SPRITES)
+        return false;
+
+    sprite_table[sprite].x = x;
+    sprite_table[sprite].y = y;
+    return true;
+}
+
+bool sprite_compose(bool present)
+{
+    unsigned char * canvas = layer_canvas();
+    if (canvas == NULL)
+        return false;
+
+    unsigned int start = SYS_CORE_TICKS();
+    sprite_render(canvas);
+    sprite_compose_time_last = SYS_CORE_TICKS_TO_US(SYS_CORE_TICKS() - start);
+    if (sprite_compose_time_last > sprite_compose_time_max)
+        sprite_compose_time_max = sprite_compose_time_last;
+
+    sprite_composed_frames++;
+    return layer_canvas_commit(present);
+}
+
+bool sprite_stat(enum sprite_stat stat, unsigned int * out)
+{
+    ASSERT_NOT_NULL(out);
+    if (out == NULL)
+        return false;
+
+    switch (stat) {
+        case SPRITE_STAT_COMPOSED_FRAMES:   *out = sprite_composed_frames;      break;
+        case SPRITE_STAT_COMPOSE_TIME_LAST: *out = sprite_compose_time_last;    break;
+        case SPRITE_STAT_COMPOSE_TIME_MAX:  *out = sprite_compose_time_max;     break;
+        default:                                                                return false;
+    }
+
+    return true;
+}
+
+void sprite_render(unsigned char * frame)
+{
+    sprite_render_background(frame);
+    for (unsigned int i = 0; i < SPRITE_NUM_OF_SPRITES; ++i) {
+        struct sprite const * sprite = &sprite_table[sprite_order[i]];
+        if (sprite->width)
+            sprite_render_sprite(frame, sprite);
+    }
+}
+#endif
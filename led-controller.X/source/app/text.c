@@ -0,0 +1,286 @@
+#ifdef TEXT_ENABLE
+#include <app/text.h>
+#include <app/clock.h>
+#include <app/layer_config.h>
+#include <core/kernel_task.h>
+#include <core/sys.h>
+#include <core/util.h>
+#include <core/assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#define TEXT_FONT_FIRST             ' '
+#define TEXT_FONT_LAST              '~'
+#define TEXT_FONT_WIDTH             5
+#define TEXT_FONT_HEIGHT            7
+#define TEXT_FONT_FALLBACK          '?' // Shown for the characters that aren't in the font
+#define TEXT_GLYPH_WIDTH            (TEXT_FONT_WIDTH + 1) // Including the spacing column
+#define TEXT_FOREGROUND             0
+#define TEXT_BACKGROUND             1
+#define TEXT_NO_STEP                (~0ULL)
+#define TEXT_STATIC_STEP            (LAYER_NUM_OF_COLS - 1) // First column of the text on the left edge
+
+static void text_rtask_execute(void);
+KERN_SIMPLE_RTASK(text, NULL, text_rtask_execute)
+
+// Columns of every glyph from left to right, the least significant bit is the top row
+static const unsigned char text_font[TEXT_FONT_LAST - TEXT_FONT_FIRST + 1][TEXT_FONT_WIDTH] =
+{
+    { 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+    { 0x00, 0x00, 0x5f, 0x00, 0x00 }, // '!'
+    { 0x00, 0x07, 0x00, 0x07, 0x00 }, // '"'
+    { 0x14, 0x7f, 0x14, 0x7f, 0x14 }, // '#'
+    { 0x24, 0x2a, 0x7f, 0x2a, 0x12 }, // '$'
+    { 0x23, 0x13, 0x08, 0x64, 0x62 }, // '%'
+    { 0x36, 0x49, 0x55, 0x22, 0x50 }, // '&'
+    { 0x00, 0x05, 0x03, 0x00, 0x00 }, // '''
+    { 0x00, 0x1c, 0x22, 0x41, 0x00 }, // '('
+    { 0x00, 0x41, 0x22, 0x1c, 0x00 }, // ')'
+    { 0x08, 0x2a, 0x1c, 0x2a, 0x08 }, // '*'
+    { 0x08, 0x08, 0x3e, 0x08, 0x08 }, // '+'
+    { 0x00, 0x50, 0x30, 0x00, 0x00 }, // ','
+    { 0x08, 0x08, 0x08, 0x08, 0x08 }, // '-'
+    { 0x00, 0x60, 0x60, 0x00, 0x00 }, // '.'
+    { 0x20, 0x10, 0x08, 0x04, 0x02 }, // '/'
+    { 0x3e, 0x51, 0x49, 0x45, 0x3e }, // '0'
+    { 0x00, 0x42, 0x7f, 0x40, 0x00 }, // '1'
+    { 0x42, 0x61, 0x51, 0x49, 0x46 }, // '2'
+    { 0x21, 0x41, 0x45, 0x4b, 0x31 }, // '3'
+    { 0x18, 0x14, 0x12, 0x7f, 0x10 }, // '4'
+    { 0x27, 0x45, 0x45, 0x45, 0x39 }, // '5'
+    { 0x3c, 0x4a, 0x49, 0x49, 0x30 }, // '6'
+    { 0x01, 0x71, 0x09, 0x05, 0x03 }, // '7'
+    { 0x36, 0x49, 0x49, 0x49, 0x36 }, // '8'
+    { 0x06, 0x49, 0x49, 0x29, 0x1e }, // '9'
+    { 0x00, 0x36, 0x36, 0x00, 0x00 }, // ':'
+    { 0x00, 0x56, 0x36, 0x00, 0x00 }, // ';'
+    { 0x08, 0x14, 0x22, 0x41, 0x00 }, // '<'
+    { 0x14, 0x14, 0x14, 0x14, 0x14 }, // '='
+    { 0x00, 0x41, 0x22, 0x14, 0x08 }, // '>'
+    { 0x02, 0x01, 0x51, 0x09, 0x06 }, // '?'
+    { 0x32, 0x49, 0x79, 0x41, 0x3e }, // '@'
+    { 0x7e, 0x11, 0x11, 0x11, 0x7e }, // 'A'
+    { 0x7f, 0x49, 0x49, 0x49, 0x36 }, // 'B'
+    { 0x3e, 0x41, 0x41, 0x41, 0x22 }, // 'C'
+    { 0x7f, 0x41, 0x41, 0x22, 0x1c }, // 'D'
+    { 0x7f, 0x49, 0x49, 0x49, 0x41 }, // 'E'
+    { 0x7f, 0x09, 0x09, 0x09, 0x01 }, // 'F'
+    { 0x3e, 0x41, 0x49, 0x49, 0x7a }, // 'G'
+    { 0x7f, 0x08, 0x08, 0x08, 0x7f }, // 'H'
+    { 0x00, 0x41, 0x7f, 0x41, 0x00 }, // 'I'
+    { 0x20, 0x40, 0x41, 0x3f, 0x01 }, // 'J'
+    { 0x7f, 0x08, 0x14, 0x22, 0x41 }, // 'K'
+    { 0x7f, 0x40, 0x40, 0x40, 0x40 }, // 'L'
+    { 0x7f, 0x02, 0x0c, 0x02, 0x7f }, // 'M'
+    { 0x7f, 0x04, 0x08, 0x10, 0x7f }, // 'N'
+    { 0x3e, 0x41, 0x41, 0x41, 0x3e }, // 'O'
+    { 0x7f, 0x09, 0x09, 0x09, 0x06 }, // 'P'
+    { 0x3e, 0x41, 0x51, 0x21, 0x5e }, // 'Q'
+    { 0x7f, 0x09, 0x19, 0x29, 0x46 }, // 'R'
+    { 0x46, 0x49, 0x49, 0x49, 0x31 }, // 'S'
+    { 0x01, 0x01, 0x7f, 0x01, 0x01 }, // 'T'
+    { 0x3f, 0x40, 0x40, 0x40, 0x3f }, // 'U'
+    { 0x1f, 0x20, 0x40, 0x20, 0x1f }, // 'V'
+    { 0x3f, 0x40, 0x38, 0x40, 0x3f }, // 'W'
+    { 0x63, 0x14, 0x08, 0x14, 0x63 }, // 'X'
+    { 0x07, 0x08, 0x70, 0x08, 0x07 }, // 'Y'
+    { 0x61, 0x51, 0x49, 0x45, 0x43 }, // 'Z'
+    { 0x00, 0x7f, 0x41, 0x41, 0x00 }, // '['
+    { 0x02, 0x04, 0x08, 0x10, 0x20 }, // '\'
+    { 0x00, 0x41, 0x41, 0x7f, 0x00 }, // ']'
+    { 0x04, 0x02, 0x01, 0x02, 0x04 }, // '^'
+    { 0x40, 0x40, 0x40, 0x40, 0x40 }, // '_'
+    { 0x00, 0x01, 0x02, 0x04, 0x00 }, // '`'
+    { 0x20, 0x54, 0x54, 0x54, 0x78 }, // 'a'
+    { 0x7f, 0x48, 0x44, 0x44, 0x38 }, // 'b'
+    { 0x38, 0x44, 0x44, 0x44, 0x20 }, // 'c'
+    { 0x38, 0x44, 0x44, 0x48, 0x7f }, // 'd'
+    { 0x38, 0x54, 0x54, 0x54, 0x18 }, // 'e'
+    { 0x08, 0x7e, 0x09, 0x01, 0x02 }, // 'f'
+    { 0x0c, 0x52, 0x52, 0x52, 0x3e }, // 'g'
+    { 0x7f, 0x08, 0x04, 0x04, 0x78 }, // 'h'
+    { 0x00, 0x44, 0x7d, 0x40, 0x00 }, // 'i'
+    { 0x20, 0x40, 0x44, 0x3d, 0x00 }, // 'j'
+    { 0x7f, 0x10, 0x28, 0x44, 0x00 }, // 'k'
+    { 0x00, 0x41, 0x7f, 0x40, 0x00 }, // 'l'
+    { 0x7c, 0x04, 0x18, 0x04, 0x78 }, // 'm'
+    { 0x7c, 0x08, 0x04, 0x04, 0x78 }, // 'n'
+    { 0x38, 0x44, 0x44, 0x44, 0x38 }, // 'o'
+    { 0x7c, 0x14, 0x14, 0x14, 0x08 }, // 'p'
+    { 0x08, 0x14, 0x14, 0x18, 0x7c }, // 'q'
+    { 0x7c, 0x08, 0x04, 0x04, 0x08 }, // 'r'
+    { 0x48, 0x54, 0x54, 0x54, 0x20 }, // 's'
+    { 0x04, 0x3f, 0x44, 0x40, 0x20 }, // 't'
+    { 0x3c, 0x40, 0x40, 0x20, 0x7c }, // 'u'
+    { 0x1c, 0x20, 0x40, 0x20, 0x1c }, // 'v'
+    { 0x3c, 0x40, 0x30, 0x40, 0x3c }, // 'w'
+    { 0x44, 0x28, 0x10, 0x28, 0x44 }, // 'x'
+    { 0x0c, 0x50, 0x50, 0x50, 0x3c }, // 'y'
+    { 0x44, 0x64, 0x54, 0x4c, 0x44 }, // 'z'
+    { 0x00, 0x08, 0x36, 0x41, 0x00 }, // '{'
+    { 0x00, 0x00, 0x7f, 0x00, 0x00 }, // '|'
+    { 0x00, 0x41, 0x36, 0x08, 0x00 }, // '}'
+    { 0x02, 0x01, 0x02, 0x04, 0x02 }, // '~'
+};
+
+static char text_buffer[TEXT_LENGTH_MAX];
+static unsigned int text_length;
+static struct layer_color text_colors[TEXT_NUM_OF_COLORS] =
+{
+    [TEXT_FOREGROUND] = { 255, 255, 255 },
+    [TEXT_BACKGROUND] = { 0, 0, 0 },
+};
+static bool text_is_running;
+static unsigned int text_row; // First row of the band
+static unsigned int text_height; // Of the band, the font is clipped at the bottom of the layer
+static unsigned int text_speed;
+static unsigned long long text_start_time; // In microseconds of cube time
+static unsigned long long text_shown_step; // Columns scrolled when the canvas was rendered
+static unsigned int text_rendered_columns;
+static unsigned int text_skipped_steps;
+static unsigned int text_render_time_max;
+
+static unsigned char text_column(unsigned long long position)
+{
+    // Position in the text followed by the gap, which repeats
+    unsigned int width = text_length * TEXT_GLYPH_WIDTH;
+    unsigned int column = position % (width + LAYER_NUM_OF_COLS);
+    if (column >= width || column % TEXT_GLYPH_WIDTH == TEXT_FONT_WIDTH)
+        return 0;
+
+    unsigned char c = text_buffer[column / TEXT_GLYPH_WIDTH];
+    if (c < TEXT_FONT_FIRST || c > TEXT_FONT_LAST)
+        c = TEXT_FONT_FALLBACK;
+    return text_font[c - TEXT_FONT_FIRST][column % TEXT_GLYPH_WIDTH];
+}
+
+static void text_render_column(unsigned char * canvas, unsigned int x, unsigned char bits)
+{
+    unsigned int pos = text_row * LAYER_NUM_OF_COLS + x;
+
+    for (unsigned int y = 0; y < text_height; ++y, bits >>= 1, pos += LAYER_NUM_OF_COLS) {
+        struct layer_color const * color = &text_colors[(bits & 1) ? TEXT_FOREGROUND : TEXT_BACKGROUND];
+        canvas[pos + LAYER_RED_OFFSET] = color->r;
+        canvas[pos + LAYER_GREEN_OFFSET] = color->g;
+        canvas[pos + LAYER_BLUE_OFFSET] = color->b;
+    }
+}
+
+static void text_rtask_execute(void)
+{
+    if (!text_is_running)
+        return;
+
+    long long elapsed = (long long)(clock_get_time() - text_start_time);
+    unsigned long long step = text_speed
+        ? (unsigned long long)(elapsed > 0 ? elapsed : 0) * text_speed / 1000000LLU
+        : TEXT_STATIC_STEP;
+    if (step == text_shown_step)
+        return;
+
+    // Retried on the next run, as the scroll position doesn't depend on when we're rendering
+    unsigned char * canvas = layer_canvas();
+    if (canvas == NULL)
+        return;
+
+    // Only the columns that scrolled in are rendered, the rest of the band is moved over. The
+    // whole band is rendered after a jump, when a clock sync moved the cube time back, or on
+    // every step without the drawing primitives.
+    unsigned int start = SYS_CORE_TICKS();
+    unsigned int first = 0;
+    if (text_shown_step != TEXT_NO_STEP && step > text_shown_step) {
+        unsigned long long shift = step - text_shown_step;
+        text_skipped_steps += (unsigned int)(shift - 1);
+#ifdef LAYER_DRAW
+        if (shift < LAYER_NUM_OF_COLS) {
+            layer_scroll_rect(0, text_row, LAYER_NUM_OF_COLS, text_height, -(int)shift, 0, text_colors[TEXT_BACKGROUND]);
+            first = LAYER_NUM_OF_COLS - shift;
+        }
+#endif
+    }
+
+    // Column x shows the text at position step - (LAYER_NUM_OF_COLS - 1) + x, offset by a
+    // whole repetition of the text so the positions left of the first column aren't negative
+    unsigned long long offset = step + text_length * TEXT_GLYPH_WIDTH + 1;
+    for (unsigned int x = first; x < LAYER_NUM_OF_COLS; ++x)
+        text_render_column(canvas, x, text_column(offset + x));
+    text_rendered_columns += LAYER_NUM_OF_COLS - first;
+
+    unsigned int render_time = SYS_CORE_TICKS_TO_US(SYS_CORE_TICKS() - start);
+    if (render_time > text_render_time_max)
+        text_render_time_max = render_time;
+
+    layer_canvas_commit(true);
+    text_shown_step = step;
+}
+
+void text_clear(void)
+{
+    text_stop();
+    text_length = 0;
+}
+
+bool text_append(char const * text, unsigned int length)
+{
+    ASSERT_NOT_NULL(text);
+    if (text == NULL)
+        return false;
+    if (length > TEXT_LENGTH_MAX - text_length)
+        return false;
+
+    memcpy(&text_buffer[text_length], text, length);
+    text_length += length;
+    return true;
+}
+
+bool text_set_color(unsigned int index, struct layer_color color)
+{
+    if (index >= TEXT_NUM_OF_COLORS)
+        return false;
+
+    text_colors[index] = color;
+    text_shown_step = TEXT_NO_STEP; // Render the whole band again
+    return true;
+}
+
+bool text_start(unsigned int row, unsigned int speed)
+{
+    if (row >= LAYER_NUM_OF_ROWS)
+        return false;
+
+    text_row = row;
+    text_height = (row + TEXT_FONT_HEIGHT > LAYER_NUM_OF_ROWS) ? LAYER_NUM_OF_ROWS - row : TEXT_FONT_HEIGHT;
+    text_speed = speed;
+    text_start_time = clock_get_time();
+    text_shown_step = TEXT_NO_STEP;
+    text_is_running = true;
+    return true;
+}
+
+void text_stop(void)
+{
+    // The last frame is kept
+    text_is_running = false;
+}
+
+bool text_running(void)
+{
+    return text_is_running;
+}
+
+bool text_stat(enum text_stat stat, unsigned int * out)
+{
+    ASSERT_NOT_NULL(out);
+    if (out == NULL)
+        return false;
+
+    switch (stat) {
+        case TEXT_STAT_RENDERED_COLUMNS:    *out = text_rendered_columns;   break;
+        case TEXT_STAT_SKIPPED_STEPS:       *out = text_skipped_steps;      break;
+        case TEXT_STAT_RENDER_TIME_MAX:     *out = text_render_time_max;    break;
+        default:                                                            return false;
+    }
+
+    return true;
+}
+#endif
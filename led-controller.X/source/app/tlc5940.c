@@ -33,7 +33,7 @@ STATIC_ASSERT(TLC5940_GSCLK_PERIOD >= 450 && TLC5940_GSCLK_PERIOD <= 50000) // L
 STATIC_ASSERT(TLC5940_DOT_CORRECTION <= 28)
 
 #define TLC5940_CHANNELS_PER_DEVICE     16
-#define TLC5940_BUFFER_SIZE             (24 * TLC5940_NUM_OF_DEVICES)
+#define TLC5940_BUFFER_SIZE             TLC5940_IMAGE_SIZE
 #define TLC5940_BUFFER_SIZE_DOT_CORR    (12 * TLC5940_NUM_OF_DEVICES)
 #define TLC5940_NUM_OF_CHANNELS         (TLC5940_CHANNELS_PER_DEVICE * TLC5940_NUM_OF_DEVICES)
 #define TLC5940_NUM_OF_DC_QUARTETS      (TLC5940_BUFFER_SIZE_DOT_CORR / sizeof(tlc5940_quartet_t))
@@ -127,6 +127,7 @@ static struct tlc5940_flags tlc5940_flags;
 
 static unsigned char tlc5940_buffer[TLC5940_BUFFER_SIZE];
 static unsigned char tlc5940_dot_corr_buffer[TLC5940_BUFFER_SIZE_DOT_CORR];
+static unsigned char const * tlc5940_image = tlc5940_buffer; // Image that is sent on the next update
 
 static struct dma_channel * tlc5940_dma_channel;
 static struct spi_module * tlc5940_spi_module;
@@ -278,12 +279,13 @@ static void tlc5940_rtask_execute(void)
                 tlc5940_state = TLC5940_SWITCH_MODE_LOD;
             break;
         case TLC5940_UPDATE:
+            tlc5940_image = tlc5940_buffer;
             tlc5940_update_handler();
             tlc5940_state = TLC5940_UPDATE_DMA_TRANSFER;
             // no break
         case TLC5940_UPDATE_DMA_TRANSFER:
             if (dma_ready(tlc5940_dma_channel)) {
-                dma_configure_src(tlc5940_dma_channel, tlc5940_buffer, TLC5940_BUFFER_SIZE);
+                dma_configure_src(tlc5940_dma_channel, tlc5940_image, TLC5940_BUFFER_SIZE);
                 dma_enable_transfer(tlc5940_dma_channel);
                 tlc5940_state = TLC5940_UPDATE_DMA_TRANSFER_WAIT;
             }
@@ -291,7 +293,8 @@ static void tlc5940_rtask_execute(void)
         case TLC5940_UPDATE_DMA_TRANSFER_WAIT:
             if (dma_ready(tlc5940_dma_channel)) {
                 tlc5940_flags.need_update = false;
-                memset(tlc5940_buffer, 0x00, TLC5940_BUFFER_SIZE); // Because we are OR'ing in tlc5940_write
+                if (tlc5940_image == tlc5940_buffer)
+                    memset(tlc5940_buffer, 0x00, TLC5940_BUFFER_SIZE); // Because we are OR'ing in tlc5940_write
                 tlc5940_state = TLC5940_IDLE;
             }
             break;
@@ -412,3 +415,66 @@ void tlc5940_write_channels_mode8(unsigned int device, unsigned char const * pwm
         tlc5940_buffer[index + 1] |= byte2;
     }
 }
+
+void tlc5940_write_image(unsigned char const * image)
+{
+    ASSERT_NOT_NULL(image);
+
+    if (image != NULL)
+        tlc5940_image = image;
+}
+
+void tlc5940_pack(unsigned char * image, unsigned int device, unsigned int channel, unsigned short pwm_value)
+{
+    ASSERT_NOT_NULL(image);
+
+    if (device >= TLC5940_NUM_OF_DEVICES)
+        return;
+    if (channel >= TLC5940_CHANNELS_PER_DEVICE)
+        return;
+    if (pwm_value > TLC5940_MAX_PWM_VALUE)
+        pwm_value = TLC5940_MAX_PWM_VALUE;
+
+    unsigned int index = (channel + device * TLC5940_CHANNELS_PER_DEVICE);
+    index += index >> 1;
+    if (channel & 1) {
+        image[index    ] = (image[index] & 0xf0) | ((pwm_value >> 8) & 0x0f);
+        image[index + 1] = (pwm_value & 0xff);
+    } else {
+        image[index    ] = (pwm_value >> 4) & 0xff;
+        image[index + 1] = (image[index + 1] & 0x0f) | ((pwm_value & 0x0f) << 4);
+    }
+}
+
+void tlc5940_pack_channels_mode12(unsigned char * image, unsigned int device, unsigned char const * pwm_values)
+{
+    ASSERT_NOT_NULL(image);
+    ASSERT_NOT_NULL(pwm_values);
+
+    if (device >= TLC5940_NUM_OF_DEVICES)
+        return;
+
+    // The 12 bit values are already packed the way the TLC5940 expects them: two channels
+    // in three bytes, most significant bits first. So there is nothing left but a copy.
+    memcpy(image + device * (TLC5940_BUFFER_SIZE / TLC5940_NUM_OF_DEVICES), pwm_values, TLC5940_BUFFER_SIZE / TLC5940_NUM_OF_DEVICES);
+}
+
+void tlc5940_pack_channels(unsigned char * image, unsigned int device, unsigned short const * pwm_values)
+{
+    ASSERT_NOT_NULL(image);
+    ASSERT_NOT_NULL(pwm_values);
+
+    if (device >= TLC5940_NUM_OF_DEVICES)
+        return;
+
+    // The values must not exceed TLC5940_MAX_PWM_VALUE, there is no clamping for the sake of speed
+    image += device * (TLC5940_BUFFER_SIZE / TLC5940_NUM_OF_DEVICES);
+    for (unsigned int channel = 0; channel < TLC5940_CHANNELS_PER_DEVICE; channel += 2, pwm_values += 2, image += 3) {
+        unsigned short a = pwm_values[0];
+        unsigned short b = pwm_values[1];
+
+        image[0] = (unsigned char)(a >> 4);
+        image[1] = (unsigned char)((a & 0x0f) << 4 | b >> 8);
+        image[2] = (unsigned char)(b & 0xff);
+    }
+}
@@ -1,5 +1,5 @@
 #include <bootloader/bootloader.h>
-#include <bootloader/nvm.h>
+#include <core/nvm.h>
 #include <core/kernel_task.h>
 #include <core/bus.h>
 #include <core/timer.h>
@@ -1,5 +1,6 @@
 #include <core/bus.h>
 #include <core/assert.h>
+#include <core/job.h>
 #include <bootloader/bootloader.h>
 #include <version.h>
 #include <stddef.h>
@@ -9,6 +10,17 @@
 #define UNUSED2(x, y)       ((void)x);((void)y)
 #define UNUSED3(x, y, z)    ((void)x);((void)y);((void)z)
 
+static bool bus_job_bootloader_done(void)
+{
+    return bootloader_ready() || bootloader_error();
+}
+
+static struct job_handler const bus_job_bootloader =
+{
+    .done = bus_job_bootloader_done,
+    .failed = bootloader_error,
+};
+
 static enum bus_response_code bus_func_status(
     bool broadcast,
     union bus_data const * request_data,
@@ -41,11 +53,14 @@ static enum bus_response_code bus_func_bootloader_erase(
     union bus_data const * request_data,
     union bus_data * response_data)
 {
-    UNUSED3(broadcast, request_data, response_data);
+    UNUSED2(broadcast, request_data);
 
-    return bootloader_erase()
-        ? BUS_OK
-        : BUS_ERR_AGAIN;
+    if (!bootloader_erase())
+        return BUS_ERR_AGAIN;
+
+    // If no job could be started the host has to fall back to polling the status
+    response_data->by_int8 = job_start(&bus_job_bootloader);
+    return BUS_OK;
 }
 
 static enum bus_response_code bus_func_bootloader_set_magic(
@@ -101,11 +116,14 @@ static enum bus_response_code bus_func_bootloader_row_burn(
     union bus_data const * request_data,
     union bus_data * response_data)
 {
-    UNUSED3(broadcast, request_data, response_data);
+    UNUSED1(broadcast);
 
-    return bootloader_row_burn(request_data->by_uint32)
-        ? BUS_OK
-        : BUS_ERR_AGAIN;
+    if (!bootloader_row_burn(request_data->by_uint32))
+        return BUS_ERR_AGAIN;
+
+    // If no job could be started the host has to fall back to polling the status
+    response_data->by_int8 = job_start(&bus_job_bootloader);
+    return BUS_OK;
 }
 
 static enum bus_response_code bus_func_bootloader_row_crc16(
@@ -150,6 +168,7 @@ bus_func_t const bus_funcs[] =
     bus_func_bootloader_row_burn,       // 135
     bus_func_bootloader_row_crc16,      // 136
     bus_func_version,                   // 137
+    job_bus_wait,                       // 138
 };
 size_t const bus_funcs_size = BUS_FUNCS_SIZE;
 size_t const bus_funcs_start = 128;
\ No newline at end of file
@@ -1,4 +1,4 @@
-#include <bootloader/nvm.h>
+#include <core/nvm.h>
 #include <core/sys.h>
 #include <core/kernel.h>
 #include <core/kernel_task.h>
@@ -3,15 +3,19 @@
 #include <core/kernel_task.h>
 #include <core/assert.h>
 #include <core/rs485.h>
+#include <core/sys.h>
 #include <core/timer.h>
 #include <core/util.h>
 #include <stddef.h>
 #include <string.h>
 
-#define BUS_FRAME_SIZE              sizeof(struct bus_frame)
 #define BUS_CRC_SIZE                sizeof(crc16_t)
 #define BUS_FRAME_PART_DEADLINE     2 // In milliseconds, maximum allowed time between two reads
 #define BUS_BROADCAST_ADDRESS       32
+#define BUS_LATENCY_AVG_WEIGHT      8 // Moving average over roughly the last 8 responses
+#define BUS_RESPONSE_SLOT_OFFSET    750 // In microseconds, before the first time slot, so the host turned the line around (see RS485_BACKOFF_TX_TIME)
+#define BUS_RESPONSE_SLOT_MARGIN    500 // In microseconds, for a node that notices its time slot late, e.g. as the main loop is held up by an interrupt
+#define BUS_RESPONSE_SLOT_TIME      (RS485_TRANSFER_TIME(BUS_FRAME_SIZE) + BUS_RESPONSE_SLOT_MARGIN) // In microseconds, time reserved per address for a slotted broadcast response
 
 struct bus_header
 {
@@ -35,7 +39,7 @@ struct __attribute__((packed)) bus_frame
     union bus_data payload;
     crc16_t crc;
 };
-STATIC_ASSERT(sizeof(struct bus_frame) == 8)
+STATIC_ASSERT(sizeof(struct bus_frame) == BUS_FRAME_SIZE)
 
 union bus_raw_frame
 {
@@ -44,6 +48,16 @@ union bus_raw_frame
 };
 STATIC_ASSERT(sizeof(union bus_raw_frame) == BUS_FRAME_SIZE)
 
+struct bus_latency
+{
+    // All in core timer ticks
+    unsigned int last;
+    unsigned int min;
+    unsigned int max;
+    unsigned int avg;
+    unsigned int count;
+};
+
 enum bus_state
 {
     BUS_READ_CLEAR = 0,
@@ -75,6 +89,12 @@ static union bus_raw_frame bus_request;
 static union bus_raw_frame bus_response;
 static enum bus_state bus_state = BUS_READ_CLEAR;
 static unsigned int bus_frame_offset;
+static unsigned int bus_frame_timestamp; // Core timer ticks at which the last complete frame was received
+static struct bus_latency bus_latency;
+static union bus_raw_frame bus_slot_response;
+static bool bus_slot_requested; // Set by a handler to respond to the broadcast it is handling
+static bool bus_slot_pending; // Slotted response waiting for this node's time slot
+static unsigned int bus_slot_ticks; // Core timer ticks at which this node's time slot starts
 
 static void bus_error_callback(struct rs485_error error)
 {
@@ -98,11 +118,51 @@ fail_timer:
     return KERN_INIT_FAILED;
 }
 
+static void bus_latency_update(unsigned int ticks)
+{
+    bus_latency.last = ticks;
+    if (bus_latency.count++ == 0) {
+        bus_latency.min = ticks;
+        bus_latency.max = ticks;
+        bus_latency.avg = ticks;
+    } else {
+        if (ticks < bus_latency.min)
+            bus_latency.min = ticks;
+        if (ticks > bus_latency.max)
+            bus_latency.max = ticks;
+        bus_latency.avg += ((int)ticks - (int)bus_latency.avg) / BUS_LATENCY_AVG_WEIGHT;
+    }
+}
+
+static void bus_finalize_response(union bus_raw_frame * response)
+{
+    ASSERT(!response->frame.header.request);
+    response->frame.header.address = bus_address_get();
+    crc16_reset(&response->frame.crc);
+    crc16_update(&response->frame.crc, response->data, BUS_FRAME_SIZE - BUS_CRC_SIZE);
+}
+
+static void bus_schedule_slot_response(void)
+{
+    // Every node responds to the broadcast in its own time slot, so a single request can be
+    // answered by all nodes without collisions. The slots are timed by the core timer from
+    // the arrival of the request, which all nodes see at the same time, rather than by a
+    // software timer, which is only as accurate as its tick interval.
+    memcpy(bus_slot_response.data, bus_response.data, BUS_FRAME_SIZE);
+    bus_finalize_response(&bus_slot_response);
+    bus_slot_ticks = bus_frame_timestamp
+        + SYS_US_TO_CORE_TICKS(BUS_RESPONSE_SLOT_OFFSET + bus_address_get() * BUS_RESPONSE_SLOT_TIME);
+    bus_slot_pending = true;
+}
+
 static void bus_rtask_execute(void)
 {
     if (!bus_address_valid())
         return;
 
+    // Once a complete frame is read it is verified, handled and responded to
+    // within the same slot, rather than moving to the next state on every call.
+    // Only partial frames and errors will take multiple slots to complete.
     switch (bus_state) {
         default:
         case BUS_READ_CLEAR:
@@ -110,25 +170,39 @@ static void bus_rtask_execute(void)
             crc16_reset(&bus_crc16);
             memset(bus_response.data, 0, BUS_FRAME_SIZE);
             bus_state = BUS_READ_PART;
-            break;
-        case BUS_READ_PART:
-            if (bus_frame_offset && !timer_is_running(bus_timer))
+            // no break
+        case BUS_READ_PART: {
+            if (!bus_frame_offset && bus_slot_pending && (int)(SYS_CORE_TICKS() - bus_slot_ticks) >= 0) {
+                // The node of the previous slot is done by now, the backoff after its response is skipped
+                rs485_transmit_buffer_now(bus_slot_response.data, BUS_FRAME_SIZE);
+                bus_slot_pending = false;
+            }
+            if (bus_frame_offset && !timer_is_running(bus_timer)) {
                 bus_state = BUS_READ_CLEAR; // Did not receive a complete frame within deadline, drop it
-            else if (rs485_bytes_available()) {
-                unsigned int size = rs485_read_buffer(
-                    bus_request.data + bus_frame_offset,
-                    BUS_FRAME_SIZE - bus_frame_offset);
-                crc16_update(&bus_crc16, bus_request.data + bus_frame_offset, size);
-                bus_frame_offset += size;
-
-                // Did we read a whole frame's worth of data?
-                if(bus_frame_offset == BUS_FRAME_SIZE) {
-                    timer_stop(bus_timer);
-                    bus_state = BUS_FRAME_VERIFY;
-                } else
-                    timer_start(bus_timer, BUS_FRAME_PART_DEADLINE, TIMER_TIME_UNIT_MS);
+                break;
             }
-            break;
+            if (!rs485_bytes_available())
+                break;
+
+            unsigned int size = rs485_read_buffer(
+                bus_request.data + bus_frame_offset,
+                BUS_FRAME_SIZE - bus_frame_offset);
+            crc16_update(&bus_crc16, bus_request.data + bus_frame_offset, size);
+            bus_frame_offset += size;
+
+            // Did we read a whole frame's worth of data?
+            if (bus_frame_offset != BUS_FRAME_SIZE) {
+                timer_start(bus_timer, BUS_FRAME_PART_DEADLINE, TIMER_TIME_UNIT_MS);
+                break;
+            }
+
+            // Timestamped when its last character was received rather than when it's read, as
+            // the main loop may take a while to come around, e.g. while held up by an interrupt
+            timer_stop(bus_timer);
+            bus_frame_timestamp = rs485_read_ticks();
+            bus_state = BUS_FRAME_VERIFY;
+            // no break
+        }
         case BUS_FRAME_VERIFY:
 #ifdef BUS_IGNORE_CRC
 #warning "BUS_IGNORE_CRC defined"
@@ -146,10 +220,14 @@ static void bus_rtask_execute(void)
             // Nope...
             else
                 bus_state = BUS_READ_CLEAR;
-            break;
+
+            if (bus_state != BUS_FRAME_HANDLE)
+                break;
+            // no break
         case BUS_FRAME_HANDLE: {
             bool broadcast = bus_request.frame.header.address == BUS_BROADCAST_ADDRESS;
 
+            bus_slot_requested = false;
             if (bus_request.frame.command < bus_funcs_start || bus_request.frame.command >= (bus_funcs_start + bus_funcs_size))
                 bus_response.frame.response_code = BUS_ERR_INVALID_COMMAND;
             else {
@@ -159,21 +237,27 @@ static void bus_rtask_execute(void)
                     : handler(broadcast, &bus_request.frame.payload, &bus_response.frame.payload);
             }
 
-            bus_state = broadcast ? BUS_READ_CLEAR : BUS_SEND_RESPONSE;
-            break;
+            if (broadcast) {
+                if (bus_slot_requested)
+                    bus_schedule_slot_response();
+                bus_state = BUS_READ_CLEAR;
+                break;
+            }
+
+            bus_state = BUS_SEND_RESPONSE;
+            // no break
         }
         case BUS_SEND_RESPONSE:
-            ASSERT(!bus_response.frame.header.request);
-            bus_response.frame.header.address = bus_address_get();
-            crc16_reset(&bus_response.frame.crc);
-            crc16_update(&bus_response.frame.crc, bus_response.data, BUS_FRAME_SIZE - BUS_CRC_SIZE);
+            bus_finalize_response(&bus_response);
             rs485_transmit_buffer(bus_response.data, BUS_FRAME_SIZE);
+            bus_latency_update(SYS_CORE_TICKS() - bus_frame_timestamp);
             bus_state = BUS_READ_CLEAR;
             break;
 
         case BUS_ERROR:
         case BUS_ERROR_RESET:
             rs485_reset();
+            bus_slot_pending = false;
             bus_state = BUS_READ_CLEAR;
             break;
     }
@@ -181,5 +265,33 @@ static void bus_rtask_execute(void)
 
 bool bus_idle(void)
 {
-    return bus_state == BUS_READ_PART && bus_frame_offset == 0 && rs485_idle();
+    return bus_state == BUS_READ_PART && bus_frame_offset == 0 && !bus_slot_pending && rs485_idle();
+}
+
+unsigned int bus_request_ticks(void)
+{
+    return bus_frame_timestamp;
+}
+
+void bus_respond_in_slot(void)
+{
+    bus_slot_requested = true;
+}
+
+bool bus_stat(enum bus_stat stat, unsigned int * out)
+{
+    ASSERT_NOT_NULL(out);
+    if (out == NULL)
+        return false;
+
+    switch (stat) {
+        case BUS_STAT_LATENCY_LAST:     *out = SYS_CORE_TICKS_TO_US(bus_latency.last);  break;
+        case BUS_STAT_LATENCY_MIN:      *out = SYS_CORE_TICKS_TO_US(bus_latency.min);   break;
+        case BUS_STAT_LATENCY_MAX:      *out = SYS_CORE_TICKS_TO_US(bus_latency.max);   break;
+        case BUS_STAT_LATENCY_AVG:      *out = SYS_CORE_TICKS_TO_US(bus_latency.avg);   break;
+        case BUS_STAT_RESPONSE_COUNT:   *out = bus_latency.count;                       break;
+        default:                                                                        return false;
+    }
+
+    return true;
 }
\ No newline at end of file
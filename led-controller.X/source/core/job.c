@@ -0,0 +1,109 @@
+#include <core/job.h>
+#include <core/bus_address.h>
+#include <core/kernel_task.h>
+#include <core/assert.h>
+#include <core/util.h>
+#include <stddef.h>
+
+STATIC_ASSERT(JOB_POOL_SIZE > 0 && JOB_POOL_SIZE <= 8) // Must fit in a job mask
+
+enum job_state
+{
+    JOB_FREE = 0,
+    JOB_RUNNING,
+    JOB_DONE,
+    JOB_FAILED,
+};
+
+struct job
+{
+    struct job_handler const * handler;
+    enum job_state state;
+    bool reported; // Result was handed out by job_get_status
+};
+
+static void job_rtask_execute(void);
+KERN_SIMPLE_RTASK(job, NULL, job_rtask_execute)
+
+static struct job job_pool[JOB_POOL_SIZE];
+
+static void job_rtask_execute(void)
+{
+    // Latch the result as soon as a job is done, a later job may
+    // reuse the same module and clear the state we are polling on.
+    struct job * job = job_pool;
+    for (unsigned int i = 0; i < JOB_POOL_SIZE; ++i, ++job) {
+        if (job->state != JOB_RUNNING || !job->handler->done())
+            continue;
+
+        job->state = (job->handler->failed != NULL && job->handler->failed())
+            ? JOB_FAILED
+            : JOB_DONE;
+    }
+}
+
+int job_start(struct job_handler const * handler)
+{
+    ASSERT_NOT_NULL(handler);
+    ASSERT_NOT_NULL(handler->done);
+
+    for (unsigned int i = 0; i < JOB_POOL_SIZE; ++i) {
+        if (job_pool[i].state == JOB_FREE) {
+            job_pool[i].handler = handler;
+            job_pool[i].state = JOB_RUNNING;
+            job_pool[i].reported = false;
+            return i;
+        }
+    }
+
+    return JOB_ID_INVALID; // Host must release finished jobs first
+}
+
+void job_release(unsigned char mask)
+{
+    // Only finished jobs of which the result has been reported can be released, so a
+    // retried release can't drop the result of a job that reused the ID in the meantime.
+    for (unsigned int i = 0; i < JOB_POOL_SIZE; ++i) {
+        if ((mask & BIT_SHIFT(i)) && job_pool[i].reported)
+            job_pool[i].state = JOB_FREE;
+    }
+}
+
+struct job_status job_get_status(void)
+{
+    struct job_status status = { 0 };
+    for (unsigned int i = 0; i < JOB_POOL_SIZE; ++i) {
+        switch (job_pool[i].state) {
+            case JOB_RUNNING:   status.running |= BIT_SHIFT(i);                             break;
+            case JOB_DONE:      status.done |= BIT_SHIFT(i);                                break;
+            case JOB_FAILED:    status.done |= BIT_SHIFT(i); status.failed |= BIT_SHIFT(i); break;
+            default:                                                                        break;
+        }
+        job_pool[i].reported = (status.done & BIT_SHIFT(i));
+    }
+    return status;
+}
+
+enum bus_response_code job_bus_wait(
+    bool broadcast,
+    union bus_data const * request_data,
+    union bus_data * response_data)
+{
+    // A job is released at most once it's reported, so a retried request or a report that got
+    // lost on its way to the host can't drop the result of a job the host hasn't seen. Addresses
+    // are 5 bits, so the node mask takes the whole payload.
+    if (broadcast)
+        job_release((request_data->by_uint32 & BIT_SHIFT(bus_address_get())) ? JOB_MASK_ALL : 0);
+    else
+        job_release(request_data->by_uint8);
+
+    struct job_status status = job_get_status();
+    response_data->by_job_status.done = status.done;
+    response_data->by_job_status.failed = status.failed;
+    response_data->by_job_status.running = status.running;
+
+    // Only nodes with something to report take part in a slotted broadcast
+    if (broadcast && (status.done || status.running))
+        bus_respond_in_slot();
+    return BUS_OK;
+}
@@ -0,0 +1,200 @@
+#include <core/nvm.h>
+#include <core/sys.h>
+#include <core/util.h>
+#include <core/assert.h>
+#include <xc.h>
+#include <string.h>
+
+#define NVM_KEY_MAGIC_WORD_1        0xAA996655
+#define NVM_KEY_MAGIC_WORD_2        0x556699AA
+
+#define NVM_NVMCON_WREN_MASK        BIT(14)
+#define NVM_NVMCON_WR_MASK          BIT(15)
+#define NVM_NVMCON_OP_MASK          MASK(0xf, 0)
+#define NVM_NVMCON_ERR_MASK         (BIT(13) | BIT(12))
+
+enum nvm_operation
+{
+    nvm_write_word  = 1,
+    nvm_write_row   = 3,
+    nvm_page_erase  = 4,
+};
+
+nvm_word_t nvm_row_buffer[NVM_ROW_BUFFER_SIZE] __attribute__((aligned(NVM_WORD_SIZE)));
+STATIC_ASSERT(sizeof(nvm_word_t) == NVM_WORD_SIZE);
+
+static void const * nvm_buffer_owner;
+
+static bool nvm_unlock(enum nvm_operation op)
+{
+    sys_disable_global_interrupt();
+
+    NVMCON = op & NVM_NVMCON_OP_MASK;
+    REG_SET(NVMCON, NVM_NVMCON_WREN_MASK);
+    NVMKEY = NVM_KEY_MAGIC_WORD_1;
+    NVMKEY = NVM_KEY_MAGIC_WORD_2;
+
+    // Start operation and wait until completion
+    // Note: it's important to use the atomic SET shadow register
+    //       to start the operation, a normal bitwise OR assignment
+    //       results in a WRERR
+    ATOMIC_REG_SET(NVMCON, NVM_NVMCON_WR_MASK);
+    while (NVMCON & NVM_NVMCON_WR_MASK);
+    ATOMIC_REG_CLR(NVMCON, NVM_NVMCON_WREN_MASK);
+
+    sys_enable_global_interrupt();
+
+    return !(NVMCON & NVM_NVMCON_ERR_MASK);
+}
+
+void nvm_init(void)
+{
+    nvm_buffer_reset();
+}
+
+void nvm_buffer_reset(void)
+{
+    memset(nvm_row_buffer, 0xff, NVM_ROW_SIZE);
+}
+
+bool nvm_buffer_acquire(void const * owner)
+{
+    ASSERT_NOT_NULL(owner);
+    if (owner == NULL)
+        return false;
+
+    if (nvm_buffer_owner != NULL && nvm_buffer_owner != owner)
+        return false;
+
+    nvm_buffer_owner = owner;
+    return true;
+}
+
+bool nvm_buffer_owned(void const * owner)
+{
+    return owner != NULL && nvm_buffer_owner == owner;
+}
+
+void nvm_buffer_release(void const * owner)
+{
+    if (nvm_buffer_owned(owner))
+        nvm_buffer_owner = NULL;
+}
+
+bool nvm_erase_page_phys(void const * address)
+{
+    NVMADDR = (int)address;
+    return nvm_unlock(nvm_page_erase);
+}
+
+bool nvm_erase_page_virt(void const * address)
+{
+    NVMADDR = PHY_ADDR(address);
+    return nvm_unlock(nvm_page_erase);
+}
+
+bool nvm_write_row_phys(void const * address)
+{
+    NVMADDR = (int)address;
+    NVMSRCADDR = PHY_ADDR(nvm_row_buffer);
+    bool result = nvm_unlock(nvm_write_row);
+    nvm_buffer_reset();
+    return result;
+}
+
+bool nvm_write_row_virt(void const * address)
+{
+    NVMADDR = PHY_ADDR(address);
+    NVMSRCADDR = PHY_ADDR(nvm_row_buffer);
+    bool result = nvm_unlock(nvm_write_row);
+    nvm_buffer_reset();
+    return result;
+}
+
+bool nvm_write_word_phys(void const * address, nvm_word_t word)
+{
+    NVMDATA = word;
+    NVMADDR = (int)address;
+    return nvm_unlock(nvm_write_word);
+}
+
+bool nvm_write_word_virt(void const * address, nvm_word_t word)
+{
+    NVMDATA = word;
+    NVMADDR = PHY_ADDR(address);
+    return nvm_unlock(nvm_write_word);
+}
+
+// Difference a word `after` bytes before the end of the page has to make to the CRC of the page
+static crc16_t nvm_seal_crc(nvm_word_t word, unsigned int after)
+{
+    nvm_word_t const erased = 0;
+    crc16_t crc = 0;
+
+    crc16_update(&crc, &word, NVM_WORD_SIZE);
+    for (; after > 0; after -= NVM_WORD_SIZE)
+        crc16_update(&crc, &erased, NVM_WORD_SIZE);
+    return crc;
+}
+
+bool nvm_seal_page_virt(void const * page)
+{
+    ASSERT_NOT_NULL(page);
+    if (page == NULL)
+        return false;
+
+    // The CRC is linear, so a page changes the CRC of the app memory by the CRC (without seed)
+    // of its difference with the erased page, wherever it is
+    nvm_word_t const * words = KSEG1_ADDR(page);
+    crc16_t difference = 0;
+    for (unsigned int i = 0; i < NVM_PAGE_SIZE / NVM_WORD_SIZE; ++i) {
+        nvm_word_t word = ~words[i];
+        crc16_update(&difference, &word, NVM_WORD_SIZE);
+    }
+    if (difference == 0)
+        return true;
+
+    // The seal words are used from the end of the page on
+    unsigned int seal = NVM_PAGE_SIZE / NVM_WORD_SIZE - 1;
+    unsigned int after = 0; // In bytes
+    while (words[seal] != NVM_WORD_MAX) {
+        if (after == NVM_ROW_SIZE - NVM_WORD_SIZE)
+            return false;
+        seal--;
+        after += NVM_WORD_SIZE;
+    }
+
+    // Solve the bits of the seal word over GF(2), with a basis of a distinct highest bit per
+    // vector. The differences a page can make span 13 bits of the CRC, as do those of a word.
+    crc16_t basis_crc[32];
+    nvm_word_t basis_word[32];
+    unsigned int basis_size = 0;
+    for (unsigned int bit = 0; bit < 32; ++bit) {
+        nvm_word_t word = BIT(bit);
+        crc16_t crc = nvm_seal_crc(word, after);
+        for (unsigned int i = 0; i < basis_size; ++i) {
+            if ((crc ^ basis_crc[i]) < crc) {
+                crc ^= basis_crc[i];
+                word ^= basis_word[i];
+            }
+        }
+        if (crc) {
+            basis_crc[basis_size] = crc;
+            basis_word[basis_size++] = word;
+        }
+    }
+
+    nvm_word_t word = 0;
+    for (unsigned int i = 0; i < basis_size; ++i) {
+        if ((difference ^ basis_crc[i]) < difference) {
+            difference ^= basis_crc[i];
+            word ^= basis_word[i];
+        }
+    }
+    ASSERT(difference == 0);
+    if (difference)
+        return false;
+
+    // The difference with the erased word, so the bits of the seal word are cleared
+    return nvm_write_word_virt(&words[seal], ~word);
+}
\ No newline at end of file
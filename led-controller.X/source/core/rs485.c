@@ -8,7 +8,6 @@
 #include <limits.h>
 #include <xc.h>
 
-#define RS485_BAUDRATE              115200LU
 #define RS485_TX_FIFO_SIZE          100 // [1, 256)
 #define RS485_RX_FIFO_SIZE          100 // [1, 256)
 
@@ -38,6 +37,7 @@
 #define RS485_USTA_TXEN_MASK        BIT(10)
 #define RS485_TRMT_MASK             BIT(8)
 #define RS485_TX_INT_MASK           BIT(8)
+#define RS485_RX_INT_MASK           BIT(7) // Raised while a character is received, URXISEL is 0 (see RS485_USTA_WORD)
 #define RS485_INT_PRIORITY_MASK     MASK(0x5, 26)  // Interrupt handler must use IPL5SOFT
 
 #define RS485_RX_PPS_REG            U1RXR
@@ -98,6 +98,7 @@ static struct io_pin const rs485_tx_pin = IO_ANLG_PIN(3, B);
 // We do this by introducing a backoff period after the last time we've read
 // data in which no transfer may occur.
 static struct timer_module * rs485_backoff_tx_timer;
+static bool rs485_skip_backoff; // Set if the data to transfer skips the backoff period
 static enum rs485_status rs485_status = RS485_STATUS_IDLE;
 static enum rs485_state rs485_state = RS485_IDLE;
 
@@ -107,7 +108,9 @@ static unsigned char rs485_tx_producer;
 
 static unsigned char rs485_rx_fifo[RS485_RX_FIFO_SIZE];
 static unsigned char rs485_rx_consumer;
-static unsigned char rs485_rx_producer;
+static volatile unsigned char rs485_rx_producer; // Also by the interrupt
+static volatile unsigned int rs485_rx_ticks; // Core timer ticks at which the newest character was received
+static volatile bool rs485_rx_event; // Set when characters are received, cleared by the task
 
 inline static bool __attribute__((always_inline)) rs485_rx_available()
 {
@@ -132,6 +135,19 @@ inline static void __attribute__((always_inline)) rs485_receive(unsigned char da
         rs485_rx_producer = 0;
 }
 
+// Characters are moved into the RX FIFO by the interrupt as soon as they're received, so they
+// are timestamped accurately (see rs485_read_ticks). The task only moves them if the interrupt
+// can't run, e.g. in the bootloader which runs with the global interrupt disabled.
+static void rs485_receive_all(void)
+{
+    while (rs485_rx_available()) {
+        rs485_error_reg.by_byte |= (RS485_USTA_REG & RS485_ERROR_BITS_MASK) >> 1; // Latch errors of the character before reading it
+        rs485_receive(RS485_RX_REG);
+        rs485_rx_ticks = SYS_CORE_TICKS();
+        rs485_rx_event = true;
+    }
+}
+
 inline static void __attribute__((always_inline)) rs485_write(unsigned char data)
 {
     ASSERT(!(RS485_USTA_REG & RS485_UTXBF_MASK));
@@ -189,6 +205,8 @@ static int rs485_rtask_init(void)
     RS485_USTA_REG = RS485_USTA_WORD;
     RS485_UMODE_REG = RS485_UMODE_WORD;
     REG_SET(RS485_UMODE_REG, RS485_ON_MASK);
+    ATOMIC_REG_CLR(RS485_IFS_REG, RS485_RX_INT_MASK);
+    ATOMIC_REG_SET(RS485_IEC_REG, RS485_RX_INT_MASK);
 
     // Initialize timer
     rs485_backoff_tx_timer = timer_construct(TIMER_TYPE_COUNTDOWN, NULL);
@@ -213,31 +231,36 @@ static void rs485_rtask_execute(void)
 
             rs485_status = RS485_STATUS_IDLE;
             rs485_state = RS485_IDLE_WAIT_EVENT;
-            break;
+            // Fall through
         case RS485_IDLE_WAIT_EVENT:
-            if (rs485_rx_available()) {
+            if (rs485_rx_available()) { // The interrupt can't run
+                ATOMIC_REG_CLR(RS485_IEC_REG, RS485_RX_INT_MASK);
+                rs485_receive_all();
+                ATOMIC_REG_SET(RS485_IEC_REG, RS485_RX_INT_MASK);
+            }
+
+            if (rs485_skip_backoff && rs485_tx_available()) {
+                // Data that skips the backoff is sent at a set time (e.g. a time slot), so start
+                // the transfer in this pass already.
+                rs485_status = RS485_STATUS_TRANSFERRING;
+                rs485_state = RS485_TRANSFER;
+            } else if (rs485_rx_event) {
+                rs485_rx_event = false;
                 rs485_status = RS485_STATUS_RECEIVING;
                 rs485_state = RS485_RECEIVE;
+                break;
             } else if (rs485_tx_available() && !timer_is_running(rs485_backoff_tx_timer)) {
                 rs485_status = RS485_STATUS_TRANSFERRING;
                 rs485_state = RS485_TRANSFER;
+                break;
             } else {
                 rs485_error_reg.by_byte |= (RS485_USTA_REG & RS485_ERROR_BITS_MASK) >> 1; // Latch errors
                 rs485_state = rs485_error_reg.by_byte
                     ? RS485_ERROR
                     : RS485_IDLE_WAIT_EVENT;
+                break;
             }
-            break;
-
-        // Receive routine
-        case RS485_RECEIVE:
-        case RS485_RECEIVE_READ:
-            while (rs485_rx_available())
-                rs485_receive(RS485_RX_REG);
-
-            timer_restart(rs485_backoff_tx_timer);
-            rs485_state = RS485_IDLE;
-            break;
+            // Fall through
 
         // Transfer routine
         case RS485_TRANSFER:
@@ -245,6 +268,7 @@ static void rs485_rtask_execute(void)
             // Put transceiver into transfer mode from main thread, just
             // before writing to TXREG, and let the interrupt put it back
             // into receive mode when all characters are transferred.
+            rs485_skip_backoff = false;
             ATOMIC_REG_CLR(RS485_IEC_REG, RS485_TX_INT_MASK);
             IO_SET(rs485_dir_pin); // Put transceiver into transfer mode
             while (rs485_tx_available())
@@ -263,6 +287,13 @@ static void rs485_rtask_execute(void)
             }
             break;
 
+        // Receive routine
+        case RS485_RECEIVE:
+        case RS485_RECEIVE_READ:
+            timer_restart(rs485_backoff_tx_timer);
+            rs485_state = RS485_IDLE;
+            break;
+
         // Error routine
         case RS485_ERROR:
             REG_CLR(RS485_USTA_REG, RS485_USTA_RXEN_MASK | RS485_USTA_TXEN_MASK); // Disable RX and TX
@@ -300,12 +331,15 @@ void rs485_register_error_notifier(struct rs485_error_notifier * const notifier)
 
 void rs485_reset(void)
 {
+    ATOMIC_REG_CLR(RS485_IEC_REG, RS485_RX_INT_MASK);
     rs485_state = RS485_IDLE;
     rs485_status = RS485_STATUS_IDLE;
+    rs485_skip_backoff = false;
     rs485_tx_producer = 0;
     rs485_tx_consumer = 0;
     rs485_rx_producer = 0;
     rs485_rx_consumer = 0;
+    rs485_rx_event = false;
 
     // Clear errors and enable module
     rs485_error_reg.by_byte = 0;
@@ -313,6 +347,8 @@ void rs485_reset(void)
     REG_CLR(RS485_UMODE_REG, RS485_ON_MASK); // Clears erros from USTA
     REG_SET(RS485_USTA_REG, RS485_USTA_RXEN_MASK | RS485_USTA_TXEN_MASK);
     REG_SET(RS485_UMODE_REG, RS485_ON_MASK);
+    ATOMIC_REG_CLR(RS485_IFS_REG, RS485_RX_INT_MASK);
+    ATOMIC_REG_SET(RS485_IEC_REG, RS485_RX_INT_MASK);
 }
 
 void rs485_transmit(unsigned char data)
@@ -336,6 +372,12 @@ void rs485_transmit_buffer(unsigned char * buffer, unsigned int size)
         rs485_transmit(*buffer++);
 }
 
+void rs485_transmit_buffer_now(unsigned char * buffer, unsigned int size)
+{
+    rs485_transmit_buffer(buffer, size);
+    rs485_skip_backoff = true;
+}
+
 bool rs485_bytes_available(void)
 {
     return rs485_rx_consumer != rs485_rx_producer;
@@ -366,9 +408,29 @@ unsigned int rs485_read_buffer(unsigned char * buffer, unsigned int max_size)
     return (buffer - buffer_begin);
 }
 
+unsigned int rs485_read_ticks(void)
+{
+    // Exact if the last character read is the newest one, which it is for a request the host
+    // waits on. The characters after it are taken to have followed it back to back.
+    ATOMIC_REG_CLR(RS485_IEC_REG, RS485_RX_INT_MASK);
+    unsigned int pending = (rs485_rx_producer + RS485_RX_FIFO_SIZE - rs485_rx_consumer) % RS485_RX_FIFO_SIZE;
+    unsigned int ticks = rs485_rx_ticks;
+    ATOMIC_REG_SET(RS485_IEC_REG, RS485_RX_INT_MASK);
+
+    return ticks - SYS_US_TO_CORE_TICKS(RS485_TRANSFER_TIME(pending));
+}
+
 void __ISR(RS485_ISR_VECTOR, IPL5SOFT) rs485_interrupt(void)
 {
-    ASSERT(rs485_tx_complete());
-    IO_CLR(rs485_dir_pin); // Put transceiver into receive mode
-    ATOMIC_REG_CLR(RS485_IEC_REG, RS485_TX_INT_MASK);
+    // Shared by the receiver and the transmitter
+    if (RS485_IFS_REG & RS485_RX_INT_MASK) {
+        rs485_receive_all();
+        ATOMIC_REG_CLR(RS485_IFS_REG, RS485_RX_INT_MASK); // Only clears once the UART's FIFO is empty
+    }
+
+    if ((RS485_IEC_REG & RS485_TX_INT_MASK) && (RS485_IFS_REG & RS485_TX_INT_MASK)) {
+        ASSERT(rs485_tx_complete());
+        IO_CLR(rs485_dir_pin); // Put transceiver into receive mode
+        ATOMIC_REG_CLR(RS485_IEC_REG, RS485_TX_INT_MASK);
+    }
 }